@@ -0,0 +1,189 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+
+#include "AllocationCounter.h"
+
+#include <cstddef>
+
+// The counters are only compiled in with BENCHMARK_COUNT_ALLOCATIONS, and
+// only for glibc, which exports the __libc_* entry points the interposed
+// functions forward to. Counting costs an atomic add per allocation.
+#if defined(BENCHMARK_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+
+#include <cerrno>
+#include <malloc.h>
+#include <unistd.h>
+
+extern "C"
+{
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace
+{
+long long NumCalls = 0;
+long long NumBytes = 0;
+long long LiveBytes = 0;
+long long PeakLiveBytes = 0;
+
+void CountAllocation(void* ptr, std::size_t size)
+{
+  if(!ptr)
+    {
+    return;
+    }
+  __sync_fetch_and_add(&NumCalls, 1);
+  __sync_fetch_and_add(&NumBytes, static_cast<long long>(size));
+
+  const long long live = __sync_add_and_fetch(&LiveBytes,
+    static_cast<long long>(malloc_usable_size(ptr)));
+  long long peak = PeakLiveBytes;
+  while(live > peak)
+    {
+    const long long previous = __sync_val_compare_and_swap(&PeakLiveBytes, peak, live);
+    if(previous == peak)
+      {
+      break;
+      }
+    peak = previous;
+    }
+}
+
+void CountFree(void* ptr)
+{
+  if(ptr)
+    {
+    __sync_fetch_and_sub(&LiveBytes, static_cast<long long>(malloc_usable_size(ptr)));
+    }
+}
+}
+
+extern "C"
+{
+void* malloc(std::size_t size)
+{
+  void* ptr = __libc_malloc(size);
+  CountAllocation(ptr, size);
+  return ptr;
+}
+
+void* calloc(std::size_t count, std::size_t size)
+{
+  void* ptr = __libc_calloc(count, size);
+  CountAllocation(ptr, count * size);
+  return ptr;
+}
+
+void* realloc(void* ptr, std::size_t size)
+{
+  //the old block is gone once realloc succeeds, whether it moved or not
+  const long long oldSize = ptr ? static_cast<long long>(malloc_usable_size(ptr)) : 0;
+  void* newPtr = __libc_realloc(ptr, size);
+  if(newPtr || size == 0)
+    {
+    __sync_fetch_and_sub(&LiveBytes, oldSize);
+    }
+  CountAllocation(newPtr, size);
+  return newPtr;
+}
+
+void* memalign(std::size_t alignment, std::size_t size)
+{
+  void* ptr = __libc_memalign(alignment, size);
+  CountAllocation(ptr, size);
+  return ptr;
+}
+
+int posix_memalign(void** ptr, std::size_t alignment, std::size_t size)
+{
+  if(alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+    {
+    return EINVAL;
+    }
+  void* aligned = __libc_memalign(alignment, size);
+  if(!aligned)
+    {
+    return ENOMEM;
+    }
+  CountAllocation(aligned, size);
+  *ptr = aligned;
+  return 0;
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size)
+{
+  return memalign(alignment, size);
+}
+
+void* valloc(std::size_t size)
+{
+  return memalign(static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)), size);
+}
+
+void* pvalloc(std::size_t size)
+{
+  const std::size_t pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  return memalign(pageSize, (size + pageSize - 1) / pageSize * pageSize);
+}
+
+void free(void* ptr)
+{
+  CountFree(ptr);
+  __libc_free(ptr);
+}
+}
+
+bool bench::AllocationCountingEnabled()
+{
+  return true;
+}
+
+bench::AllocationCounts bench::CurrentAllocationCounts()
+{
+  AllocationCounts counts;
+  counts.Calls = __sync_fetch_and_add(&NumCalls, 0);
+  counts.Bytes = __sync_fetch_and_add(&NumBytes, 0);
+  counts.LiveBytes = __sync_fetch_and_add(&LiveBytes, 0);
+  counts.PeakLiveBytes = __sync_fetch_and_add(&PeakLiveBytes, 0);
+  return counts;
+}
+
+void bench::ResetPeakLiveBytes()
+{
+  __sync_lock_test_and_set(&PeakLiveBytes, __sync_fetch_and_add(&LiveBytes, 0));
+}
+
+#else
+
+bool bench::AllocationCountingEnabled()
+{
+  return false;
+}
+
+bench::AllocationCounts bench::CurrentAllocationCounts()
+{
+  return AllocationCounts();
+}
+
+void bench::ResetPeakLiveBytes()
+{
+}
+
+#endif
@@ -0,0 +1,56 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __allocationCounter_h
+#define __allocationCounter_h
+
+namespace bench
+{
+
+// Totals of the heap allocations made by the process, counted by the
+// malloc family interposed in AllocationCounter.cxx. Everything that ends
+// up in malloc is seen: operator new, VTK arrays, host thrust vectors, TBB
+// when it isn't using its own allocator. Live bytes are usable sizes, so
+// they can be a little above what was asked for.
+struct AllocationCounts
+{
+  AllocationCounts():
+    Calls(0),
+    Bytes(0),
+    LiveBytes(0),
+    PeakLiveBytes(0)
+    {
+    }
+
+  //number of allocations and bytes asked for since the process started
+  long long Calls;
+  long long Bytes;
+  //bytes allocated and not yet freed, now and at most since the last
+  //ResetPeakLiveBytes
+  long long LiveBytes;
+  long long PeakLiveBytes;
+};
+
+//false when the build doesn't interpose the allocator, counts are all 0
+bool AllocationCountingEnabled();
+
+AllocationCounts CurrentAllocationCounts();
+
+//start tracking the peak of live bytes again from the current value
+void ResetPeakLiveBytes();
+
+}
+
+#endif
@@ -18,23 +18,57 @@
 
 #include <vtkm/testing/OptionParser.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
 
-enum  optionIndex { UNKNOWN, HELP, FILEPATH, WRITE_LOC, ISO_VALUE, CORES, RESAMPLE_RATIO};
+enum  optionIndex { UNKNOWN, HELP, FILEPATH, WRITE_LOC, ISO_VALUE, CORES, RESAMPLE_RATIO, WELD, RESULTS, ISO_VALUES, BRICKS, SYNTHETIC, DIMS, IMPLICIT, STREAM, COUNTERS, SAVE_BASELINE, BASELINE, REGRESSION_THRESHOLD, SIGNIFICANCE, TRIALS, PRECISION, TIME_BUDGET, PHASES, TRACE, RANKS, BALANCE, NUMA, HUGE_PAGES, PIN, PIPELINE, ALGORITHMS, ISOLATE};
 const vtkm::testing::option::Descriptor usage[] =
 {
   {UNKNOWN,   0,"" , ""    ,      vtkm::testing::option::Arg::None, "USAGE: example [options]\n\n"
                                                                     "Options:" },
   {HELP,      0,"h" , "help",    vtkm::testing::option::Arg::None, "  --help, -h  \tPrint usage and exit." },
   {FILEPATH,      0,"", "file",      vtkm::testing::option::Arg::Optional, "  --file  \t nrrd file to read." },
+  {PIPELINE,  0,"", "pipeline",  vtkm::testing::option::Arg::Optional, "  --pipeline  \t Filter to benchmark: 1 is threshold, 2 is marching cubes (the default)." },
+  {ALGORITHMS,  0,"", "algorithms",  vtkm::testing::option::Arg::Optional, "  --algorithms  \t Comma separated algorithms to benchmark, e.g. vtkm,vtk. All of them by default." },
+  {ISOLATE,  0,"", "isolate",  vtkm::testing::option::Arg::None, "  --isolate  \t Run every algorithm at every core count in a child process of its own, so its heap and caches don't carry over to the next." },
+  {SYNTHETIC,  0,"", "synthetic",  vtkm::testing::option::Arg::Optional, "  --synthetic  \t Generate the input instead of reading a file: tangle, sphere or gyroid." },
+  {DIMS,  0,"", "dims",  vtkm::testing::option::Arg::Optional, "  --dims  \t Number of points along each axis of a synthetic input." },
+  {IMPLICIT,  0,"", "implicit",  vtkm::testing::option::Arg::None, "  --implicit  \t Never materialize the synthetic input, only the VTK-m isosurface is benchmarked and reads values computed on access." },
   {WRITE_LOC,  0,"", "dump",  vtkm::testing::option::Arg::Optional, "  --dump  \t Folder to write dumps of the results of each algorithm." },
   {ISO_VALUE,  0,"", "isovalue",  vtkm::testing::option::Arg::Optional, "  --isovalue  \t Value to contour the dataset at." },
+  {ISO_VALUES,  0,"", "isovalues",  vtkm::testing::option::Arg::Optional, "  --isovalues  \t Comma separated isovalues to contour at together, benchmarks a single pass over the field against one run per isovalue." },
   {CORES,  0,"", "cores",        vtkm::testing::option::Arg::Optional, "  --cores  \t number of cores to use, 0 means all cores, -1 means test with 1 to max cores." },
   {RESAMPLE_RATIO,  0,"", "ratio",  vtkm::testing::option::Arg::Optional, "  --ratio  \t Resample ratio for the input data." },
+  {BRICKS,  0,"", "bricks",  vtkm::testing::option::Arg::Optional, "  --bricks  \t Also benchmark the VTK-m isosurface skipping the bricks of this many cells per side whose min/max range can't contain the isovalue." },
+  {WELD,  0,"", "weld",  vtkm::testing::option::Arg::None, "  --weld  \t Also benchmark the VTK-m isosurface with welded output vertices." },
+  {STREAM,  0,"", "stream",  vtkm::testing::option::Arg::Optional, "  --stream  \t Comma separated slab sizes, in cells along z. Instead of loading it, the file is streamed in slabs of each size through the VTK-m isosurface." },
+  {COUNTERS,  0,"", "counters",  vtkm::testing::option::Arg::None, "  --counters  \t Read the cycles, instructions, LLC misses, branch misses and stalled cycles of every thread around each trial." },
+  {NUMA,  0,"", "numa",  vtkm::testing::option::Arg::None, "  --numa  \t Copy the input into memory first touched by the threads that contour it, so each page sits on their socket, and give the output arrays fresh pages. Reports where the pages ended up." },
+  {HUGE_PAGES,  0,"", "huge-pages",  vtkm::testing::option::Arg::Optional, "  --huge-pages  \t Back the placed input by huge pages: thp (transparent) or hugetlb (reserved pool). Implies --numa." },
+  {PIN,  0,"", "pin",  vtkm::testing::option::Arg::None, "  --pin  \t Pin every thread to a core, filling a socket before the next, and report the scaling per socket." },
+  {RANKS,  0,"", "ranks",  vtkm::testing::option::Arg::Optional, "  --ranks  \t BenchmarkMPI only. Comma separated numbers of MPI ranks to split the volume over, out of the ones launched. All of them by default." },
+  {BALANCE,  0,"", "balance",  vtkm::testing::option::Arg::None, "  --balance  \t BenchmarkMPI only. Also split the volume so every rank gets about the same estimated number of active cells, and compare it to the equal split." },
+  {PHASES,  0,"", "phases",  vtkm::testing::option::Arg::None, "  --phases  \t Time every phase of the VTK-m isosurfaces, e.g. classify, scan and generate, and report their share of each trial." },
+  {TRACE,  0,"", "trace",  vtkm::testing::option::Arg::Optional, "  --trace  \t Write the phases of every thread as a Chrome trace JSON file, for chrome://tracing or ui.perfetto.dev. Implies --phases." },
+  {RESULTS,  0,"", "results",  vtkm::testing::option::Arg::Optional, "  --results  \t File to append a record per trial and per benchmark to, as CSV if it ends in .csv and JSON lines otherwise." },
+  {TRIALS,  0,"", "trials",  vtkm::testing::option::Arg::Optional, "  --trials  \t Number of timed trials per benchmark, the least number of them with --precision. 10 by default." },
+  {PRECISION,  0,"", "precision",  vtkm::testing::option::Arg::Optional, "  --precision  \t Keep running trials until the 95% confidence interval of the median is within this percent of it." },
+  {TIME_BUDGET,  0,"", "time-budget",  vtkm::testing::option::Arg::Optional, "  --time-budget  \t Seconds of trials per benchmark after which --precision gives up. 60 by default." },
+  {SAVE_BASELINE,  0,"", "save-baseline",  vtkm::testing::option::Arg::Optional, "  --save-baseline  \t Save the trial times of every benchmark as the baseline of this name." },
+  {BASELINE,  0,"", "baseline",  vtkm::testing::option::Arg::Optional, "  --baseline  \t Compare every benchmark against the baseline of this name, exits with 2 on a significant slowdown." },
+  {REGRESSION_THRESHOLD,  0,"", "regression-threshold",  vtkm::testing::option::Arg::Optional, "  --regression-threshold  \t Slowdown of the median, in percent, that counts as a regression when significant. 5 by default." },
+  {SIGNIFICANCE,  0,"", "significance",  vtkm::testing::option::Arg::Optional, "  --significance  \t p-value of the Mann-Whitney U test below which a change is significant. 0.05 by default." },
   {UNKNOWN,   0,"",  "",         vtkm::testing::option::Arg::None, "\nExample:\n"
-                                                                   " example --file=./test --pipeline=1\n"},
+                                                                   " example --file=./test --pipeline=1\n"
+                                                                   " example --file=./test --algorithms=vtkm,vtk --isolate\n"
+                                                                   " example --synthetic=tangle --dims=512\n"
+                                                                   " example --file=./test --stream=16,64,256\n"
+                                                                   " example --file=./test --weld --trace=iso.json\n"
+                                                                   " example --file=./test --cores=-1 --pin --huge-pages=thp\n"
+                                                                   " mpirun -np 4 BenchmarkMPI --file=./test --ranks=1,2,4 --cores=-1 --balance\n"
+                                                                   " example --file=./test --baseline=vtkm-1.0 --regression-threshold=3\n"},
   {0,0,0,0,0,0}
 };
 
@@ -42,10 +76,32 @@ const vtkm::testing::option::Descriptor usage[] =
 //-----------------------------------------------------------------------------
 vtkm::testing::ArgumentsParser::ArgumentsParser():
   File(""),
+  Synthetic(""),
+  Dims(128),
+  Implicit(false),
   WriteLocation(""),
+  ResultsFile(""),
   IsoValue(0.0f),
   Ratio(1.0),
-  Cores(0)
+  Cores(0),
+  BrickSize(0),
+  Weld(false),
+  Balance(false),
+  Counters(false),
+  Numa(false),
+  HugePages(""),
+  Pin(false),
+  Pipeline(2),
+  Isolate(false),
+  Phases(false),
+  TraceFile(""),
+  SaveBaseline(""),
+  Baseline(""),
+  RegressionThreshold(5.0),
+  Significance(0.05),
+  Trials(0),
+  Precision(0.0),
+  TimeBudget(60.0)
 {
 }
 
@@ -89,6 +145,25 @@ bool vtkm::testing::ArgumentsParser::parseArguments(int argc, char* argv[])
     argstream >> this->File;
     }
 
+  if ( options[SYNTHETIC] )
+    {
+    std::string sarg(options[SYNTHETIC].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->Synthetic;
+    }
+
+  if ( options[DIMS] )
+    {
+    std::string sarg(options[DIMS].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->Dims;
+    }
+
+  if ( options[IMPLICIT] )
+    {
+    this->Implicit = true;
+    }
+
   if ( options[WRITE_LOC] )
     {
     std::string sarg(options[WRITE_LOC].last()->arg);
@@ -103,6 +178,18 @@ bool vtkm::testing::ArgumentsParser::parseArguments(int argc, char* argv[])
     argstream >> this->IsoValue;
     }
 
+  if ( options[ISO_VALUES] )
+    {
+    std::string sarg(options[ISO_VALUES].last()->arg);
+    std::replace(sarg.begin(), sarg.end(), ',', ' ');
+    std::stringstream argstream(sarg);
+    float value;
+    while(argstream >> value)
+      {
+      this->IsoValues.push_back(value);
+      }
+    }
+
   if ( options[CORES] )
     {
     std::string sarg(options[CORES].last()->arg);
@@ -117,6 +204,163 @@ bool vtkm::testing::ArgumentsParser::parseArguments(int argc, char* argv[])
     argstream >> this->Ratio;
     }
 
+  if ( options[RESULTS] )
+    {
+    std::string sarg(options[RESULTS].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->ResultsFile;
+    }
+
+  if ( options[BRICKS] )
+    {
+    std::string sarg(options[BRICKS].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->BrickSize;
+    }
+
+  if ( options[WELD] )
+    {
+    this->Weld = true;
+    }
+
+  if ( options[STREAM] )
+    {
+    std::string sarg(options[STREAM].last()->arg);
+    std::replace(sarg.begin(), sarg.end(), ',', ' ');
+    std::stringstream argstream(sarg);
+    int value;
+    while(argstream >> value)
+      {
+      this->SlabSizes.push_back(value);
+      }
+    }
+
+  if ( options[RANKS] )
+    {
+    std::string sarg(options[RANKS].last()->arg);
+    std::replace(sarg.begin(), sarg.end(), ',', ' ');
+    std::stringstream argstream(sarg);
+    int value;
+    while(argstream >> value)
+      {
+      this->RankCounts.push_back(value);
+      }
+    }
+
+  if ( options[BALANCE] )
+    {
+    this->Balance = true;
+    }
+
+  if ( options[COUNTERS] )
+    {
+    this->Counters = true;
+    }
+
+  if ( options[NUMA] )
+    {
+    this->Numa = true;
+    }
+
+  if ( options[HUGE_PAGES] )
+    {
+    std::string sarg(options[HUGE_PAGES].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->HugePages;
+    this->Numa = true;
+    }
+
+  if ( options[PIN] )
+    {
+    this->Pin = true;
+    }
+
+  if ( options[PIPELINE] )
+    {
+    std::string sarg(options[PIPELINE].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->Pipeline;
+    }
+
+  if ( options[ALGORITHMS] )
+    {
+    std::string sarg(options[ALGORITHMS].last()->arg);
+    std::replace(sarg.begin(), sarg.end(), ',', ' ');
+    std::stringstream argstream(sarg);
+    std::string value;
+    while(argstream >> value)
+      {
+      this->Algorithms.push_back(value);
+      }
+    }
+
+  if ( options[ISOLATE] )
+    {
+    this->Isolate = true;
+    }
+
+  if ( options[PHASES] )
+    {
+    this->Phases = true;
+    }
+
+  if ( options[TRACE] )
+    {
+    std::string sarg(options[TRACE].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->TraceFile;
+    this->Phases = true;
+    }
+
+  if ( options[TRIALS] )
+    {
+    std::string sarg(options[TRIALS].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->Trials;
+    }
+
+  if ( options[PRECISION] )
+    {
+    std::string sarg(options[PRECISION].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->Precision;
+    }
+
+  if ( options[TIME_BUDGET] )
+    {
+    std::string sarg(options[TIME_BUDGET].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->TimeBudget;
+    }
+
+  if ( options[SAVE_BASELINE] )
+    {
+    std::string sarg(options[SAVE_BASELINE].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->SaveBaseline;
+    }
+
+  if ( options[BASELINE] )
+    {
+    std::string sarg(options[BASELINE].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->Baseline;
+    }
+
+  if ( options[REGRESSION_THRESHOLD] )
+    {
+    std::string sarg(options[REGRESSION_THRESHOLD].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->RegressionThreshold;
+    }
+
+  if ( options[SIGNIFICANCE] )
+    {
+    std::string sarg(options[SIGNIFICANCE].last()->arg);
+    std::stringstream argstream(sarg);
+    argstream >> this->Significance;
+    }
+
   delete[] options;
   delete[] buffer;
   return true;
@@ -17,6 +17,7 @@
 #define __argumentsParser_h
 
 #include <string>
+#include <vector>
 
 namespace vtkm { namespace testing {
 
@@ -31,9 +32,21 @@ public:
   std::string file() const
     { return this->File; }
 
+  std::string synthetic() const
+    { return this->Synthetic; }
+
+  int dims() const
+    { return this->Dims; }
+
+  bool implicit() const
+    { return this->Implicit; }
+
   float isovalue() const
     { return this->IsoValue; }
 
+  const std::vector<float>& isovalues() const
+    { return this->IsoValues; }
+
   double ratio() const
     { return this->Ratio; }
 
@@ -43,12 +56,104 @@ public:
   std::string writeLocation() const
     { return this->WriteLocation; }
 
+  int brickSize() const
+    { return this->BrickSize; }
+
+  bool weld() const
+    { return this->Weld; }
+
+  std::string resultsFile() const
+    { return this->ResultsFile; }
+
+  const std::vector<int>& slabSizes() const
+    { return this->SlabSizes; }
+
+  const std::vector<int>& rankCounts() const
+    { return this->RankCounts; }
+
+  bool balance() const
+    { return this->Balance; }
+
+  bool counters() const
+    { return this->Counters; }
+
+  bool numa() const
+    { return this->Numa; }
+
+  std::string hugePages() const
+    { return this->HugePages; }
+
+  bool pin() const
+    { return this->Pin; }
+
+  int pipeline() const
+    { return this->Pipeline; }
+
+  const std::vector<std::string>& algorithms() const
+    { return this->Algorithms; }
+
+  bool isolate() const
+    { return this->Isolate; }
+
+  bool phases() const
+    { return this->Phases; }
+
+  std::string traceFile() const
+    { return this->TraceFile; }
+
+  std::string saveBaseline() const
+    { return this->SaveBaseline; }
+
+  std::string baseline() const
+    { return this->Baseline; }
+
+  double regressionThreshold() const
+    { return this->RegressionThreshold; }
+
+  double significance() const
+    { return this->Significance; }
+
+  int trials() const
+    { return this->Trials; }
+
+  double precision() const
+    { return this->Precision; }
+
+  double timeBudget() const
+    { return this->TimeBudget; }
+
 private:
   std::string File;
+  std::string Synthetic;
+  int Dims;
+  bool Implicit;
   std::string WriteLocation;
+  std::string ResultsFile;
   float IsoValue;
+  std::vector<float> IsoValues;
   double Ratio;
   int Cores;
+  int BrickSize;
+  bool Weld;
+  std::vector<int> SlabSizes;
+  std::vector<int> RankCounts;
+  bool Balance;
+  bool Counters;
+  bool Numa;
+  std::string HugePages;
+  bool Pin;
+  int Pipeline;
+  std::vector<std::string> Algorithms;
+  bool Isolate;
+  bool Phases;
+  std::string TraceFile;
+  std::string SaveBaseline;
+  std::string Baseline;
+  double RegressionThreshold;
+  double Significance;
+  int Trials;
+  double Precision;
+  double TimeBudget;
 };
 
 }}
@@ -0,0 +1,363 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __baseline_h
+#define __baseline_h
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "compare_runner.h"
+#include "ResultsSink.h"
+
+namespace bench
+{
+
+//file a baseline called name is stored in
+static std::string BaselinePath(const std::string& name)
+{
+  return name + ".baseline";
+}
+
+// The per trial samples of every benchmark of a run, saved under a name so
+// that later runs, e.g. against a newer VTK-m, can be compared to it. The
+// file is text: a few "key<TAB>value" lines describing the run, then one
+// "benchmark<TAB>device<TAB>cores<TAB>algorithm<TAB>samples" line per
+// benchmark with the samples separated by spaces.
+class Baseline
+{
+public:
+  Baseline():
+    IsoValue(0.0f)
+    {
+    for(int i=0; i < 3; ++i)
+      {
+      this->Dimensions[i] = 0;
+      }
+    }
+
+  void SetRunInfo(const RunInfo& info)
+  {
+    this->File = info.File;
+    this->Device = info.Device;
+    this->GitHash = info.GitHash;
+    this->IsoValue = info.IsoValue;
+    std::copy(info.Dimensions, info.Dimensions + 3, this->Dimensions);
+  }
+
+  void Add(const Result& result)
+  {
+    this->Samples[Key(this->Device, result.NumCores, result.Name)] = result.Samples;
+  }
+
+  //samples of a benchmark, NULL if the baseline doesn't have it
+  const std::vector<double>* Find(const std::string& device, int numCores,
+                                  const std::string& name) const
+  {
+    SampleMap::const_iterator i = this->Samples.find(Key(device, numCores, name));
+    return (i != this->Samples.end()) ? &i->second : NULL;
+  }
+
+  bool Save(const std::string& path, std::string& error) const
+  {
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+    if(!out)
+      {
+      error = "unable to write " + path;
+      return false;
+      }
+
+    out << "file\t" << this->File << "\n"
+        << "device\t" << this->Device << "\n"
+        << "git_hash\t" << this->GitHash << "\n"
+        << "isovalue\t" << std::setprecision(9) << this->IsoValue << "\n"
+        << "dims\t" << this->Dimensions[0] << " " << this->Dimensions[1]
+        << " " << this->Dimensions[2] << "\n";
+    for(SampleMap::const_iterator i = this->Samples.begin(); i != this->Samples.end(); ++i)
+      {
+      out << "benchmark\t" << i->first;
+      for(std::size_t j=0; j < i->second.size(); ++j)
+        {
+        out << (j > 0 ? " " : "\t") << std::setprecision(9) << i->second[j];
+        }
+      out << "\n";
+      }
+    out.flush();
+    if(!out)
+      {
+      error = "unable to write " + path;
+      return false;
+      }
+    return true;
+  }
+
+  bool Load(const std::string& path, std::string& error)
+  {
+    std::ifstream in(path.c_str());
+    if(!in)
+      {
+      error = "unable to read " + path;
+      return false;
+      }
+
+    std::string line;
+    while(std::getline(in, line))
+      {
+      const std::string::size_type tab = line.find('\t');
+      if(tab == std::string::npos)
+        {
+        continue;
+        }
+      const std::string key = line.substr(0, tab);
+      const std::string value = line.substr(tab + 1);
+      std::istringstream values(value);
+      if(key == "file")
+        {
+        this->File = value;
+        }
+      else if(key == "device")
+        {
+        this->Device = value;
+        }
+      else if(key == "git_hash")
+        {
+        this->GitHash = value;
+        }
+      else if(key == "isovalue")
+        {
+        values >> this->IsoValue;
+        }
+      else if(key == "dims")
+        {
+        values >> this->Dimensions[0] >> this->Dimensions[1] >> this->Dimensions[2];
+        }
+      else if(key == "benchmark")
+        {
+        //device, cores and algorithm are the key, the rest the samples
+        std::string::size_type end = value.find('\t');
+        for(int field=0; field < 2 && end != std::string::npos; ++field)
+          {
+          end = value.find('\t', end + 1);
+          }
+        if(end == std::string::npos)
+          {
+          error = "malformed benchmark line in " + path;
+          return false;
+          }
+        std::vector<double>& samples = this->Samples[value.substr(0, end)];
+        std::istringstream sampleStream(value.substr(end + 1));
+        double sample;
+        while(sampleStream >> sample)
+          {
+          samples.push_back(sample);
+          }
+        }
+      }
+    return true;
+  }
+
+  std::string File;
+  std::string Device;
+  std::string GitHash;
+  float IsoValue;
+  int Dimensions[3];
+
+private:
+  typedef std::map<std::string, std::vector<double> > SampleMap;
+
+  static std::string Key(const std::string& device, int numCores, const std::string& name)
+  {
+    std::ostringstream key;
+    key << device << "\t" << numCores << "\t" << name;
+    return key.str();
+  }
+
+  SampleMap Samples;
+};
+
+// Records the benchmarks of a run into a baseline to save, and compares
+// each of them against a loaded reference baseline as they finish. A
+// benchmark regressed when the Mann-Whitney U test finds its samples
+// significantly larger than the reference ones and its median is more
+// than the threshold slower.
+class BaselineCheck
+{
+public:
+  explicit BaselineCheck(const RunInfo& info):
+    Info(info),
+    Comparing(false),
+    ThresholdPercent(5.0),
+    Significance(0.05),
+    NumCompared(0),
+    NumRegressions(0)
+    {
+    this->Recorded.SetRunInfo(info);
+    }
+
+  //load the baseline called name to compare against
+  bool Load(const std::string& name, double thresholdPercent, double significance)
+  {
+    std::string error;
+    if(!this->Reference.Load(BaselinePath(name), error))
+      {
+      std::cerr << "unable to load baseline " << name << ": " << error << std::endl;
+      return false;
+      }
+    this->ReferenceName = name;
+    this->Comparing = true;
+    this->ThresholdPercent = thresholdPercent;
+    this->Significance = significance;
+
+    const bool sameDims = std::equal(this->Info.Dimensions, this->Info.Dimensions + 3,
+                                     this->Reference.Dimensions);
+    if(this->Reference.File != this->Info.File || !sameDims ||
+       this->Reference.IsoValue != this->Info.IsoValue)
+      {
+      std::cout << "warning: baseline " << name << " was recorded on "
+                << this->Reference.File << " ("
+                << this->Reference.Dimensions[0] << "x" << this->Reference.Dimensions[1]
+                << "x" << this->Reference.Dimensions[2] << ", isovalue "
+                << this->Reference.IsoValue << "), the comparison may not be meaningful"
+                << std::endl;
+      }
+    return true;
+  }
+
+  //start recording the run so that it can be saved as a baseline
+  void Record(const std::string& name)
+  {
+    this->RecordName = name;
+  }
+
+  void Add(const Result& result)
+  {
+    if(!this->RecordName.empty())
+      {
+      this->Recorded.Add(result);
+      }
+    if(!this->Comparing)
+      {
+      return;
+      }
+
+    const std::vector<double>* before =
+      this->Reference.Find(this->Info.Device, result.NumCores, result.Name);
+    if(!before || before->empty() || result.Samples.empty())
+      {
+      std::cout << "Baseline \'" << result.Name << "\' results:\n"
+                << "\tnot in baseline " << this->ReferenceName << std::endl;
+      return;
+      }
+
+    const stats::MannWhitneyResult test = stats::MannWhitneyU(*before, result.Samples);
+    const double beforeMedian = Median(*before);
+    const double afterMedian = Median(result.Samples);
+    const double change = (beforeMedian > 0.0) ?
+      (afterMedian / beforeMedian - 1.0) * 100.0 : 0.0;
+    const bool significant = test.p_value < this->Significance;
+    const bool regression = significant && test.effect_size > 0.0 &&
+                            change > this->ThresholdPercent;
+    const bool improvement = significant && test.effect_size < 0.0 &&
+                             -change > this->ThresholdPercent;
+
+    ++this->NumCompared;
+    if(regression)
+      {
+      ++this->NumRegressions;
+      std::ostringstream name;
+      name << result.Name << " (" << result.NumCores << " cores, "
+           << std::showpos << change << "%)";
+      this->Regressions.push_back(name.str());
+      }
+
+    std::cout << "Baseline \'" << result.Name << "\' results:\n"
+              << "\tbaseline = " << this->ReferenceName
+              << " (" << this->Reference.GitHash << ")\n"
+              << "\tbaseline median = " << beforeMedian << "s\n"
+              << "\tmedian = " << afterMedian << "s\n"
+              << "\tchange = " << change << "%\n"
+              << "\tmann-whitney U = " << test.u << "\n"
+              << "\tp-value = " << test.p_value << "\n"
+              << "\tcliff's delta = " << test.effect_size << "\n"
+              << "\tverdict = " << (regression ? "REGRESSION" :
+                                    (improvement ? "improvement" : "no significant change"))
+              << std::endl;
+  }
+
+  // Save the recorded baseline if one was asked for and print how the run
+  // compares to the reference. Returns false when anything regressed.
+  bool Finish()
+  {
+    if(!this->RecordName.empty())
+      {
+      std::string error;
+      if(this->Recorded.Save(BaselinePath(this->RecordName), error))
+        {
+        std::cout << "saved baseline " << this->RecordName << " to "
+                  << BaselinePath(this->RecordName) << std::endl;
+        }
+      else
+        {
+        std::cerr << "unable to save baseline " << this->RecordName << ": "
+                  << error << std::endl;
+        }
+      }
+
+    if(!this->Comparing)
+      {
+      return true;
+      }
+
+    std::cout << "Regression check against \'" << this->ReferenceName << "\':\n"
+              << "\tbenchmarks compared = " << this->NumCompared << "\n"
+              << "\tthreshold = " << this->ThresholdPercent << "%\n"
+              << "\tsignificance = " << this->Significance << "\n"
+              << "\tregressions = " << this->NumRegressions << "\n";
+    for(std::size_t i=0; i < this->Regressions.size(); ++i)
+      {
+      std::cout << "\t\t" << this->Regressions[i] << "\n";
+      }
+    std::cout.flush();
+    return this->NumRegressions == 0;
+  }
+
+private:
+  BaselineCheck(const BaselineCheck&);
+  void operator=(const BaselineCheck&);
+
+  RunInfo Info;
+
+  std::string RecordName;
+  Baseline Recorded;
+
+  bool Comparing;
+  std::string ReferenceName;
+  Baseline Reference;
+  double ThresholdPercent;
+  double Significance;
+  int NumCompared;
+  int NumRegressions;
+  std::vector<std::string> Regressions;
+};
+
+}
+
+#endif
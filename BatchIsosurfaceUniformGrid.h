@@ -0,0 +1,411 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __batchIsosurfaceUniformGrid_h
+#define __batchIsosurfaceUniformGrid_h
+
+#include <vtkm/Types.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/cont/DeviceAdapterAlgorithm.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/MarchingCubesDataTables.h>
+#include <vtkm/worklet/WorkletMapField.h>
+
+#include <cmath>
+#include <vector>
+
+#include "MarchingCubesHelpers.h"
+#include "PhaseTrace.h"
+#include "ScalarTypes.h"
+
+namespace bench
+{
+
+// Marching cubes on a uniform grid for several isovalues at once. Each
+// pass over the cells loads the 8 vertex values of a cell a single time
+// and classifies them against every isovalue, instead of running the
+// whole filter once per isovalue. The triangle soups of all isovalues are
+// written to the same arrays, one isovalue after the other.
+//
+// Only cells cut by at least one isovalue are kept after the first pass,
+// so the per cell and isovalue vertex counts and offsets are only stored
+// for those.
+//
+// FieldType is the type the field is stored in, isovalues and
+// interpolation are in its ScalarTraits::ComputeType and the points and
+// normals are single precision.
+template<typename FieldType, typename DeviceAdapter>
+class BatchIsosurfaceUniformGrid
+{
+public:
+  typedef typename ScalarTraits<FieldType>::ComputeType ComputeType;
+  typedef vtkm::Vec<vtkm::Float32,3> PointType;
+  typedef typename vtkm::cont::ArrayHandle<FieldType>::template ExecutionTypes<DeviceAdapter>::PortalConst FieldPortalType;
+  typedef typename vtkm::cont::ArrayHandle<ComputeType>::template ExecutionTypes<DeviceAdapter>::PortalConst IsovaluePortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::IdComponent>::template ExecutionTypes<DeviceAdapter>::PortalConst TablePortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::Id>::template ExecutionTypes<DeviceAdapter>::PortalConst IdPortalConstType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::Id>::template ExecutionTypes<DeviceAdapter>::Portal IdPortalType;
+  typedef typename vtkm::cont::ArrayHandle<PointType>::template ExecutionTypes<DeviceAdapter>::Portal VecPortalType;
+
+  //values at the 8 vertices of a cell
+  static VTKM_EXEC_EXPORT void CellValues(const FieldPortalType& field,
+                                          const vtkm::Id pointIds[8],
+                                          FieldType values[8])
+  {
+    for(vtkm::IdComponent i=0; i < 8; ++i)
+      {
+      values[i] = field.Get(pointIds[i]);
+      }
+  }
+
+  //number of vertices a cell generates summed over all isovalues
+  class ClassifyCell : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> cellId, FieldOut<IdType> numVertices);
+    typedef _2 ExecutionSignature(_1);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    ClassifyCell(const FieldPortalType& field,
+                 const IsovaluePortalType& isovalues,
+                 const TablePortalType& numVerticesTable,
+                 const vtkm::Id3& pointDims):
+      Field(field),
+      Isovalues(isovalues),
+      NumVerticesTable(numVerticesTable),
+      PointDims(pointDims)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    vtkm::Id operator()(vtkm::Id cellId) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      vtkm::Id pointIds[8];
+      FieldType values[8];
+      mc::CellPointIds(cellId, this->PointDims, pointIds);
+      CellValues(this->Field, pointIds, values);
+
+      vtkm::Id numVertices = 0;
+      for(vtkm::Id i=0; i < this->Isovalues.GetNumberOfValues(); ++i)
+        {
+        numVertices += this->NumVerticesTable.Get(mc::CaseNumber(values, this->Isovalues.Get(i)));
+        }
+      return numVertices;
+    }
+
+  private:
+    FieldPortalType Field;
+    IsovaluePortalType Isovalues;
+    TablePortalType NumVerticesTable;
+    vtkm::Id3 PointDims;
+  };
+
+  // Number of vertices active cell a generates for isovalue k, stored at
+  // k * numActiveCells + a so that the vertices of each isovalue end up
+  // contiguous once scanned
+  class CountVertices : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> activeIndex);
+    typedef void ExecutionSignature(_1);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    CountVertices(const FieldPortalType& field,
+                  const IsovaluePortalType& isovalues,
+                  const TablePortalType& numVerticesTable,
+                  const IdPortalConstType& activeCells,
+                  const IdPortalType& counts,
+                  const vtkm::Id3& pointDims):
+      Field(field),
+      Isovalues(isovalues),
+      NumVerticesTable(numVerticesTable),
+      ActiveCells(activeCells),
+      Counts(counts),
+      PointDims(pointDims)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id activeIndex) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      vtkm::Id pointIds[8];
+      FieldType values[8];
+      mc::CellPointIds(this->ActiveCells.Get(activeIndex), this->PointDims, pointIds);
+      CellValues(this->Field, pointIds, values);
+
+      const vtkm::Id numActive = this->ActiveCells.GetNumberOfValues();
+      for(vtkm::Id i=0; i < this->Isovalues.GetNumberOfValues(); ++i)
+        {
+        const vtkm::IdComponent caseNumber = mc::CaseNumber(values, this->Isovalues.Get(i));
+        this->Counts.Set(i * numActive + activeIndex, this->NumVerticesTable.Get(caseNumber));
+        }
+    }
+
+  private:
+    FieldPortalType Field;
+    IsovaluePortalType Isovalues;
+    TablePortalType NumVerticesTable;
+    IdPortalConstType ActiveCells;
+    IdPortalType Counts;
+    vtkm::Id3 PointDims;
+  };
+
+  // Generates the triangles of an active cell for every isovalue. The
+  // vertex values and gradients of the cell are computed once and shared
+  // by all isovalues.
+  class GenerateTriangles : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> activeIndex);
+    typedef void ExecutionSignature(_1);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    GenerateTriangles(const FieldPortalType& field,
+                      const IsovaluePortalType& isovalues,
+                      const TablePortalType& numVerticesTable,
+                      const TablePortalType& triangleTable,
+                      const IdPortalConstType& activeCells,
+                      const IdPortalConstType& offsets,
+                      const VecPortalType& vertices,
+                      const VecPortalType& normals,
+                      const vtkm::Id3& pointDims):
+      Field(field),
+      Isovalues(isovalues),
+      NumVerticesTable(numVerticesTable),
+      TriangleTable(triangleTable),
+      ActiveCells(activeCells),
+      Offsets(offsets),
+      Vertices(vertices),
+      Normals(normals),
+      PointDims(pointDims)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id activeIndex) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      const vtkm::Id cellId = this->ActiveCells.Get(activeIndex);
+      vtkm::Id cellIjk[3];
+      vtkm::Id pointIds[8];
+      FieldType values[8];
+      mc::CellIjk(cellId, this->PointDims, cellIjk);
+      mc::CellPointIds(cellId, this->PointDims, pointIds);
+      CellValues(this->Field, pointIds, values);
+
+      vtkm::Vec<ComputeType,3> gradients[8];
+      for(vtkm::IdComponent v=0; v < 8; ++v)
+        {
+        vtkm::Id offset[3];
+        mc::VertexOffset(v, offset);
+        const vtkm::Id ijk[3] = { cellIjk[0] + offset[0],
+                                  cellIjk[1] + offset[1],
+                                  cellIjk[2] + offset[2] };
+        gradients[v] = mc::PointGradient<ComputeType>(this->Field, this->PointDims, ijk, pointIds[v]);
+        }
+
+      const vtkm::Id numActive = this->ActiveCells.GetNumberOfValues();
+      for(vtkm::Id i=0; i < this->Isovalues.GetNumberOfValues(); ++i)
+        {
+        const ComputeType isovalue = this->Isovalues.Get(i);
+        const vtkm::IdComponent caseNumber = mc::CaseNumber(values, isovalue);
+        const vtkm::IdComponent numVertices = this->NumVerticesTable.Get(caseNumber);
+        const vtkm::Id outputOffset = this->Offsets.Get(i * numActive + activeIndex);
+
+        for(vtkm::IdComponent v=0; v < numVertices; ++v)
+          {
+          const vtkm::IdComponent edge = this->TriangleTable.Get(caseNumber*16 + v);
+          vtkm::IdComponent v0, v1;
+          mc::EdgeVertices(edge, v0, v1);
+
+          const ComputeType f0 = static_cast<ComputeType>(values[v0]);
+          const ComputeType f1 = static_cast<ComputeType>(values[v1]);
+          const ComputeType t = (f1 != f0) ? (isovalue - f0) / (f1 - f0) : ComputeType(0.5);
+
+          vtkm::Id offset0[3], offset1[3];
+          mc::VertexOffset(v0, offset0);
+          mc::VertexOffset(v1, offset1);
+
+          vtkm::Vec<ComputeType,3> vertex;
+          vtkm::Vec<ComputeType,3> normal;
+          ComputeType length = 0;
+          for(int c=0; c < 3; ++c)
+            {
+            const ComputeType p0 = static_cast<ComputeType>(cellIjk[c] + offset0[c]);
+            const ComputeType p1 = static_cast<ComputeType>(cellIjk[c] + offset1[c]);
+            vertex[c] = p0 + t * (p1 - p0);
+            normal[c] = gradients[v0][c] + t * (gradients[v1][c] - gradients[v0][c]);
+            length += normal[c] * normal[c];
+            }
+          length = std::sqrt(length);
+          if(length > 0)
+            {
+            for(int c=0; c < 3; ++c)
+              {
+              normal[c] /= length;
+              }
+            }
+
+          this->Vertices.Set(outputOffset + v, mc::ToPoint(vertex));
+          this->Normals.Set(outputOffset + v, mc::ToPoint(normal));
+          }
+        }
+    }
+
+  private:
+    FieldPortalType Field;
+    IsovaluePortalType Isovalues;
+    TablePortalType NumVerticesTable;
+    TablePortalType TriangleTable;
+    IdPortalConstType ActiveCells;
+    IdPortalConstType Offsets;
+    VecPortalType Vertices;
+    VecPortalType Normals;
+    vtkm::Id3 PointDims;
+  };
+
+  BatchIsosurfaceUniformGrid(const vtkm::Id3& pointDims):
+    PointDims(pointDims),
+    NumVerticesTable(vtkm::cont::make_ArrayHandle(vtkm::worklet::internal::numVerticesTable, 256)),
+    TriangleTable(vtkm::cont::make_ArrayHandle(vtkm::worklet::internal::triTable, 256*16))
+    {
+    }
+
+  // Contour field at every value of isovalues. vertices and normals get 3
+  // entries per triangle; the ones of isovalues[k] are in the range
+  // [isoOffsets[k], isoOffsets[k+1]).
+  void Run(const std::vector<ComputeType>& isovalues,
+           const vtkm::cont::ArrayHandle<FieldType>& field,
+           vtkm::cont::ArrayHandle<PointType>& vertices,
+           vtkm::cont::ArrayHandle<PointType>& normals,
+           std::vector<vtkm::Id>& isoOffsets)
+  {
+    const vtkm::Id numCells =
+      (this->PointDims[0]-1) * (this->PointDims[1]-1) * (this->PointDims[2]-1);
+    this->RunOnCells(isovalues, field,
+                     vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numCells),
+                     vertices, normals, isoOffsets);
+  }
+
+  // Same as Run but only the cells listed in cellIds are visited, e.g. the
+  // cells of the bricks an acceleration index says can be cut
+  template<typename CellIdArrayType>
+  void RunOnCells(const std::vector<ComputeType>& isovalues,
+                  const vtkm::cont::ArrayHandle<FieldType>& field,
+                  const CellIdArrayType& cellIds,
+                  vtkm::cont::ArrayHandle<PointType>& vertices,
+                  vtkm::cont::ArrayHandle<PointType>& normals,
+                  std::vector<vtkm::Id>& isoOffsets)
+  {
+    typedef vtkm::cont::DeviceAdapterAlgorithm<DeviceAdapter> Algorithm;
+
+    const vtkm::Id numIsovalues = static_cast<vtkm::Id>(isovalues.size());
+    isoOffsets.assign(isovalues.size() + 1, 0);
+    if(numIsovalues == 0 || cellIds.GetNumberOfValues() == 0)
+      {
+      vertices.Allocate(0);
+      normals.Allocate(0);
+      return;
+      }
+
+    vtkm::cont::ArrayHandle<ComputeType> isovalueArray =
+      vtkm::cont::make_ArrayHandle(&isovalues[0], numIsovalues);
+
+    const FieldPortalType fieldPortal = field.PrepareForInput(DeviceAdapter());
+    const IsovaluePortalType isovaluePortal = isovalueArray.PrepareForInput(DeviceAdapter());
+    const TablePortalType numVerticesPortal = this->NumVerticesTable.PrepareForInput(DeviceAdapter());
+
+    //1. find the cells cut by at least one isovalue
+    vtkm::cont::ArrayHandle<vtkm::Id> numVerticesPerCell;
+    {
+    ScopedDevicePhase<Algorithm> phase("classify");
+    ClassifyCell classify(fieldPortal, isovaluePortal, numVerticesPortal, this->PointDims);
+    vtkm::worklet::DispatcherMapField<ClassifyCell, DeviceAdapter> classifyDispatcher(classify);
+    classifyDispatcher.Invoke(cellIds, numVerticesPerCell);
+    }
+
+    vtkm::cont::ArrayHandle<vtkm::Id> activeCells;
+    {
+    ScopedDevicePhase<Algorithm> phase("compact");
+    Algorithm::StreamCompact(cellIds, numVerticesPerCell, activeCells);
+    numVerticesPerCell.ReleaseResources();
+    }
+
+    const vtkm::Id numActive = activeCells.GetNumberOfValues();
+    if(numActive == 0)
+      {
+      vertices.Allocate(0);
+      normals.Allocate(0);
+      return;
+      }
+    const IdPortalConstType activePortal = activeCells.PrepareForInput(DeviceAdapter());
+
+    //2. vertices of each active cell per isovalue, and where they go
+    vtkm::cont::ArrayHandle<vtkm::Id> counts;
+    {
+    ScopedDevicePhase<Algorithm> phase("count");
+    CountVertices count(fieldPortal, isovaluePortal, numVerticesPortal, activePortal,
+                        counts.PrepareForOutput(numIsovalues * numActive, DeviceAdapter()),
+                        this->PointDims);
+    vtkm::worklet::DispatcherMapField<CountVertices, DeviceAdapter> countDispatcher(count);
+    countDispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numActive));
+    }
+
+    vtkm::cont::ArrayHandle<vtkm::Id> offsets;
+    vtkm::Id numOutputVertices = 0;
+    {
+    ScopedDevicePhase<Algorithm> phase("scan");
+    numOutputVertices = Algorithm::ScanExclusive(counts, offsets);
+    counts.ReleaseResources();
+    }
+
+    {
+    typename vtkm::cont::ArrayHandle<vtkm::Id>::PortalConstControl offsetPortal =
+      offsets.GetPortalConstControl();
+    for(vtkm::Id i=0; i < numIsovalues; ++i)
+      {
+      isoOffsets[static_cast<std::size_t>(i)] = offsetPortal.Get(i * numActive);
+      }
+    isoOffsets.back() = numOutputVertices;
+    }
+
+    //3. generate the triangles of every isovalue
+    ScopedDevicePhase<Algorithm> phase("generate");
+    GenerateTriangles generate(fieldPortal, isovaluePortal, numVerticesPortal,
+                               this->TriangleTable.PrepareForInput(DeviceAdapter()),
+                               activePortal,
+                               offsets.PrepareForInput(DeviceAdapter()),
+                               vertices.PrepareForOutput(numOutputVertices, DeviceAdapter()),
+                               normals.PrepareForOutput(numOutputVertices, DeviceAdapter()),
+                               this->PointDims);
+    vtkm::worklet::DispatcherMapField<GenerateTriangles, DeviceAdapter> generateDispatcher(generate);
+    generateDispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numActive));
+  }
+
+private:
+  vtkm::Id3 PointDims;
+  vtkm::cont::ArrayHandle<vtkm::IdComponent> NumVerticesTable;
+  vtkm::cont::ArrayHandle<vtkm::IdComponent> TriangleTable;
+};
+
+}
+
+#endif
@@ -0,0 +1,320 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __brickRangeIndex_h
+#define __brickRangeIndex_h
+
+#include <vtkm/Types.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/cont/ArrayHandleImplicit.h>
+#include <vtkm/cont/DeviceAdapterAlgorithm.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/WorkletMapField.h>
+
+#include "PhaseTrace.h"
+#include "ScalarTypes.h"
+
+namespace bench
+{
+
+// Min/max summary of a point field on a uniform grid, per brick of
+// BrickSize^3 cells. A brick can only hold cells cut by an isovalue when
+// min <= isovalue < max (the classification of marching cubes is
+// value > isovalue), so a query returns the cells of those bricks only and
+// the rest of the volume is never visited. The index is built once per
+// field and can be queried for any number of isovalues. The ranges are
+// kept in the type of the field, so the index of a 8 bit volume is a
+// quarter of the one of a float volume.
+template<typename FieldType, typename DeviceAdapter>
+class BrickRangeIndex
+{
+public:
+  typedef typename ScalarTraits<FieldType>::ComputeType ComputeType;
+  typedef typename vtkm::cont::ArrayHandle<FieldType>::template ExecutionTypes<DeviceAdapter>::PortalConst FieldPortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::Id>::template ExecutionTypes<DeviceAdapter>::PortalConst IdPortalConstType;
+
+  //first and one past the last cell of a brick along each axis
+  static VTKM_EXEC_EXPORT void BrickExtent(vtkm::Id brickId,
+                                           const vtkm::Id3& numBricks,
+                                           const vtkm::Id3& cellDims,
+                                           vtkm::Id brickSize,
+                                           vtkm::Id begin[3],
+                                           vtkm::Id end[3])
+  {
+    const vtkm::Id brickIjk[3] = { brickId % numBricks[0],
+                                   (brickId / numBricks[0]) % numBricks[1],
+                                   brickId / (numBricks[0] * numBricks[1]) };
+    for(int i=0; i < 3; ++i)
+      {
+      begin[i] = brickIjk[i] * brickSize;
+      end[i] = (begin[i] + brickSize < cellDims[i]) ? begin[i] + brickSize : cellDims[i];
+      }
+  }
+
+  //min and max of the points of each brick, its cells' points included
+  class ComputeRange : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> brickId,
+                                  FieldOut<ScalarAll> min,
+                                  FieldOut<ScalarAll> max);
+    typedef void ExecutionSignature(_1, _2, _3);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    ComputeRange(const FieldPortalType& field,
+                 const vtkm::Id3& pointDims,
+                 const vtkm::Id3& numBricks,
+                 vtkm::Id brickSize):
+      Field(field),
+      PointDims(pointDims),
+      NumBricks(numBricks),
+      BrickSize(brickSize)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id brickId, FieldType& min, FieldType& max) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      const vtkm::Id3 cellDims(this->PointDims[0]-1, this->PointDims[1]-1, this->PointDims[2]-1);
+      vtkm::Id begin[3], end[3];
+      BrickExtent(brickId, this->NumBricks, cellDims, this->BrickSize, begin, end);
+
+      min = max = this->Field.Get(begin[0] + this->PointDims[0] * (begin[1] + this->PointDims[1] * begin[2]));
+      for(vtkm::Id k=begin[2]; k <= end[2]; ++k)
+        {
+        for(vtkm::Id j=begin[1]; j <= end[1]; ++j)
+          {
+          const vtkm::Id row = this->PointDims[0] * (j + this->PointDims[1] * k);
+          for(vtkm::Id i=begin[0]; i <= end[0]; ++i)
+            {
+            const FieldType value = this->Field.Get(row + i);
+            min = (value < min) ? value : min;
+            max = (value > max) ? value : max;
+            }
+          }
+        }
+    }
+
+  private:
+    FieldPortalType Field;
+    vtkm::Id3 PointDims;
+    vtkm::Id3 NumBricks;
+    vtkm::Id BrickSize;
+  };
+
+  //number of cells of a brick that can be cut by the isovalue, 0 otherwise
+  class CountActiveCells : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> brickId,
+                                  FieldIn<ScalarAll> min,
+                                  FieldIn<ScalarAll> max,
+                                  FieldOut<IdType> numCells);
+    typedef _4 ExecutionSignature(_1, _2, _3);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    CountActiveCells(const vtkm::Id3& cellDims,
+                     const vtkm::Id3& numBricks,
+                     vtkm::Id brickSize,
+                     ComputeType isovalue):
+      CellDims(cellDims),
+      NumBricks(numBricks),
+      BrickSize(brickSize),
+      Isovalue(isovalue)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    vtkm::Id operator()(vtkm::Id brickId, FieldType min, FieldType max) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      if(!(static_cast<ComputeType>(min) <= this->Isovalue &&
+           this->Isovalue < static_cast<ComputeType>(max)))
+        {
+        return 0;
+        }
+      vtkm::Id begin[3], end[3];
+      BrickExtent(brickId, this->NumBricks, this->CellDims, this->BrickSize, begin, end);
+      return (end[0] - begin[0]) * (end[1] - begin[1]) * (end[2] - begin[2]);
+    }
+
+  private:
+    vtkm::Id3 CellDims;
+    vtkm::Id3 NumBricks;
+    vtkm::Id BrickSize;
+    ComputeType Isovalue;
+  };
+
+  // Id of the cell at a position of the list of the cells of the active
+  // bricks, brick after brick. The list is never written: the brick of a
+  // position is found by a binary search of where the cells of each
+  // active brick start, so classifying the cells of a query reads the ids
+  // from two arrays as long as the active bricks instead of one as long
+  // as their cells.
+  class ActiveCellId
+  {
+  public:
+    VTKM_EXEC_CONT_EXPORT
+    ActiveCellId():
+      BrickSize(1)
+      {
+      }
+
+    VTKM_CONT_EXPORT
+    ActiveCellId(const IdPortalConstType& bricks,
+                 const IdPortalConstType& offsets,
+                 const vtkm::Id3& cellDims,
+                 const vtkm::Id3& numBricks,
+                 vtkm::Id brickSize):
+      Bricks(bricks),
+      Offsets(offsets),
+      CellDims(cellDims),
+      NumBricks(numBricks),
+      BrickSize(brickSize)
+      {
+      }
+
+    VTKM_EXEC_CONT_EXPORT
+    vtkm::Id operator()(vtkm::Id index) const
+    {
+      //the last active brick whose cells start at or before index
+      vtkm::Id low = 0;
+      vtkm::Id high = this->Offsets.GetNumberOfValues() - 1;
+      while(low < high)
+        {
+        const vtkm::Id middle = (low + high + 1) / 2;
+        if(this->Offsets.Get(middle) <= index)
+          {
+          low = middle;
+          }
+        else
+          {
+          high = middle - 1;
+          }
+        }
+
+      vtkm::Id begin[3], end[3];
+      BrickExtent(this->Bricks.Get(low), this->NumBricks, this->CellDims, this->BrickSize,
+                  begin, end);
+      const vtkm::Id local = index - this->Offsets.Get(low);
+      const vtkm::Id width = end[0] - begin[0];
+      const vtkm::Id height = end[1] - begin[1];
+      const vtkm::Id i = begin[0] + local % width;
+      const vtkm::Id j = begin[1] + (local / width) % height;
+      const vtkm::Id k = begin[2] + local / (width * height);
+      return i + this->CellDims[0] * (j + this->CellDims[1] * k);
+    }
+
+  private:
+    IdPortalConstType Bricks;
+    IdPortalConstType Offsets;
+    vtkm::Id3 CellDims;
+    vtkm::Id3 NumBricks;
+    vtkm::Id BrickSize;
+  };
+
+  typedef vtkm::cont::ArrayHandleImplicit<vtkm::Id, ActiveCellId> CellIdArrayType;
+
+  //what a query keeps of the bricks whose range contains its isovalue
+  struct ActiveBricks
+  {
+    ActiveBricks():
+      NumCells(0)
+      {
+      }
+
+    vtkm::cont::ArrayHandle<vtkm::Id> Bricks;
+    //where the cells of each brick start in the list of their cells
+    vtkm::cont::ArrayHandle<vtkm::Id> Offsets;
+    vtkm::Id NumCells;
+  };
+
+  BrickRangeIndex(const vtkm::Id3& pointDims, vtkm::Id brickSize):
+    PointDims(pointDims),
+    CellDims(pointDims[0]-1, pointDims[1]-1, pointDims[2]-1),
+    BrickSize(brickSize > 0 ? brickSize : 1)
+    {
+    for(int i=0; i < 3; ++i)
+      {
+      this->NumBricks[i] = (this->CellDims[i] + this->BrickSize - 1) / this->BrickSize;
+      }
+    }
+
+  vtkm::Id GetBrickSize() const
+    { return this->BrickSize; }
+
+  vtkm::Id GetNumberOfBricks() const
+    { return this->NumBricks[0] * this->NumBricks[1] * this->NumBricks[2]; }
+
+  //compute the range of every brick, one brick per thread
+  void Build(const vtkm::cont::ArrayHandle<FieldType>& field)
+  {
+    ComputeRange worklet(field.PrepareForInput(DeviceAdapter()),
+                         this->PointDims, this->NumBricks, this->BrickSize);
+    vtkm::worklet::DispatcherMapField<ComputeRange, DeviceAdapter> dispatcher(worklet);
+    dispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), this->GetNumberOfBricks()),
+                      this->Min, this->Max);
+  }
+
+  // Find every brick whose range contains isovalue and where its cells
+  // start in the list of their cells. Returns the number of those bricks.
+  vtkm::Id Query(ComputeType isovalue, ActiveBricks& active) const
+  {
+    typedef vtkm::cont::DeviceAdapterAlgorithm<DeviceAdapter> Algorithm;
+    ScopedDevicePhase<Algorithm> phase("brick query");
+
+    vtkm::cont::ArrayHandleCounting<vtkm::Id> brickIds =
+      vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), this->GetNumberOfBricks());
+
+    vtkm::cont::ArrayHandle<vtkm::Id> numCellsPerBrick;
+    CountActiveCells count(this->CellDims, this->NumBricks, this->BrickSize, isovalue);
+    vtkm::worklet::DispatcherMapField<CountActiveCells, DeviceAdapter> countDispatcher(count);
+    countDispatcher.Invoke(brickIds, this->Min, this->Max, numCellsPerBrick);
+
+    vtkm::cont::ArrayHandle<vtkm::Id> activeNumCells;
+    Algorithm::StreamCompact(brickIds, numCellsPerBrick, active.Bricks);
+    Algorithm::StreamCompact(numCellsPerBrick, numCellsPerBrick, activeNumCells);
+    active.NumCells = Algorithm::ScanExclusive(activeNumCells, active.Offsets);
+
+    return active.Bricks.GetNumberOfValues();
+  }
+
+  // The ids of the cells of the active bricks of a query, brick after
+  // brick, computed when they are read. active has to outlive the array.
+  CellIdArrayType GetCellIds(const ActiveBricks& active) const
+  {
+    return vtkm::cont::make_ArrayHandleImplicit<vtkm::Id>(
+      ActiveCellId(active.Bricks.PrepareForInput(DeviceAdapter()),
+                   active.Offsets.PrepareForInput(DeviceAdapter()),
+                   this->CellDims, this->NumBricks, this->BrickSize),
+      active.NumCells);
+  }
+
+private:
+  vtkm::Id3 PointDims;
+  vtkm::Id3 CellDims;
+  vtkm::Id3 NumBricks;
+  vtkm::Id BrickSize;
+  vtkm::cont::ArrayHandle<FieldType> Min;
+  vtkm::cont::ArrayHandle<FieldType> Max;
+};
+
+}
+
+#endif
@@ -0,0 +1,516 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __contenderRegistry_h
+#define __contenderRegistry_h
+
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ArgumentsParser.h"
+#include "compare_runner.h"
+#include "NrrdReader.h"
+#include "ScalarTypes.h"
+#include "SyntheticField.h"
+#include "Volume.h"
+
+namespace bench
+{
+
+//the filter --pipeline benchmarks, numbered as run.sh uses them
+enum PipelineType
+{
+  PIPELINE_THRESHOLD = 1,
+  PIPELINE_MARCHING_CUBES = 2
+};
+
+//what the contenders of a run read
+enum InputType
+{
+  //a volume in memory, read from a file or generated
+  INPUT_VOLUME,
+  //a synthetic field computed on access, --implicit
+  INPUT_IMPLICIT,
+  //a raw NRRD file read slab by slab, --stream
+  INPUT_STREAM
+};
+
+//the devices a contender runs on, or'ed together
+enum DeviceMask
+{
+  DEVICE_SERIAL = 1,
+  DEVICE_TBB = 2,
+  DEVICE_CUDA = 4,
+  DEVICE_ANY = DEVICE_SERIAL | DEVICE_TBB | DEVICE_CUDA
+};
+
+//the DeviceMask bit of a device name as RunComparison gets it, 0 if unknown
+static int DeviceMaskFromName(const std::string& device)
+{
+  if(device == "Serial") { return DEVICE_SERIAL; }
+  if(device == "TBB") { return DEVICE_TBB; }
+  if(device == "Cuda") { return DEVICE_CUDA; }
+  return 0;
+}
+
+struct ContenderContext;
+
+// Work on the input before a contender runs, on the threads of its core
+// count, e.g. placing the volume on the NUMA nodes of the threads that will
+// contour it. In the child of an isolated contender it is done there.
+class InputPreparation
+{
+public:
+  virtual ~InputPreparation() {}
+
+  //update the input of context for context.NumCores, false when that
+  //failed and the contender can't run
+  virtual bool Prepare(ContenderContext& context) = 0;
+};
+
+// Everything a contender may read to run at one core count. Only the
+// input of the InputType of the run is set, the others are NULL.
+struct ContenderContext
+{
+  ContenderContext():
+    Input(INPUT_VOLUME),
+    Pipeline(PIPELINE_MARCHING_CUBES),
+    Volume(NULL),
+    Image(NULL),
+    Header(NULL),
+    Field(NULL),
+    NumCores(1),
+    MaxNumCores(1),
+    IsoValue(0.0f),
+    Parser(NULL),
+    Options(NULL),
+    Preparation(NULL)
+    {
+    }
+
+  InputType Input;
+  int Pipeline;
+  //INPUT_VOLUME, the image shares its scalars with the volume
+  const bench::Volume* Volume;
+  vtkImageData* Image;
+  //INPUT_STREAM
+  const bench::NrrdHeader* Header;
+  //INPUT_IMPLICIT
+  const bench::SyntheticField* Field;
+  std::string Device;
+  int NumCores;
+  int MaxNumCores;
+  //the cpus of --pin in compact order, empty when threads aren't pinned
+  std::vector<int> PinnedCpus;
+  float IsoValue;
+  const vtkm::testing::ArgumentsParser* Parser;
+  const bench::RunnerOptions* Options;
+  //done before every run when not NULL
+  InputPreparation* Preparation;
+};
+
+// Gets every result of a contender as soon as the Run* function that made
+// it has returned and freed its state, which ends its teardown.
+class ResultCollector
+{
+public:
+  virtual ~ResultCollector() {}
+  virtual void Collect(const Result& result) = 0;
+};
+
+// An implementation compare benchmarks. Each result a contender collects
+// goes through the setup, trials and teardown of RunBenchmark with the
+// setup and kernel functors of the contender, Run only picks which to do.
+//
+// Variants of an implementation, e.g. the brick and welded VTK-m
+// isosurfaces, are contenders of their own sharing its name: --algorithms
+// selects them together, their option says whether they run, and with
+// --isolate each gets a process of its own.
+class Contender
+{
+public:
+  Contender(const std::string& name, int devices):
+    Name(name),
+    Devices(devices)
+    {
+    }
+
+  virtual ~Contender() {}
+
+  //what --algorithms selects the contender by, e.g. vtkm
+  const std::string& GetName() const
+    { return this->Name; }
+
+  bool SupportsDevice(const std::string& device) const
+    { return (this->Devices & DeviceMaskFromName(device)) != 0; }
+
+  //whether there is something to run for the pipeline, input and options
+  //of context, called before the input is loaded
+  virtual bool Accepts(const ContenderContext& context) const = 0;
+
+  //serial contenders are run once on a single core, whatever the sweep
+  virtual bool IsSerial() const
+    { return false; }
+
+  //benchmark at context.NumCores and hand every result to collector
+  virtual void Run(const ContenderContext& context, ResultCollector& collector) = 0;
+
+private:
+  std::string Name;
+  int Devices;
+};
+
+// The contenders of compare, in the order they registered in, which is
+// the order their headers are included in by compare_contenders.h
+class ContenderRegistry
+{
+public:
+  typedef std::vector< boost::shared_ptr<Contender> > ContenderList;
+
+  static ContenderRegistry& Instance()
+  {
+    static ContenderRegistry registry;
+    return registry;
+  }
+
+  //takes ownership of contender
+  void Add(Contender* contender)
+  {
+    this->Contenders.push_back(boost::shared_ptr<Contender>(contender));
+  }
+
+  //whether some contender is called name
+  bool Has(const std::string& name) const
+  {
+    for(std::size_t i=0; i < this->Contenders.size(); ++i)
+      {
+      if(this->Contenders[i]->GetName() == name)
+        {
+        return true;
+        }
+      }
+    return false;
+  }
+
+  //names of the contenders, each once, in registration order
+  std::vector<std::string> GetNames() const
+  {
+    std::vector<std::string> names;
+    for(std::size_t i=0; i < this->Contenders.size(); ++i)
+      {
+      const std::string& name = this->Contenders[i]->GetName();
+      if(std::find(names.begin(), names.end(), name) == names.end())
+        {
+        names.push_back(name);
+        }
+      }
+    return names;
+  }
+
+  //the contenders running on device that names lists, all of them when
+  //names is empty
+  ContenderList Select(const std::vector<std::string>& names,
+                       const std::string& device) const
+  {
+    ContenderList selected;
+    for(std::size_t i=0; i < this->Contenders.size(); ++i)
+      {
+      const Contender& contender = *this->Contenders[i];
+      if(contender.SupportsDevice(device) &&
+         (names.empty() ||
+          std::find(names.begin(), names.end(), contender.GetName()) != names.end()))
+        {
+        selected.push_back(this->Contenders[i]);
+        }
+      }
+    return selected;
+  }
+
+private:
+  ContenderList Contenders;
+};
+
+// Adds a contender to the registry when the header defining it is included,
+// as a static object of that header:
+//   static bench::ContenderRegistration registration(new MyContender);
+struct ContenderRegistration
+{
+  explicit ContenderRegistration(Contender* contender)
+  {
+    ContenderRegistry::Instance().Add(contender);
+  }
+};
+
+namespace detail
+{
+// Calls ContenderType::RunTyped<FieldType>(context, collector) for the
+// scalar type of the volume of the context
+template<typename ContenderType>
+struct ScalarTypeRun
+{
+  ScalarTypeRun(const ContenderContext& context, ResultCollector& collector):
+    Context(context),
+    Collector(collector)
+    {
+    }
+
+  template<typename FieldType>
+  void operator()(FieldType)
+  {
+    ContenderType::template RunTyped<FieldType>(this->Context, this->Collector);
+  }
+
+  const ContenderContext& Context;
+  ResultCollector& Collector;
+};
+
+// Prepares the input and runs a contender on it as the work of a CoreLimit
+struct ContenderRun
+{
+  ContenderRun(Contender& contender,
+               const ContenderContext& context,
+               ResultCollector& collector):
+    Target(contender),
+    Context(context),
+    Collector(collector),
+    Prepared(true)
+    {
+    }
+
+  void operator()()
+  {
+    ContenderContext context = this->Context;
+    if(context.Preparation)
+      {
+      this->Prepared = context.Preparation->Prepare(context);
+      }
+    if(this->Prepared)
+      {
+      this->Target.Run(context, this->Collector);
+      }
+  }
+
+  Contender& Target;
+  const ContenderContext& Context;
+  ResultCollector& Collector;
+  bool Prepared;
+};
+
+// Collector of an isolated child: hands each result to the collector of
+// the child, then sends what the parent keeps of it, the name, core count
+// and trial times, as a tab separated line down the pipe.
+class PipeCollector : public ResultCollector
+{
+public:
+  PipeCollector(ResultCollector& report, int fd):
+    Report(report),
+    Fd(fd),
+    Failed(false)
+    {
+    }
+
+  virtual void Collect(const Result& result)
+  {
+    this->Report.Collect(result);
+
+    std::ostringstream line;
+    line << std::setprecision(17) << result.Name << '\t' << result.NumCores;
+    for(std::size_t i=0; i < result.Samples.size(); ++i)
+      {
+      line << '\t' << result.Samples[i];
+      }
+    line << '\n';
+
+    const std::string text = line.str();
+    std::size_t written = 0;
+    while(written < text.size())
+      {
+      const ssize_t n = write(this->Fd, text.data() + written, text.size() - written);
+      if(n < 0 && errno == EINTR)
+        {
+        continue;
+        }
+      if(n <= 0)
+        {
+        this->Failed = true;
+        return;
+        }
+      written += static_cast<std::size_t>(n);
+      }
+  }
+
+  bool HasFailed() const
+    { return this->Failed; }
+
+private:
+  ResultCollector& Report;
+  int Fd;
+  bool Failed;
+};
+
+//the results of the lines a PipeCollector sent, with only what it sent set
+static std::vector<Result> ParsePipedResults(const std::string& text)
+{
+  std::vector<Result> parsed;
+  std::istringstream lines(text);
+  std::string line;
+  while(std::getline(lines, line))
+    {
+    std::istringstream fields(line);
+    Result result;
+    if(!std::getline(fields, result.Name, '\t') || !(fields >> result.NumCores))
+      {
+      continue;
+      }
+    double sample;
+    while(fields >> sample)
+      {
+      result.Samples.push_back(sample);
+      }
+    parsed.push_back(result);
+    }
+  return parsed;
+}
+}
+
+// Prepare the input and run contender on context.NumCores threads, pinned
+// to context.PinnedCpus. Returns false when the input couldn't be prepared
+// and the contender didn't run.
+static bool RunOnCores(Contender& contender,
+                       const ContenderContext& context,
+                       ResultCollector& collector)
+{
+  detail::ContenderRun run(contender, context, collector);
+  RunOnCores(context.NumCores, context.PinnedCpus, run);
+  return run.Prepared;
+}
+
+// Call contender.RunTyped<FieldType> in the scalar type of the volume, for
+// contenders templated over it like the Run* functions they call
+template<typename ContenderType>
+static void RunInScalarType(const ContenderContext& context, ResultCollector& collector)
+{
+  detail::ScalarTypeRun<ContenderType> run(context, collector);
+  CastAndCallScalarType(context.Volume->GetScalarType(), run);
+}
+
+// Run contender at context.NumCores in a forked child process, so the heap,
+// the caches and the thread pool it leaves behind die with the child
+// instead of meeting the next contender. The child limits its own cores
+// and hands every result to report, which prints it and writes it to the
+// results file. The parent then hands keep the name, core count and trial
+// times of each, for what outlives the child like the scaling report.
+// Returns false when the child couldn't be started or didn't exit cleanly,
+// the results it sent before that are kept.
+static bool RunIsolated(Contender& contender,
+                        const ContenderContext& context,
+                        ResultCollector& report,
+                        ResultCollector& keep)
+{
+  int fds[2];
+  if(pipe(fds) != 0)
+    {
+    std::cerr << "unable to isolate " << contender.GetName() << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+    }
+
+  //whatever is buffered would be written by both processes
+  std::cout.flush();
+  std::cerr.flush();
+  const pid_t pid = fork();
+  if(pid < 0)
+    {
+    std::cerr << "unable to isolate " << contender.GetName() << ": "
+              << std::strerror(errno) << std::endl;
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+    }
+
+  if(pid == 0)
+    {
+    close(fds[0]);
+    bool failed = false;
+    {
+    detail::PipeCollector collector(report, fds[1]);
+    failed = !RunOnCores(contender, context, collector) || collector.HasFailed();
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    close(fds[1]);
+    //the objects of the parent are its own to destroy
+    _exit(failed ? 1 : 0);
+    }
+
+  close(fds[1]);
+  std::string received;
+  char buffer[4096];
+  for(;;)
+    {
+    const ssize_t n = read(fds[0], buffer, sizeof(buffer));
+    if(n < 0 && errno == EINTR)
+      {
+      continue;
+      }
+    if(n <= 0)
+      {
+      break;
+      }
+    received.append(buffer, static_cast<std::size_t>(n));
+    }
+  close(fds[0]);
+
+  int status = 0;
+  while(waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    {
+    }
+
+  const std::vector<Result> results = detail::ParsePipedResults(received);
+  for(std::size_t i=0; i < results.size(); ++i)
+    {
+    keep.Collect(results[i]);
+    }
+
+  if(WIFSIGNALED(status))
+    {
+    std::cerr << "isolated " << contender.GetName() << " on " << context.NumCores
+              << " cores was killed by signal " << WTERMSIG(status) << std::endl;
+    return false;
+    }
+  if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+    std::cerr << "isolated " << contender.GetName() << " on " << context.NumCores
+              << " cores failed" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+}
+
+#endif
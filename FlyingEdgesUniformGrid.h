@@ -0,0 +1,596 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __flyingEdgesUniformGrid_h
+#define __flyingEdgesUniformGrid_h
+
+#include <vtkm/Types.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/cont/DeviceAdapterAlgorithm.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/MarchingCubesDataTables.h>
+#include <vtkm/worklet/WorkletMapField.h>
+
+#include "MarchingCubesHelpers.h"
+#include "PhaseTrace.h"
+#include "ScalarTypes.h"
+
+namespace bench
+{
+
+// Flying edges isosurface of a uniform grid, after Schroeder, Maynard and
+// Geveci, "Flying Edges: A High-Performance Scalable Isocontouring
+// Algorithm". Where the cell centric filters classify each of the 8
+// points of every cell, and interpolate a shared edge once per cell using
+// it, the work here is done along the x rows of points:
+//
+//  1. each x edge of a point row is classified once, its case says which of
+//     its two points are above the isovalue, and the row records how many
+//     of its x edges the isosurface crosses and the range they are in.
+//  2. a row of cells, between four point rows, gets its marching cubes
+//     cases from the x edge cases alone. Only the cells between the trim
+//     range of its point rows are visited, the others can't be crossed. It
+//     counts its triangles and the y and z edges it owns that are crossed.
+//  3. exclusive scans of the counts give every cell row where its points
+//     and triangles go.
+//  4. each cell row walks the same cells again, interpolating the points of
+//     the edges it owns and writing the point ids of its triangles.
+//
+// The point rows of a cell row (j,k) are (j,k), (j+1,k), (j,k+1) and
+// (j+1,k+1). It owns the edges of point row (j,k), the x edges and the y
+// and z edges going up from it, and on the last cell rows those of the
+// point rows past them too. Within each row edges are numbered along x, so
+// any cell row can tell the id of a point it doesn't own by counting the
+// crossed edges before it. The output is welded like that of
+// WeldedIsosurfaceUniformGrid: the points of the x edges, then of the y
+// edges, then of the z edges, and 3 point ids per triangle.
+//
+// As in BatchIsosurfaceUniformGrid the field is read in the FieldType it
+// is stored in and interpolated in ScalarTraits::ComputeType.
+template<typename FieldType, typename DeviceAdapter>
+class FlyingEdgesUniformGrid
+{
+public:
+  typedef typename ScalarTraits<FieldType>::ComputeType ComputeType;
+  typedef vtkm::Vec<vtkm::Float32,3> PointType;
+  typedef typename vtkm::cont::ArrayHandle<FieldType>::template ExecutionTypes<DeviceAdapter>::PortalConst FieldPortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::IdComponent>::template ExecutionTypes<DeviceAdapter>::PortalConst TablePortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::UInt8>::template ExecutionTypes<DeviceAdapter>::Portal EdgeCasePortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::UInt8>::template ExecutionTypes<DeviceAdapter>::PortalConst EdgeCasePortalConstType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::Id>::template ExecutionTypes<DeviceAdapter>::Portal IdPortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::Id>::template ExecutionTypes<DeviceAdapter>::PortalConst IdPortalConstType;
+  typedef typename vtkm::cont::ArrayHandle<PointType>::template ExecutionTypes<DeviceAdapter>::Portal PointPortalType;
+
+  // The x edge cases and trim ranges of the 4 point rows of a cell row,
+  // and the range of cells [Left, Right) of it that may be crossed
+  struct CellRow
+  {
+    VTKM_EXEC_EXPORT
+    CellRow(const EdgeCasePortalConstType& edgeCases,
+            const IdPortalConstType& trimLeft,
+            const IdPortalConstType& trimRight,
+            const vtkm::Id3& pointDims,
+            vtkm::Id cellRowId)
+    {
+      const vtkm::Id numXEdges = pointDims[0] - 1;
+      this->J = cellRowId % (pointDims[1] - 1);
+      this->K = cellRowId / (pointDims[1] - 1);
+      this->PointRows[0] = this->J + this->K * pointDims[1];
+      this->PointRows[1] = this->PointRows[0] + 1;
+      this->PointRows[2] = this->PointRows[0] + pointDims[1];
+      this->PointRows[3] = this->PointRows[2] + 1;
+
+      this->Left = numXEdges;
+      this->Right = 0;
+      vtkm::UInt8 leftSides = 0;
+      vtkm::UInt8 rightSides = 0;
+      for(int r=0; r < 4; ++r)
+        {
+        const vtkm::Id left = trimLeft.Get(this->PointRows[r]);
+        const vtkm::Id right = trimRight.Get(this->PointRows[r]);
+        this->Left = (left < this->Left) ? left : this->Left;
+        this->Right = (right > this->Right) ? right : this->Right;
+        leftSides |= static_cast<vtkm::UInt8>(
+          (edgeCases.Get(this->PointRows[r] * numXEdges) & 1) << r);
+        rightSides |= static_cast<vtkm::UInt8>(
+          ((edgeCases.Get(this->PointRows[r] * numXEdges + numXEdges - 1) >> 1) & 1) << r);
+        }
+
+      //the cells outside the trim ranges of all 4 rows are crossed only
+      //when the rows are on different sides there
+      if(leftSides != 0 && leftSides != 15)
+        {
+        this->Left = 0;
+        }
+      if(rightSides != 0 && rightSides != 15)
+        {
+        this->Right = numXEdges;
+        }
+    }
+
+    //whether any cell of the row may be crossed
+    VTKM_EXEC_EXPORT
+    bool IsCrossed() const
+      { return this->Left < this->Right; }
+
+    //marching cubes case of a cell given the x edge cases of the 4 rows at it
+    static VTKM_EXEC_EXPORT vtkm::IdComponent CaseNumber(const vtkm::UInt8 edgeCases[4])
+    {
+      return static_cast<vtkm::IdComponent>( (edgeCases[0] & 3) |
+                                             ((edgeCases[1] & 2) << 1) |
+                                             ((edgeCases[1] & 1) << 3) |
+                                             ((edgeCases[2] & 3) << 4) |
+                                             ((edgeCases[3] & 2) << 5) |
+                                             ((edgeCases[3] & 1) << 7) );
+    }
+
+    vtkm::Id J;
+    vtkm::Id K;
+    vtkm::Id PointRows[4];
+    vtkm::Id Left;
+    vtkm::Id Right;
+  };
+
+  class ClassifyXEdges : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> pointRowId,
+                                  FieldOut<IdType> numCrossings,
+                                  FieldOut<IdType> trimLeft,
+                                  FieldOut<IdType> trimRight);
+    typedef void ExecutionSignature(_1, _2, _3, _4);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    ClassifyXEdges(const FieldPortalType& field,
+                   const EdgeCasePortalType& edgeCases,
+                   const vtkm::Id3& pointDims,
+                   ComputeType isovalue):
+      Field(field),
+      EdgeCases(edgeCases),
+      PointDims(pointDims),
+      Isovalue(isovalue)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id pointRowId,
+                    vtkm::Id& numCrossings,
+                    vtkm::Id& trimLeft,
+                    vtkm::Id& trimRight) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      const vtkm::Id numXEdges = this->PointDims[0] - 1;
+      const vtkm::Id firstPoint = pointRowId * this->PointDims[0];
+      const vtkm::Id firstEdge = pointRowId * numXEdges;
+
+      numCrossings = 0;
+      trimLeft = numXEdges;
+      trimRight = 0;
+      vtkm::UInt8 above =
+        static_cast<ComputeType>(this->Field.Get(firstPoint)) > this->Isovalue ? 1 : 0;
+      for(vtkm::Id i=0; i < numXEdges; ++i)
+        {
+        const vtkm::UInt8 nextAbove =
+          static_cast<ComputeType>(this->Field.Get(firstPoint + i + 1)) > this->Isovalue ? 1 : 0;
+        this->EdgeCases.Set(firstEdge + i, static_cast<vtkm::UInt8>(above | (nextAbove << 1)));
+        if(above != nextAbove)
+          {
+          ++numCrossings;
+          trimLeft = (i < trimLeft) ? i : trimLeft;
+          trimRight = i + 1;
+          }
+        above = nextAbove;
+        }
+    }
+
+  private:
+    FieldPortalType Field;
+    EdgeCasePortalType EdgeCases;
+    vtkm::Id3 PointDims;
+    ComputeType Isovalue;
+  };
+
+  class CountCellRow : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> cellRowId, FieldOut<IdType> numTriangles);
+    typedef void ExecutionSignature(_1, _2);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    CountCellRow(const EdgeCasePortalConstType& edgeCases,
+                 const IdPortalConstType& trimLeft,
+                 const IdPortalConstType& trimRight,
+                 const TablePortalType& numVerticesTable,
+                 const IdPortalType& yCrossings,
+                 const IdPortalType& zCrossings,
+                 const vtkm::Id3& pointDims):
+      EdgeCases(edgeCases),
+      TrimLeft(trimLeft),
+      TrimRight(trimRight),
+      NumVerticesTable(numVerticesTable),
+      YCrossings(yCrossings),
+      ZCrossings(zCrossings),
+      PointDims(pointDims)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id cellRowId, vtkm::Id& numTriangles) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      const CellRow row(this->EdgeCases, this->TrimLeft, this->TrimRight,
+                        this->PointDims, cellRowId);
+      const vtkm::Id numXEdges = this->PointDims[0] - 1;
+
+      //crossed y edges at k and k+1, and z edges at j and j+1
+      vtkm::Id yCrossings[2] = { 0, 0 };
+      vtkm::Id zCrossings[2] = { 0, 0 };
+      numTriangles = 0;
+      if(row.IsCrossed())
+        {
+        vtkm::UInt8 edgeCases[4] = { 0, 0, 0, 0 };
+        for(vtkm::Id i=row.Left; i < row.Right; ++i)
+          {
+          for(int r=0; r < 4; ++r)
+            {
+            edgeCases[r] = this->EdgeCases.Get(row.PointRows[r] * numXEdges + i);
+            }
+          numTriangles += this->NumVerticesTable.Get(CellRow::CaseNumber(edgeCases)) / 3;
+          yCrossings[0] += (edgeCases[0] ^ edgeCases[1]) & 1;
+          yCrossings[1] += (edgeCases[2] ^ edgeCases[3]) & 1;
+          zCrossings[0] += (edgeCases[0] ^ edgeCases[2]) & 1;
+          zCrossings[1] += (edgeCases[1] ^ edgeCases[3]) & 1;
+          }
+        //the edges at the point past the last cell
+        yCrossings[0] += ((edgeCases[0] ^ edgeCases[1]) >> 1) & 1;
+        yCrossings[1] += ((edgeCases[2] ^ edgeCases[3]) >> 1) & 1;
+        zCrossings[0] += ((edgeCases[0] ^ edgeCases[2]) >> 1) & 1;
+        zCrossings[1] += ((edgeCases[1] ^ edgeCases[3]) >> 1) & 1;
+        }
+
+      //every point row is written by the one cell row owning it, the y
+      //edges of the last j and the z edges of the last k don't exist
+      const bool lastJ = (row.J == this->PointDims[1] - 2);
+      const bool lastK = (row.K == this->PointDims[2] - 2);
+      this->YCrossings.Set(row.PointRows[0], yCrossings[0]);
+      this->ZCrossings.Set(row.PointRows[0], zCrossings[0]);
+      if(lastJ)
+        {
+        this->YCrossings.Set(row.PointRows[1], 0);
+        this->ZCrossings.Set(row.PointRows[1], zCrossings[1]);
+        }
+      if(lastK)
+        {
+        this->YCrossings.Set(row.PointRows[2], yCrossings[1]);
+        this->ZCrossings.Set(row.PointRows[2], 0);
+        }
+      if(lastJ && lastK)
+        {
+        this->YCrossings.Set(row.PointRows[3], 0);
+        this->ZCrossings.Set(row.PointRows[3], 0);
+        }
+    }
+
+  private:
+    EdgeCasePortalConstType EdgeCases;
+    IdPortalConstType TrimLeft;
+    IdPortalConstType TrimRight;
+    TablePortalType NumVerticesTable;
+    IdPortalType YCrossings;
+    IdPortalType ZCrossings;
+    vtkm::Id3 PointDims;
+  };
+
+  class GenerateCellRow : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> cellRowId, FieldIn<IdType> triangleOffset);
+    typedef void ExecutionSignature(_1, _2);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    GenerateCellRow(const FieldPortalType& field,
+                    const EdgeCasePortalConstType& edgeCases,
+                    const IdPortalConstType& trimLeft,
+                    const IdPortalConstType& trimRight,
+                    const IdPortalConstType& xOffsets,
+                    const IdPortalConstType& yOffsets,
+                    const IdPortalConstType& zOffsets,
+                    const TablePortalType& numVerticesTable,
+                    const TablePortalType& triangleTable,
+                    const PointPortalType& vertices,
+                    const PointPortalType& normals,
+                    const IdPortalType& indices,
+                    const vtkm::Id3& pointDims,
+                    ComputeType isovalue,
+                    vtkm::Id numXPoints,
+                    vtkm::Id numYPoints):
+      Field(field),
+      EdgeCases(edgeCases),
+      TrimLeft(trimLeft),
+      TrimRight(trimRight),
+      XOffsets(xOffsets),
+      YOffsets(yOffsets),
+      ZOffsets(zOffsets),
+      NumVerticesTable(numVerticesTable),
+      TriangleTable(triangleTable),
+      Vertices(vertices),
+      Normals(normals),
+      Indices(indices),
+      PointDims(pointDims),
+      Isovalue(isovalue),
+      NumXPoints(numXPoints),
+      NumYPoints(numYPoints)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id cellRowId, vtkm::Id triangleOffset) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      const CellRow row(this->EdgeCases, this->TrimLeft, this->TrimRight,
+                        this->PointDims, cellRowId);
+      if(!row.IsCrossed())
+        {
+        return;
+        }
+
+      const vtkm::Id numXEdges = this->PointDims[0] - 1;
+      const bool lastJ = (row.J == this->PointDims[1] - 2);
+      const bool lastK = (row.K == this->PointDims[2] - 2);
+      const bool ownsXRow[4] = { true, lastJ, lastK, lastJ && lastK };
+
+      //ids of the next crossed edge of each row: x edges of the 4 point
+      //rows, y edges at k and k+1, z edges at j and j+1
+      vtkm::Id xIds[4];
+      for(int r=0; r < 4; ++r)
+        {
+        xIds[r] = this->XOffsets.Get(row.PointRows[r]);
+        }
+      vtkm::Id yIds[2] = { this->NumXPoints + this->YOffsets.Get(row.PointRows[0]),
+                           this->NumXPoints + this->YOffsets.Get(row.PointRows[2]) };
+      const vtkm::Id zStart = this->NumXPoints + this->NumYPoints;
+      vtkm::Id zIds[2] = { zStart + this->ZOffsets.Get(row.PointRows[0]),
+                           zStart + this->ZOffsets.Get(row.PointRows[1]) };
+
+      vtkm::Id index = 3 * triangleOffset;
+      vtkm::UInt8 edgeCases[4] = { 0, 0, 0, 0 };
+      for(vtkm::Id i=row.Left; i < row.Right; ++i)
+        {
+        for(int r=0; r < 4; ++r)
+          {
+          edgeCases[r] = this->EdgeCases.Get(row.PointRows[r] * numXEdges + i);
+          }
+        const vtkm::UInt8 yCrossed = static_cast<vtkm::UInt8>(edgeCases[0] ^ edgeCases[1]);
+        const vtkm::UInt8 yNextCrossed = static_cast<vtkm::UInt8>(edgeCases[2] ^ edgeCases[3]);
+        const vtkm::UInt8 zCrossed = static_cast<vtkm::UInt8>(edgeCases[0] ^ edgeCases[2]);
+        const vtkm::UInt8 zNextCrossed = static_cast<vtkm::UInt8>(edgeCases[1] ^ edgeCases[3]);
+
+        const vtkm::IdComponent caseNumber = CellRow::CaseNumber(edgeCases);
+        const vtkm::IdComponent numVertices = this->NumVerticesTable.Get(caseNumber);
+        if(numVertices > 0)
+          {
+          //point ids of the 12 cell edges in marching cubes numbering
+          const vtkm::Id edgeIds[12] = {
+            xIds[0], yIds[0] + (yCrossed & 1), xIds[1], yIds[0],
+            xIds[2], yIds[1] + (yNextCrossed & 1), xIds[3], yIds[1],
+            zIds[0], zIds[0] + (zCrossed & 1), zIds[1] + (zNextCrossed & 1), zIds[1] };
+          for(vtkm::IdComponent v=0; v < numVertices; ++v)
+            {
+            this->Indices.Set(index++, edgeIds[this->TriangleTable.Get(caseNumber*16 + v)]);
+            }
+          }
+
+        for(int r=0; r < 4; ++r)
+          {
+          if(((edgeCases[r] ^ (edgeCases[r] >> 1)) & 1) != 0)
+            {
+            if(ownsXRow[r])
+              {
+              this->GeneratePoint(xIds[r], row.PointRows[r] * this->PointDims[0] + i, 0);
+              }
+            ++xIds[r];
+            }
+          }
+        this->GeneratePointEdges(row, i, yCrossed & 1, yNextCrossed & 1,
+                                 zCrossed & 1, zNextCrossed & 1, yIds, zIds);
+        }
+
+      //the y and z edges at the point past the last cell
+      this->GeneratePointEdges(row, row.Right,
+                               (edgeCases[0] ^ edgeCases[1]) & 2, (edgeCases[2] ^ edgeCases[3]) & 2,
+                               (edgeCases[0] ^ edgeCases[2]) & 2, (edgeCases[1] ^ edgeCases[3]) & 2,
+                               yIds, zIds);
+    }
+
+  private:
+    VTKM_EXEC_EXPORT
+    void GeneratePoint(vtkm::Id pointId, vtkm::Id low, vtkm::IdComponent axis) const
+    {
+      PointType vertex;
+      PointType normal;
+      mc::InterpolateEdge(this->Field, this->PointDims, this->Isovalue, low, axis, vertex, normal);
+      this->Vertices.Set(pointId, vertex);
+      this->Normals.Set(pointId, normal);
+    }
+
+    //generate the crossed y and z edges going up from point i of the row
+    //that the cell row owns, and move the ids past all the crossed ones
+    VTKM_EXEC_EXPORT
+    void GeneratePointEdges(const CellRow& row,
+                            vtkm::Id i,
+                            bool yCrossed,
+                            bool yNextCrossed,
+                            bool zCrossed,
+                            bool zNextCrossed,
+                            vtkm::Id yIds[2],
+                            vtkm::Id zIds[2]) const
+    {
+      const vtkm::Id lowPoints[2] = { row.PointRows[0] * this->PointDims[0] + i,
+                                      row.PointRows[1] * this->PointDims[0] + i };
+      if(yCrossed)
+        {
+        this->GeneratePoint(yIds[0]++, lowPoints[0], 1);
+        }
+      if(yNextCrossed)
+        {
+        if(row.K == this->PointDims[2] - 2)
+          {
+          this->GeneratePoint(yIds[1], row.PointRows[2] * this->PointDims[0] + i, 1);
+          }
+        ++yIds[1];
+        }
+      if(zCrossed)
+        {
+        this->GeneratePoint(zIds[0]++, lowPoints[0], 2);
+        }
+      if(zNextCrossed)
+        {
+        if(row.J == this->PointDims[1] - 2)
+          {
+          this->GeneratePoint(zIds[1], lowPoints[1], 2);
+          }
+        ++zIds[1];
+        }
+    }
+
+    FieldPortalType Field;
+    EdgeCasePortalConstType EdgeCases;
+    IdPortalConstType TrimLeft;
+    IdPortalConstType TrimRight;
+    IdPortalConstType XOffsets;
+    IdPortalConstType YOffsets;
+    IdPortalConstType ZOffsets;
+    TablePortalType NumVerticesTable;
+    TablePortalType TriangleTable;
+    PointPortalType Vertices;
+    PointPortalType Normals;
+    IdPortalType Indices;
+    vtkm::Id3 PointDims;
+    ComputeType Isovalue;
+    vtkm::Id NumXPoints;
+    vtkm::Id NumYPoints;
+  };
+
+  FlyingEdgesUniformGrid(const vtkm::Id3& pointDims):
+    PointDims(pointDims),
+    NumVerticesTable(vtkm::cont::make_ArrayHandle(vtkm::worklet::internal::numVerticesTable, 256)),
+    TriangleTable(vtkm::cont::make_ArrayHandle(vtkm::worklet::internal::triTable, 256*16))
+    {
+    }
+
+  // Contour field at isovalue. vertices and normals get one entry per
+  // welded point and indices 3 point ids per triangle.
+  void Run(ComputeType isovalue,
+           const vtkm::cont::ArrayHandle<FieldType>& field,
+           vtkm::cont::ArrayHandle<PointType>& vertices,
+           vtkm::cont::ArrayHandle<PointType>& normals,
+           vtkm::cont::ArrayHandle<vtkm::Id>& indices)
+  {
+    typedef vtkm::cont::DeviceAdapterAlgorithm<DeviceAdapter> Algorithm;
+
+    const vtkm::Id numPointRows = this->PointDims[1] * this->PointDims[2];
+    const vtkm::Id numCellRows = (this->PointDims[1]-1) * (this->PointDims[2]-1);
+    const FieldPortalType fieldPortal = field.PrepareForInput(DeviceAdapter());
+    const TablePortalType numVerticesPortal = this->NumVerticesTable.PrepareForInput(DeviceAdapter());
+
+    //1. case of every x edge, and the crossed x edges of each point row
+    vtkm::cont::ArrayHandle<vtkm::UInt8> edgeCases;
+    vtkm::cont::ArrayHandle<vtkm::Id> xCrossings;
+    vtkm::cont::ArrayHandle<vtkm::Id> trimLeft;
+    vtkm::cont::ArrayHandle<vtkm::Id> trimRight;
+    {
+    ScopedDevicePhase<Algorithm> phase("classify x edges");
+    ClassifyXEdges classify(fieldPortal,
+                            edgeCases.PrepareForOutput((this->PointDims[0]-1) * numPointRows,
+                                                       DeviceAdapter()),
+                            this->PointDims, isovalue);
+    vtkm::worklet::DispatcherMapField<ClassifyXEdges, DeviceAdapter> classifyDispatcher(classify);
+    classifyDispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numPointRows),
+                              xCrossings, trimLeft, trimRight);
+    }
+
+    const EdgeCasePortalConstType edgeCasesPortal = edgeCases.PrepareForInput(DeviceAdapter());
+    const IdPortalConstType trimLeftPortal = trimLeft.PrepareForInput(DeviceAdapter());
+    const IdPortalConstType trimRightPortal = trimRight.PrepareForInput(DeviceAdapter());
+
+    //2. triangles of each cell row and the crossed y and z edges of each
+    //   point row
+    vtkm::cont::ArrayHandle<vtkm::Id> numTriangles;
+    vtkm::cont::ArrayHandle<vtkm::Id> yCrossings;
+    vtkm::cont::ArrayHandle<vtkm::Id> zCrossings;
+    {
+    ScopedDevicePhase<Algorithm> phase("count");
+    CountCellRow count(edgeCasesPortal, trimLeftPortal, trimRightPortal, numVerticesPortal,
+                       yCrossings.PrepareForOutput(numPointRows, DeviceAdapter()),
+                       zCrossings.PrepareForOutput(numPointRows, DeviceAdapter()),
+                       this->PointDims);
+    vtkm::worklet::DispatcherMapField<CountCellRow, DeviceAdapter> countDispatcher(count);
+    countDispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numCellRows),
+                           numTriangles);
+    }
+
+    //3. where the points of each point row and the triangles of each
+    //   cell row go
+    vtkm::cont::ArrayHandle<vtkm::Id> xOffsets;
+    vtkm::cont::ArrayHandle<vtkm::Id> yOffsets;
+    vtkm::cont::ArrayHandle<vtkm::Id> zOffsets;
+    vtkm::cont::ArrayHandle<vtkm::Id> triangleOffsets;
+    vtkm::Id numXPoints = 0;
+    vtkm::Id numYPoints = 0;
+    vtkm::Id numZPoints = 0;
+    vtkm::Id numOutputTriangles = 0;
+    {
+    ScopedDevicePhase<Algorithm> phase("scan");
+    numXPoints = Algorithm::ScanExclusive(xCrossings, xOffsets);
+    numYPoints = Algorithm::ScanExclusive(yCrossings, yOffsets);
+    numZPoints = Algorithm::ScanExclusive(zCrossings, zOffsets);
+    numOutputTriangles = Algorithm::ScanExclusive(numTriangles, triangleOffsets);
+    xCrossings.ReleaseResources();
+    yCrossings.ReleaseResources();
+    zCrossings.ReleaseResources();
+    numTriangles.ReleaseResources();
+    }
+
+    //4. points of the owned edges and triangles of each cell row
+    const vtkm::Id numPoints = numXPoints + numYPoints + numZPoints;
+    ScopedDevicePhase<Algorithm> phase("generate");
+    GenerateCellRow generate(fieldPortal, edgeCasesPortal, trimLeftPortal, trimRightPortal,
+                             xOffsets.PrepareForInput(DeviceAdapter()),
+                             yOffsets.PrepareForInput(DeviceAdapter()),
+                             zOffsets.PrepareForInput(DeviceAdapter()),
+                             numVerticesPortal,
+                             this->TriangleTable.PrepareForInput(DeviceAdapter()),
+                             vertices.PrepareForOutput(numPoints, DeviceAdapter()),
+                             normals.PrepareForOutput(numPoints, DeviceAdapter()),
+                             indices.PrepareForOutput(3 * numOutputTriangles, DeviceAdapter()),
+                             this->PointDims, isovalue, numXPoints, numYPoints);
+    vtkm::worklet::DispatcherMapField<GenerateCellRow, DeviceAdapter> generateDispatcher(generate);
+    generateDispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numCellRows),
+                              triangleOffsets);
+  }
+
+private:
+  vtkm::Id3 PointDims;
+  vtkm::cont::ArrayHandle<vtkm::IdComponent> NumVerticesTable;
+  vtkm::cont::ArrayHandle<vtkm::IdComponent> TriangleTable;
+};
+
+}
+
+#endif
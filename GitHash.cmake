@@ -0,0 +1,24 @@
+#Writes OUTPUT_FILE defining BENCHMARK_GIT_HASH as the revision SOURCE_DIR
+#is checked out at. Run with cmake -P at every build, the header is only
+#rewritten when the revision changed so that nothing else is rebuilt.
+
+set(BENCHMARK_GIT_HASH "")
+if(GIT_EXECUTABLE)
+  execute_process(COMMAND ${GIT_EXECUTABLE} rev-parse --short HEAD
+    WORKING_DIRECTORY ${SOURCE_DIR}
+    OUTPUT_VARIABLE BENCHMARK_GIT_HASH
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    ERROR_QUIET)
+endif()
+if(NOT BENCHMARK_GIT_HASH)
+  set(BENCHMARK_GIT_HASH "unknown")
+endif()
+
+set(contents "#define BENCHMARK_GIT_HASH \"${BENCHMARK_GIT_HASH}\"\n")
+set(previous "")
+if(EXISTS ${OUTPUT_FILE})
+  file(READ ${OUTPUT_FILE} previous)
+endif()
+if(NOT previous STREQUAL contents)
+  file(WRITE ${OUTPUT_FILE} "${contents}")
+endif()
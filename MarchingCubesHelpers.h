@@ -0,0 +1,188 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __marchingCubesHelpers_h
+#define __marchingCubesHelpers_h
+
+#include <vtkm/Types.h>
+
+#include <cmath>
+
+namespace bench
+{
+
+// Helpers shared by the marching cubes filters on uniform grids. Points
+// and cells are numbered x fastest, and cell vertices follow the numbering
+// of the VTK-m marching cubes tables.
+namespace mc
+{
+//the two cell vertices of each of the 12 edges of a hexahedron
+static VTKM_EXEC_EXPORT void EdgeVertices(vtkm::IdComponent edge,
+                                          vtkm::IdComponent& v0,
+                                          vtkm::IdComponent& v1)
+{
+  const vtkm::IdComponent verticesForEdge[24] = { 0, 1, 1, 2, 3, 2, 0, 3,
+                                                  4, 5, 5, 6, 7, 6, 4, 7,
+                                                  0, 4, 1, 5, 2, 6, 3, 7 };
+  v0 = verticesForEdge[2*edge];
+  v1 = verticesForEdge[2*edge + 1];
+}
+
+//offset of each of the 8 vertices of a cell from its lowest one, in points
+//along x, y and z
+static VTKM_EXEC_EXPORT void VertexOffset(vtkm::IdComponent vertex,
+                                          vtkm::Id offset[3])
+{
+  const vtkm::IdComponent offsets[24] = { 0, 0, 0,  1, 0, 0,  1, 1, 0,  0, 1, 0,
+                                          0, 0, 1,  1, 0, 1,  1, 1, 1,  0, 1, 1 };
+  offset[0] = offsets[3*vertex];
+  offset[1] = offsets[3*vertex + 1];
+  offset[2] = offsets[3*vertex + 2];
+}
+
+//i, j, k of a cell from its id
+static VTKM_EXEC_EXPORT void CellIjk(vtkm::Id cellId,
+                                     const vtkm::Id3& pointDims,
+                                     vtkm::Id ijk[3])
+{
+  const vtkm::Id cellsX = pointDims[0] - 1;
+  const vtkm::Id cellsY = pointDims[1] - 1;
+  ijk[0] = cellId % cellsX;
+  ijk[1] = (cellId / cellsX) % cellsY;
+  ijk[2] = cellId / (cellsX * cellsY);
+}
+
+//point ids of the 8 vertices of a cell of a uniform grid
+static VTKM_EXEC_EXPORT void CellPointIds(vtkm::Id cellId,
+                                          const vtkm::Id3& pointDims,
+                                          vtkm::Id pointIds[8])
+{
+  vtkm::Id ijk[3];
+  CellIjk(cellId, pointDims, ijk);
+
+  const vtkm::Id ySlice = pointDims[0];
+  const vtkm::Id zSlice = pointDims[0] * pointDims[1];
+  const vtkm::Id base = ijk[0] + ySlice * ijk[1] + zSlice * ijk[2];
+
+  pointIds[0] = base;
+  pointIds[1] = base + 1;
+  pointIds[2] = base + 1 + ySlice;
+  pointIds[3] = base + ySlice;
+  pointIds[4] = base + zSlice;
+  pointIds[5] = base + 1 + zSlice;
+  pointIds[6] = base + 1 + ySlice + zSlice;
+  pointIds[7] = base + ySlice + zSlice;
+}
+
+//marching cubes case of a cell given the values at its 8 vertices, the
+//values are compared in the type of the isovalue
+template<typename FieldType, typename ComputeType>
+static VTKM_EXEC_EXPORT vtkm::IdComponent CaseNumber(const FieldType values[8],
+                                                     ComputeType isovalue)
+{
+  vtkm::IdComponent caseNumber = 0;
+  for(vtkm::IdComponent i=0; i < 8; ++i)
+    {
+    caseNumber |= (static_cast<ComputeType>(values[i]) > isovalue) ? (1 << i) : 0;
+    }
+  return caseNumber;
+}
+
+//central difference gradient at a point, one sided on the boundary,
+//computed in ComputeType whatever the type the field stores
+template<typename ComputeType, typename PortalType>
+static VTKM_EXEC_EXPORT vtkm::Vec<ComputeType,3> PointGradient(const PortalType& field,
+                                                               const vtkm::Id3& pointDims,
+                                                               const vtkm::Id ijk[3],
+                                                               vtkm::Id pointId)
+{
+  const vtkm::Id steps[3] = { 1, pointDims[0], pointDims[0] * pointDims[1] };
+  vtkm::Vec<ComputeType,3> gradient;
+  for(int axis=0; axis < 3; ++axis)
+    {
+    const vtkm::Id lower = (ijk[axis] > 0) ? pointId - steps[axis] : pointId;
+    const vtkm::Id upper = (ijk[axis] < pointDims[axis] - 1) ? pointId + steps[axis] : pointId;
+    const ComputeType span = static_cast<ComputeType>((upper - lower) / steps[axis]);
+    gradient[axis] = (span > 0) ?
+      (static_cast<ComputeType>(field.Get(upper)) - static_cast<ComputeType>(field.Get(lower))) / span : 0;
+    }
+  return gradient;
+}
+
+//points and normals are written in single precision whatever the field
+template<typename ComputeType>
+static VTKM_EXEC_EXPORT vtkm::Vec<vtkm::Float32,3> ToPoint(const vtkm::Vec<ComputeType,3>& v)
+{
+  return vtkm::Vec<vtkm::Float32,3>(static_cast<vtkm::Float32>(v[0]),
+                                    static_cast<vtkm::Float32>(v[1]),
+                                    static_cast<vtkm::Float32>(v[2]));
+}
+
+//point and normal where the isosurface crosses the grid edge going from
+//point low one step along axis, interpolated in ComputeType
+template<typename ComputeType, typename PortalType>
+static VTKM_EXEC_EXPORT void InterpolateEdge(const PortalType& field,
+                                             const vtkm::Id3& pointDims,
+                                             ComputeType isovalue,
+                                             vtkm::Id low,
+                                             vtkm::IdComponent axis,
+                                             vtkm::Vec<vtkm::Float32,3>& vertex,
+                                             vtkm::Vec<vtkm::Float32,3>& normal)
+{
+  const vtkm::Id steps[3] = { 1, pointDims[0], pointDims[0] * pointDims[1] };
+  const vtkm::Id high = low + steps[axis];
+
+  const vtkm::Id lowIjk[3] = { low % pointDims[0],
+                               (low / pointDims[0]) % pointDims[1],
+                               low / (pointDims[0] * pointDims[1]) };
+  vtkm::Id highIjk[3] = { lowIjk[0], lowIjk[1], lowIjk[2] };
+  highIjk[axis] += 1;
+
+  const ComputeType f0 = static_cast<ComputeType>(field.Get(low));
+  const ComputeType f1 = static_cast<ComputeType>(field.Get(high));
+  const ComputeType t = (f1 != f0) ? (isovalue - f0) / (f1 - f0) : ComputeType(0.5);
+
+  vtkm::Vec<ComputeType,3> position;
+  for(int i=0; i < 3; ++i)
+    {
+    position[i] = static_cast<ComputeType>(lowIjk[i]);
+    }
+  position[axis] += t;
+
+  const vtkm::Vec<ComputeType,3> g0 = PointGradient<ComputeType>(field, pointDims, lowIjk, low);
+  const vtkm::Vec<ComputeType,3> g1 = PointGradient<ComputeType>(field, pointDims, highIjk, high);
+  vtkm::Vec<ComputeType,3> direction;
+  ComputeType length = 0;
+  for(int i=0; i < 3; ++i)
+    {
+    direction[i] = g0[i] + t * (g1[i] - g0[i]);
+    length += direction[i] * direction[i];
+    }
+  length = std::sqrt(length);
+  if(length > 0)
+    {
+    for(int i=0; i < 3; ++i)
+      {
+      direction[i] /= length;
+      }
+    }
+  vertex = ToPoint(position);
+  normal = ToPoint(direction);
+}
+}
+
+}
+
+#endif
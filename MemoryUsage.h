@@ -0,0 +1,188 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __memoryUsage_h
+#define __memoryUsage_h
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "AllocationCounter.h"
+
+namespace bench
+{
+
+//returns the value of a "Key:  <n> kB" line of /proc/self/status in bytes,
+//or 0 when the file or the key is not available
+static long long ReadProcStatusBytes(const char* key)
+{
+  long long bytes = 0;
+  std::FILE* status = std::fopen("/proc/self/status", "r");
+  if(!status)
+    {
+    return bytes;
+    }
+
+  const std::size_t keyLen = std::strlen(key);
+  char line[256];
+  while(std::fgets(line, sizeof(line), status))
+    {
+    if(std::strncmp(line, key, keyLen) == 0 && line[keyLen] == ':')
+      {
+      long long kb = 0;
+      if(std::sscanf(line + keyLen + 1, "%lld", &kb) == 1)
+        {
+        bytes = kb * 1024;
+        }
+      break;
+      }
+    }
+  std::fclose(status);
+  return bytes;
+}
+
+//resident set size of the process right now, in bytes
+static long long CurrentResidentBytes()
+{
+  return ReadProcStatusBytes("VmRSS");
+}
+
+//high water mark of the resident set size of the process, in bytes
+static long long PeakResidentBytes()
+{
+  long long bytes = ReadProcStatusBytes("VmHWM");
+#ifndef _WIN32
+  if(bytes == 0)
+    {
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+      {
+      bytes = static_cast<long long>(usage.ru_maxrss) * 1024;
+      }
+    }
+#endif
+  return bytes;
+}
+
+//highest PeakResidentBytes seen before it was last reset
+static long long& PeakResidentBytesBeforeReset()
+{
+  static long long bytes = 0;
+  return bytes;
+}
+
+//high water mark of the resident set size since the process started,
+//whatever ResetPeakResidentBytes did
+static long long ProcessPeakResidentBytes()
+{
+  return std::max(PeakResidentBytesBeforeReset(), PeakResidentBytes());
+}
+
+// Reset the high water mark PeakResidentBytes reports to the current
+// resident set size, so the peak of a single phase can be measured.
+// Returns false when the kernel doesn't support it (Linux 4.0 and later).
+static bool ResetPeakResidentBytes()
+{
+  long long& before = PeakResidentBytesBeforeReset();
+  before = std::max(before, PeakResidentBytes());
+
+  std::FILE* clearRefs = std::fopen("/proc/self/clear_refs", "w");
+  if(!clearRefs)
+    {
+    return false;
+    }
+  const bool reset = std::fputs("5", clearRefs) >= 0;
+  return (std::fclose(clearRefs) == 0) && reset;
+}
+
+static double ToMegaBytes(long long bytes)
+{
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+
+//what a phase of a benchmark did to the memory of the process
+struct PhaseMemory
+{
+  PhaseMemory():
+    ResidentBytes(0),
+    ResidentDelta(0),
+    PeakResidentBytes(0),
+    AllocatedBytes(0),
+    AllocationCalls(0),
+    PeakHeapBytes(0)
+    {
+    }
+
+  //resident set size at the end of the phase and what the phase added
+  long long ResidentBytes;
+  long long ResidentDelta;
+  //highest resident set size during the phase, or since the process
+  //started when the kernel can't reset it
+  long long PeakResidentBytes;
+  //heap allocations made during the phase
+  long long AllocatedBytes;
+  long long AllocationCalls;
+  //most heap bytes in use at once during the phase, above those in use
+  //when it started
+  long long PeakHeapBytes;
+};
+
+// Samples memory around a phase: Begin resets the peaks and takes the
+// starting values, End measures the phase from them. Neither is meant to
+// be called from a timed region, both read /proc.
+class MemoryProbe
+{
+public:
+  MemoryProbe():
+    ResidentBytes(0)
+    {
+    }
+
+  void Begin()
+  {
+    ResetPeakResidentBytes();
+    ResetPeakLiveBytes();
+    this->ResidentBytes = CurrentResidentBytes();
+    this->Allocations = CurrentAllocationCounts();
+  }
+
+  PhaseMemory End() const
+  {
+    const AllocationCounts allocations = CurrentAllocationCounts();
+
+    PhaseMemory phase;
+    phase.ResidentBytes = CurrentResidentBytes();
+    phase.ResidentDelta = phase.ResidentBytes - this->ResidentBytes;
+    phase.PeakResidentBytes = PeakResidentBytes();
+    phase.AllocatedBytes = allocations.Bytes - this->Allocations.Bytes;
+    phase.AllocationCalls = allocations.Calls - this->Allocations.Calls;
+    phase.PeakHeapBytes = std::max(0LL, allocations.PeakLiveBytes - this->Allocations.LiveBytes);
+    return phase;
+  }
+
+private:
+  long long ResidentBytes;
+  AllocationCounts Allocations;
+};
+
+}
+
+#endif
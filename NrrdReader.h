@@ -0,0 +1,615 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __nrrdReader_h
+#define __nrrdReader_h
+
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bench
+{
+
+// The subset of a NRRD header that the benchmarks need to locate and
+// interpret the raw payload of a 3D scalar volume. Both attached (.nrrd)
+// and detached (.nhdr) headers are supported.
+struct NrrdHeader
+{
+  NrrdHeader():
+    Type(""),
+    Dimension(0),
+    Encoding("raw"),
+    Endian("little"),
+    DataFile(""),
+    LineSkip(0),
+    ByteSkip(0),
+    HeaderSize(0)
+    {
+    for(int i=0; i < 3; ++i)
+      {
+      this->Sizes[i] = 0;
+      this->Spacings[i] = 1.0;
+      this->Origin[i] = 0.0;
+      }
+    }
+
+  //canonical scalar type: int8, uint8, int16, uint16, int32, uint32,
+  //int64, uint64, float or double
+  std::string Type;
+  int Dimension;
+  long long Sizes[3];
+  double Spacings[3];
+  double Origin[3];
+  std::string Encoding;
+  std::string Endian;
+  //absolute path of the file holding the payload
+  std::string DataFile;
+  long long LineSkip;
+  long long ByteSkip;
+  //number of bytes of header in front of an attached payload
+  long long HeaderSize;
+
+  std::size_t ScalarSize() const
+  {
+    if(this->Type == "int8" || this->Type == "uint8") { return 1; }
+    if(this->Type == "int16" || this->Type == "uint16") { return 2; }
+    if(this->Type == "int32" || this->Type == "uint32" || this->Type == "float") { return 4; }
+    if(this->Type == "int64" || this->Type == "uint64" || this->Type == "double") { return 8; }
+    return 0;
+  }
+
+  long long NumberOfValues() const
+  {
+    return this->Sizes[0] * this->Sizes[1] * this->Sizes[2];
+  }
+
+  //true when the payload can be used straight from a memory map
+  bool IsMappable() const
+  {
+    return this->Encoding == "raw" && this->ScalarSize() != 0;
+  }
+
+  //true when the payload byte order is not the byte order of this host
+  bool NeedsByteSwap() const
+  {
+    const unsigned short probe = 1;
+    const bool hostIsLittle = *reinterpret_cast<const unsigned char*>(&probe) == 1;
+    return this->ScalarSize() > 1 && ((this->Endian == "little") != hostIsLittle);
+  }
+
+  bool Read(const std::string& path, std::string& error);
+};
+
+namespace nrrd
+{
+static std::string Trim(const std::string& str)
+{
+  const std::string whitespace(" \t\r\n");
+  const std::size_t begin = str.find_first_not_of(whitespace);
+  if(begin == std::string::npos)
+    {
+    return std::string();
+    }
+  const std::size_t end = str.find_last_not_of(whitespace);
+  return str.substr(begin, end - begin + 1);
+}
+
+static std::string ToLower(std::string str)
+{
+  for(std::size_t i=0; i < str.size(); ++i)
+    {
+    str[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(str[i])));
+    }
+  return str;
+}
+
+//map every spelling of a type that the NRRD spec allows to a canonical name
+static std::string CanonicalType(const std::string& type)
+{
+  const std::string t = ToLower(type);
+  if(t == "signed char" || t == "int8" || t == "int8_t") { return "int8"; }
+  if(t == "uchar" || t == "unsigned char" || t == "uint8" || t == "uint8_t") { return "uint8"; }
+  if(t == "short" || t == "short int" || t == "signed short" ||
+     t == "signed short int" || t == "int16" || t == "int16_t") { return "int16"; }
+  if(t == "ushort" || t == "unsigned short" || t == "unsigned short int" ||
+     t == "uint16" || t == "uint16_t") { return "uint16"; }
+  if(t == "int" || t == "signed int" || t == "int32" || t == "int32_t") { return "int32"; }
+  if(t == "uint" || t == "unsigned int" || t == "uint32" || t == "uint32_t") { return "uint32"; }
+  if(t == "longlong" || t == "long long" || t == "long long int" ||
+     t == "signed long long" || t == "signed long long int" ||
+     t == "int64" || t == "int64_t") { return "int64"; }
+  if(t == "ulonglong" || t == "unsigned long long" ||
+     t == "unsigned long long int" || t == "uint64" || t == "uint64_t") { return "uint64"; }
+  if(t == "float") { return "float"; }
+  if(t == "double") { return "double"; }
+  return "";
+}
+
+static std::string CanonicalEncoding(const std::string& encoding)
+{
+  const std::string e = ToLower(encoding);
+  if(e == "gz") { return "gzip"; }
+  if(e == "bz2") { return "bzip2"; }
+  if(e == "txt" || e == "text") { return "ascii"; }
+  return e;
+}
+
+//parse a NRRD vector of the form "(x,y,z)", returns false for "none"
+static bool ParseVector(const std::string& str, double values[3])
+{
+  std::string cleaned(str);
+  std::replace(cleaned.begin(), cleaned.end(), '(', ' ');
+  std::replace(cleaned.begin(), cleaned.end(), ')', ' ');
+  std::replace(cleaned.begin(), cleaned.end(), ',', ' ');
+  std::istringstream stream(cleaned);
+  return static_cast<bool>(stream >> values[0] >> values[1] >> values[2]);
+}
+
+static std::string DirectoryOf(const std::string& path)
+{
+  const std::size_t slash = path.find_last_of("/\\");
+  return (slash == std::string::npos) ? std::string(".") : path.substr(0, slash);
+}
+}
+
+//-----------------------------------------------------------------------------
+inline bool NrrdHeader::Read(const std::string& path, std::string& error)
+{
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+  if(!file)
+    {
+    error = "unable to open " + path;
+    return false;
+    }
+
+  std::string line;
+  std::getline(file, line);
+  if(line.compare(0, 4, "NRRD") != 0)
+    {
+    error = path + " is not a NRRD file";
+    return false;
+    }
+
+  while(std::getline(file, line))
+    {
+    line = nrrd::Trim(line);
+    if(line.empty())
+      {
+      //a blank line ends the header, an attached payload follows it
+      break;
+      }
+    if(line[0] == '#' || line.find(":=") != std::string::npos)
+      {
+      //comments and key/value pairs carry nothing we need
+      continue;
+      }
+
+    const std::size_t sep = line.find(':');
+    if(sep == std::string::npos)
+      {
+      continue;
+      }
+    const std::string field = nrrd::ToLower(nrrd::Trim(line.substr(0, sep)));
+    const std::string value = nrrd::Trim(line.substr(sep + 1));
+    std::istringstream values(value);
+
+    if(field == "type")
+      {
+      this->Type = nrrd::CanonicalType(value);
+      }
+    else if(field == "dimension")
+      {
+      values >> this->Dimension;
+      }
+    else if(field == "sizes")
+      {
+      values >> this->Sizes[0] >> this->Sizes[1] >> this->Sizes[2];
+      }
+    else if(field == "spacings")
+      {
+      values >> this->Spacings[0] >> this->Spacings[1] >> this->Spacings[2];
+      }
+    else if(field == "space directions")
+      {
+      //only axis aligned volumes are supported, keep the length of each axis
+      std::string axis;
+      for(int i=0; i < 3 && (values >> axis); ++i)
+        {
+        double dir[3];
+        if(nrrd::ParseVector(axis, dir))
+          {
+          this->Spacings[i] = std::sqrt(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+          }
+        }
+      }
+    else if(field == "space origin")
+      {
+      nrrd::ParseVector(value, this->Origin);
+      }
+    else if(field == "encoding")
+      {
+      this->Encoding = nrrd::CanonicalEncoding(value);
+      }
+    else if(field == "endian")
+      {
+      this->Endian = nrrd::ToLower(value);
+      }
+    else if(field == "data file" || field == "datafile")
+      {
+      this->DataFile = value;
+      }
+    else if(field == "line skip" || field == "lineskip")
+      {
+      values >> this->LineSkip;
+      }
+    else if(field == "byte skip" || field == "byteskip")
+      {
+      values >> this->ByteSkip;
+      }
+    }
+
+  if(this->Dimension != 3)
+    {
+    error = "only 3 dimensional NRRD files are supported";
+    return false;
+    }
+  if(this->Type.empty())
+    {
+    error = "unknown or missing NRRD type";
+    return false;
+    }
+
+  if(this->DataFile.empty())
+    {
+    //attached payload, it starts right after the blank line
+    this->DataFile = path;
+    this->HeaderSize = static_cast<long long>(file.tellg());
+    }
+  else
+    {
+    if(this->DataFile.find(' ') != std::string::npos || this->DataFile == "LIST")
+      {
+      error = "multi file NRRD payloads are not supported";
+      return false;
+      }
+    if(this->DataFile[0] != '/')
+      {
+      this->DataFile = nrrd::DirectoryOf(path) + "/" + this->DataFile;
+      }
+    this->HeaderSize = 0;
+    }
+  return true;
+}
+
+// Read only memory map of a region of a file, populated up front so that
+// the cost of reading the file is paid when the volume is loaded and not by
+// the first algorithm to touch it. The pages are the ones of the page
+// cache, nothing is copied. The mapping is private, so MakeWritable lets
+// the pages be byte swapped in place without touching the file, at the
+// cost of a private copy of every page written.
+class MappedFile
+{
+public:
+  MappedFile():
+    Base(NULL),
+    MappedLength(0),
+    Data(NULL),
+    Length(0)
+    {
+    }
+
+  ~MappedFile()
+    {
+    this->Unmap();
+    }
+
+  bool Map(const std::string& path, long long offset, long long length,
+           std::string& error)
+  {
+    this->Unmap();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+      {
+      error = "unable to open " + path;
+      return false;
+      }
+
+    //mmap offsets have to be page aligned
+    const long long pageSize = ::sysconf(_SC_PAGESIZE);
+    const long long alignedOffset = (offset / pageSize) * pageSize;
+    const long long delta = offset - alignedOffset;
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void* base = ::mmap(NULL, static_cast<std::size_t>(length + delta),
+                        PROT_READ, flags, fd,
+                        static_cast<off_t>(alignedOffset));
+    ::close(fd);
+    if(base == MAP_FAILED)
+      {
+      error = "unable to memory map " + path;
+      return false;
+      }
+
+    this->Base = base;
+    this->MappedLength = static_cast<std::size_t>(length + delta);
+    this->Data = static_cast<char*>(base) + delta;
+    this->Length = static_cast<std::size_t>(length);
+    return true;
+  }
+
+  bool MakeWritable(std::string& error)
+  {
+    if(::mprotect(this->Base, this->MappedLength, PROT_READ | PROT_WRITE) != 0)
+      {
+      error = "unable to make the memory map writable";
+      return false;
+      }
+    return true;
+  }
+
+  void Unmap()
+  {
+    if(this->Base)
+      {
+      ::munmap(this->Base, this->MappedLength);
+      }
+    this->Base = NULL;
+    this->MappedLength = 0;
+    this->Data = NULL;
+    this->Length = 0;
+  }
+
+  char* GetData() const { return this->Data; }
+  std::size_t GetLength() const { return this->Length; }
+
+private:
+  MappedFile(const MappedFile&);
+  void operator=(const MappedFile&);
+
+  void* Base;
+  std::size_t MappedLength;
+  char* Data;
+  std::size_t Length;
+};
+
+//swap the byte order of every scalar of a buffer in place
+static void ByteSwap(char* data, std::size_t numValues, std::size_t scalarSize)
+{
+  for(std::size_t i=0; i < numValues; ++i)
+    {
+    std::reverse(data + i * scalarSize, data + (i + 1) * scalarSize);
+    }
+}
+
+// Finds the byte offset of the raw payload described by a parsed header in
+// its data file. Returns false and fills error when the payload isn't raw
+// or the file is too small to hold it.
+static bool LocateNrrdPayload(const NrrdHeader& header,
+                              long long& payloadOffset,
+                              std::string& error)
+{
+  if(!header.IsMappable())
+    {
+    error = "NRRD encoding '" + header.Encoding + "' can't be memory mapped";
+    return false;
+    }
+
+  struct stat info;
+  if(::stat(header.DataFile.c_str(), &info) != 0)
+    {
+    error = "unable to stat " + header.DataFile;
+    return false;
+    }
+  const long long fileSize = static_cast<long long>(info.st_size);
+  const long long payloadSize =
+    header.NumberOfValues() * static_cast<long long>(header.ScalarSize());
+
+  long long offset = header.HeaderSize;
+  if(header.LineSkip > 0)
+    {
+    std::ifstream data(header.DataFile.c_str(), std::ios::in | std::ios::binary);
+    data.seekg(offset);
+    std::string skipped;
+    for(long long i=0; i < header.LineSkip && std::getline(data, skipped); ++i)
+      {
+      }
+    offset = static_cast<long long>(data.tellg());
+    }
+
+  if(header.ByteSkip == -1)
+    {
+    //the payload is the last payloadSize bytes of the file
+    offset = fileSize - payloadSize;
+    }
+  else
+    {
+    offset += header.ByteSkip;
+    }
+
+  if(offset < 0 || offset + payloadSize > fileSize)
+    {
+    error = header.DataFile + " is smaller than the NRRD header says";
+    return false;
+    }
+
+  payloadOffset = offset;
+  return true;
+}
+
+// Maps the raw payload described by a parsed header. The payload ends up in
+// host byte order. Returns false and fills error when the payload can't be
+// mapped, in which case the caller should fall back to a regular reader.
+static bool MapNrrdPayload(const NrrdHeader& header,
+                           boost::shared_ptr<MappedFile>& mapping,
+                           std::string& error)
+{
+  long long offset = 0;
+  if(!LocateNrrdPayload(header, offset, error))
+    {
+    return false;
+    }
+  const long long payloadSize =
+    header.NumberOfValues() * static_cast<long long>(header.ScalarSize());
+
+  mapping.reset(new MappedFile());
+  if(!mapping->Map(header.DataFile, offset, payloadSize, error))
+    {
+    mapping.reset();
+    return false;
+    }
+
+  if(header.NeedsByteSwap())
+    {
+    if(!mapping->MakeWritable(error))
+      {
+      mapping.reset();
+      return false;
+      }
+    ByteSwap(mapping->GetData(), static_cast<std::size_t>(header.NumberOfValues()),
+             header.ScalarSize());
+    }
+  return true;
+}
+
+// Reads z slabs of the raw payload of a NRRD volume with pread, so only the
+// slabs being worked on have to be resident instead of the whole volume.
+// A slab is a range of z slices of points, stored contiguously since x
+// varies fastest. Values are returned in host byte order.
+class NrrdSlabReader
+{
+public:
+  NrrdSlabReader():
+    File(-1),
+    PayloadOffset(0),
+    SliceBytes(0)
+    {
+    }
+
+  ~NrrdSlabReader()
+    {
+    this->Close();
+    }
+
+  bool Open(const NrrdHeader& header, std::string& error)
+  {
+    this->Close();
+    if(!LocateNrrdPayload(header, this->PayloadOffset, error))
+      {
+      return false;
+      }
+
+    this->File = ::open(header.DataFile.c_str(), O_RDONLY);
+    if(this->File < 0)
+      {
+      error = "unable to open " + header.DataFile;
+      return false;
+      }
+
+    this->Header = header;
+    this->SliceBytes = header.Sizes[0] * header.Sizes[1] *
+                       static_cast<long long>(header.ScalarSize());
+    return true;
+  }
+
+  void Close()
+  {
+    if(this->File >= 0)
+      {
+      ::close(this->File);
+      }
+    this->File = -1;
+  }
+
+  //bytes of a single z slice of points
+  long long GetSliceBytes() const
+    { return this->SliceBytes; }
+
+  // Read the numSlices slices from zBegin on into out, which has to hold
+  // numSlices * GetSliceBytes() bytes
+  bool Read(long long zBegin, long long numSlices, char* out) const
+  {
+    std::size_t size = static_cast<std::size_t>(numSlices * this->SliceBytes);
+    off_t offset = static_cast<off_t>(this->PayloadOffset + zBegin * this->SliceBytes);
+    char* data = out;
+    while(size > 0)
+      {
+      const ssize_t count = ::pread(this->File, data, size, offset);
+      if(count < 0 && errno == EINTR)
+        {
+        continue;
+        }
+      if(count <= 0)
+        {
+        return false;
+        }
+      data += count;
+      size -= static_cast<std::size_t>(count);
+      offset += count;
+      }
+
+    if(this->Header.NeedsByteSwap())
+      {
+      const std::size_t numValues =
+        static_cast<std::size_t>(numSlices * this->Header.Sizes[0] * this->Header.Sizes[1]);
+      ByteSwap(out, numValues, this->Header.ScalarSize());
+      }
+    return true;
+  }
+
+  //let the kernel start reading slices in the background
+  void Prefetch(long long zBegin, long long numSlices) const
+  {
+#ifdef POSIX_FADV_WILLNEED
+    ::posix_fadvise(this->File,
+                    static_cast<off_t>(this->PayloadOffset + zBegin * this->SliceBytes),
+                    static_cast<off_t>(numSlices * this->SliceBytes),
+                    POSIX_FADV_WILLNEED);
+#else
+    (void)zBegin;
+    (void)numSlices;
+#endif
+  }
+
+private:
+  NrrdSlabReader(const NrrdSlabReader&);
+  void operator=(const NrrdSlabReader&);
+
+  NrrdHeader Header;
+  int File;
+  long long PayloadOffset;
+  long long SliceBytes;
+};
+
+}
+
+#endif
@@ -0,0 +1,607 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __numaPlacement_h
+#define __numaPlacement_h
+
+#include <vtkm/Types.h>
+#include <vtkm/cont/DeviceAdapterAlgorithm.h>
+#include <vtkm/exec/FunctorBase.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <malloc.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+//observers of a single arena, which older TBB releases ship as a preview
+#ifndef TBB_PREVIEW_LOCAL_OBSERVER
+#define TBB_PREVIEW_LOCAL_OBSERVER 1
+#endif
+#include <tbb/task_arena.h>
+#include <tbb/task_scheduler_observer.h>
+#endif
+
+#include "compare_runner.h"
+
+namespace bench
+{
+
+//how the pages of a placed buffer are backed
+enum HugePageMode
+{
+  HUGE_PAGES_NONE,
+  //transparent huge pages, asked for with madvise
+  HUGE_PAGES_TRANSPARENT,
+  //pages of the reserved hugetlbfs pool, see /proc/sys/vm/nr_hugepages
+  HUGE_PAGES_HUGETLB
+};
+
+static bool HugePageModeFromName(const std::string& name, HugePageMode& mode)
+{
+  if(name.empty() || name == "none")
+    {
+    mode = HUGE_PAGES_NONE;
+    }
+  else if(name == "thp")
+    {
+    mode = HUGE_PAGES_TRANSPARENT;
+    }
+  else if(name == "hugetlb")
+    {
+    mode = HUGE_PAGES_HUGETLB;
+    }
+  else
+    {
+    return false;
+    }
+  return true;
+}
+
+static const char* HugePageModeName(HugePageMode mode)
+{
+  switch(mode)
+    {
+    case HUGE_PAGES_TRANSPARENT: return "thp";
+    case HUGE_PAGES_HUGETLB: return "hugetlb";
+    default: return "none";
+    }
+}
+
+//first line of a sysfs or procfs file, empty if it can't be read
+static std::string ReadSysLine(const std::string& path)
+{
+  std::ifstream in(path.c_str());
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+// Parse a kernel cpu list such as "0-7,16-23" into the cpus it names.
+static bool ParseCpuList(const std::string& list, std::vector<int>& cpus)
+{
+  std::istringstream ranges(list);
+  std::string range;
+  while(std::getline(ranges, range, ','))
+    {
+    if(range.empty() || range == "\n")
+      {
+      continue;
+      }
+    int first = 0;
+    int last = 0;
+    char dash = 0;
+    std::istringstream bounds(range);
+    if(!(bounds >> first))
+      {
+      return false;
+      }
+    last = first;
+    if(bounds >> dash)
+      {
+      if(dash != '-' || !(bounds >> last) || last < first)
+        {
+        return false;
+        }
+      }
+    for(int cpu=first; cpu <= last; ++cpu)
+      {
+      cpus.push_back(cpu);
+      }
+    }
+  return true;
+}
+
+// The NUMA nodes of the machine and the cpus of each, read from
+// /sys/devices/system/node. On the machines we run on a node is a socket.
+// Within a node the first hardware thread of every core comes before the
+// hyperthread siblings, so that pinning threads in that order fills the
+// physical cores of a socket before anything else. When sysfs has no node
+// directory the machine is one node holding every online cpu.
+class NumaTopology
+{
+public:
+  NumaTopology()
+  {
+    DIR* dir = ::opendir("/sys/devices/system/node");
+    std::vector<int> nodeIds;
+    if(dir)
+      {
+      while(dirent* entry = ::readdir(dir))
+        {
+        int id = 0;
+        if(std::sscanf(entry->d_name, "node%d", &id) == 1)
+          {
+          nodeIds.push_back(id);
+          }
+        }
+      ::closedir(dir);
+      }
+    std::sort(nodeIds.begin(), nodeIds.end());
+
+    for(std::size_t i=0; i < nodeIds.size(); ++i)
+      {
+      std::ostringstream path;
+      path << "/sys/devices/system/node/node" << nodeIds[i] << "/cpulist";
+      std::vector<int> cpus;
+      if(ParseCpuList(ReadSysLine(path.str()), cpus) && !cpus.empty())
+        {
+        this->NodeIds.push_back(nodeIds[i]);
+        this->Cpus.push_back(CoresFirst(cpus));
+        }
+      }
+
+    if(this->Cpus.empty())
+      {
+      std::vector<int> cpus;
+      const long numCpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+      for(long cpu=0; cpu < std::max(numCpus, 1L); ++cpu)
+        {
+        cpus.push_back(static_cast<int>(cpu));
+        }
+      this->NodeIds.push_back(0);
+      this->Cpus.push_back(cpus);
+      }
+  }
+
+  int GetNumberOfNodes() const
+    { return static_cast<int>(this->Cpus.size()); }
+
+  //kernel id of the node at index, the one move_pages reports
+  int GetNodeId(int index) const
+    { return this->NodeIds[index]; }
+
+  const std::vector<int>& GetCpus(int index) const
+    { return this->Cpus[index]; }
+
+  //cpus of the smallest node, the number of cores a socket adds
+  int GetCpusPerNode() const
+  {
+    std::size_t cpusPerNode = this->Cpus.front().size();
+    for(std::size_t i=1; i < this->Cpus.size(); ++i)
+      {
+      cpusPerNode = std::min(cpusPerNode, this->Cpus[i].size());
+      }
+    return static_cast<int>(cpusPerNode);
+  }
+
+  //every cpu, node after node, in the order threads are pinned in
+  std::vector<int> CompactCpuOrder() const
+  {
+    std::vector<int> order;
+    for(std::size_t i=0; i < this->Cpus.size(); ++i)
+      {
+      order.insert(order.end(), this->Cpus[i].begin(), this->Cpus[i].end());
+      }
+    return order;
+  }
+
+private:
+  //first thread of each core, then the remaining siblings
+  static std::vector<int> CoresFirst(const std::vector<int>& cpus)
+  {
+    std::vector<int> primary;
+    std::vector<int> siblings;
+    for(std::size_t i=0; i < cpus.size(); ++i)
+      {
+      std::ostringstream path;
+      path << "/sys/devices/system/cpu/cpu" << cpus[i] << "/topology/thread_siblings_list";
+      std::vector<int> threads;
+      if(ParseCpuList(ReadSysLine(path.str()), threads) && !threads.empty() &&
+         *std::min_element(threads.begin(), threads.end()) != cpus[i])
+        {
+        siblings.push_back(cpus[i]);
+        }
+      else
+        {
+        primary.push_back(cpus[i]);
+        }
+      }
+    primary.insert(primary.end(), siblings.begin(), siblings.end());
+    return primary;
+  }
+
+  std::vector<int> NodeIds;
+  std::vector< std::vector<int> > Cpus;
+};
+
+//pin the calling thread to a single cpu
+static bool PinCurrentThread(int cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+// Pins every thread running in the arena of a CoreLimit to its own cpu for
+// the lifetime of the object. Thread slot i of the arena, the thread that
+// calls Execute being slot 0, goes to the i-th cpu of the compact order, so
+// a run limited to n cores uses the first n cores of socket 0 and only
+// spills onto the next socket once that one is full. The observer is local
+// to the arena, so a worker is pinned again each time it joins a limit of
+// another core count, to the slot it has there.
+class ThreadPinner : public tbb::task_scheduler_observer
+{
+public:
+  ThreadPinner(CoreLimit& limit, const std::vector<int>& cpus):
+    tbb::task_scheduler_observer(limit.GetArena()),
+    Cpus(cpus)
+    {
+    if(!this->Cpus.empty())
+      {
+      PinCurrentThread(this->Cpus.front());
+      this->observe(true);
+      }
+    }
+
+  ~ThreadPinner()
+    {
+    this->observe(false);
+    }
+
+  virtual void on_scheduler_entry(bool)
+  {
+    const int slot = tbb::this_task_arena::current_thread_index();
+    if(slot >= 0)
+      {
+      PinCurrentThread(this->Cpus[static_cast<std::size_t>(slot) % this->Cpus.size()]);
+      }
+  }
+
+private:
+  ThreadPinner(const ThreadPinner&);
+  void operator=(const ThreadPinner&);
+
+  std::vector<int> Cpus;
+};
+#else
+//the other backends run the host side on the calling thread only
+class ThreadPinner
+{
+public:
+  ThreadPinner(CoreLimit&, const std::vector<int>& cpus)
+    {
+    if(!cpus.empty())
+      {
+      PinCurrentThread(cpus.front());
+      }
+    }
+
+private:
+  ThreadPinner(const ThreadPinner&);
+  void operator=(const ThreadPinner&);
+};
+#endif
+
+// Call functor() limited to numCores threads, pinned to cpus in compact
+// order unless cpus is empty
+template<typename Functor>
+static void RunOnCores(int numCores, const std::vector<int>& cpus, Functor& functor)
+{
+  CoreLimit limit(numCores);
+  ThreadPinner pinner(limit, cpus);
+  limit.Execute(functor);
+}
+
+// Have malloc serve every allocation of 2MB or more with a fresh mmap and
+// give it back with munmap on free. The VTK-m output arrays are allocated
+// that way from then on, so their pages are untouched when the worklets
+// that fill them run and each one lands on the node of the thread that
+// writes it first, instead of being recycled from a heap the main thread
+// touched. Whether they get transparent huge pages is up to the system
+// setting, see SystemHugePageMode.
+static void UseFreshPagesForLargeAllocations()
+{
+  const int threshold = 2 * 1024 * 1024;
+  ::mallopt(M_MMAP_THRESHOLD, threshold);
+}
+
+//the bracketed choice of /sys/kernel/mm/transparent_hugepage/enabled
+static std::string SystemHugePageMode()
+{
+  const std::string line = ReadSysLine("/sys/kernel/mm/transparent_hugepage/enabled");
+  const std::string::size_type open = line.find('[');
+  const std::string::size_type close = line.find(']', open);
+  if(open == std::string::npos || close == std::string::npos)
+    {
+    return "unknown";
+    }
+  return line.substr(open + 1, close - open - 1);
+}
+
+// An anonymous memory mapping for a large buffer, whose pages are only
+// allocated, on the node of the thread touching them, when first written.
+// Transparent huge pages are asked for with madvise on a mapping aligned
+// to 2MB, hugetlb pages need a pool reserved by the administrator and
+// Allocate fails when there isn't one big enough.
+class PlacedBuffer
+{
+public:
+  PlacedBuffer():
+    Mapping(NULL),
+    MappingLength(0),
+    Data(NULL),
+    Length(0),
+    Mode(HUGE_PAGES_NONE)
+    {
+    }
+
+  ~PlacedBuffer()
+    {
+    this->Release();
+    }
+
+  bool Allocate(std::size_t length, HugePageMode mode, std::string& error)
+  {
+    this->Release();
+    const std::size_t hugePageSize = 2 * 1024 * 1024;
+    const std::size_t rounded = (length + hugePageSize - 1) / hugePageSize * hugePageSize;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    std::size_t mappingLength = std::max(rounded, hugePageSize);
+    if(mode == HUGE_PAGES_HUGETLB)
+      {
+      flags |= MAP_HUGETLB;
+      }
+    else
+      {
+      //room to align the start to a huge page
+      mappingLength += hugePageSize;
+      }
+
+    void* mapping = ::mmap(NULL, mappingLength, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if(mapping == MAP_FAILED)
+      {
+      error = std::string("mmap failed: ") + std::strerror(errno);
+      return false;
+      }
+
+    char* data = static_cast<char*>(mapping);
+    if(mode != HUGE_PAGES_HUGETLB)
+      {
+      const std::size_t offset = reinterpret_cast<std::size_t>(data) % hugePageSize;
+      data += (offset == 0) ? 0 : (hugePageSize - offset);
+      }
+    if(mode == HUGE_PAGES_TRANSPARENT &&
+       ::madvise(data, rounded, MADV_HUGEPAGE) != 0)
+      {
+      error = std::string("madvise(MADV_HUGEPAGE) failed: ") + std::strerror(errno);
+      ::munmap(mapping, mappingLength);
+      return false;
+      }
+
+    this->Mapping = mapping;
+    this->MappingLength = mappingLength;
+    this->Data = data;
+    this->Length = length;
+    this->Mode = mode;
+    return true;
+  }
+
+  void* GetData() const
+    { return this->Data; }
+
+  std::size_t GetLength() const
+    { return this->Length; }
+
+  HugePageMode GetHugePageMode() const
+    { return this->Mode; }
+
+private:
+  PlacedBuffer(const PlacedBuffer&);
+  void operator=(const PlacedBuffer&);
+
+  void Release()
+  {
+    if(this->Mapping)
+      {
+      ::munmap(this->Mapping, this->MappingLength);
+      }
+    this->Mapping = NULL;
+    this->MappingLength = 0;
+    this->Data = NULL;
+    this->Length = 0;
+  }
+
+  void* Mapping;
+  std::size_t MappingLength;
+  void* Data;
+  std::size_t Length;
+  HugePageMode Mode;
+};
+
+// Copies values with the host device adapter, so the pages of the output
+// are first touched by the threads, and in the blocked ranges, the TBB
+// backend later hands the point ids of the volume to. The isosurface
+// worklets schedule over cells, whose ids follow the point ids closely
+// enough that a thread mostly reads the pages it placed.
+template<typename T>
+struct FirstTouchCopy : public vtkm::exec::FunctorBase
+{
+  FirstTouchCopy(const T* input, T* output):
+    Input(input),
+    Output(output)
+    {
+    }
+
+  VTKM_EXEC_EXPORT
+  void operator()(vtkm::Id index) const
+  {
+    this->Output[index] = this->Input[index];
+  }
+
+  const T* Input;
+  T* Output;
+};
+
+template<typename T>
+static void ParallelFirstTouchCopy(const T* input, T* output, vtkm::Id numValues)
+{
+  typedef vtkm::cont::DeviceAdapterAlgorithm<HostDeviceAdapterTag> Algorithm;
+  Algorithm::Schedule(FirstTouchCopy<T>(input, output), numValues);
+  Algorithm::Synchronize();
+}
+
+// Fraction of the pages of [data, data + length) on each node of the
+// topology, asked of the kernel with move_pages in query mode. Large
+// buffers are sampled, at most 65536 pages are looked at. Empty when the
+// kernel doesn't support the query, e.g. without NUMA support.
+static std::vector<double> PagesPerNode(const void* data, std::size_t length,
+                                        const NumaTopology& topology)
+{
+  std::vector<double> fractions;
+  const std::size_t pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  const std::size_t numPages = (length + pageSize - 1) / pageSize;
+  if(numPages == 0)
+    {
+    return fractions;
+    }
+  const std::size_t maxSamples = 65536;
+  const std::size_t stride = std::max<std::size_t>(1, numPages / maxSamples);
+
+  std::vector<void*> pages;
+  for(std::size_t i=0; i < numPages; i += stride)
+    {
+    pages.push_back(const_cast<char*>(static_cast<const char*>(data)) + i * pageSize);
+    }
+  std::vector<int> status(pages.size(), -1);
+  if(::syscall(SYS_move_pages, 0, static_cast<unsigned long>(pages.size()),
+               &pages[0], NULL, &status[0], 0) != 0)
+    {
+    return fractions;
+    }
+
+  fractions.resize(static_cast<std::size_t>(topology.GetNumberOfNodes()), 0.0);
+  for(std::size_t i=0; i < status.size(); ++i)
+    {
+    for(int node=0; node < topology.GetNumberOfNodes(); ++node)
+      {
+      if(status[i] == topology.GetNodeId(node))
+        {
+        fractions[node] += 1.0 / static_cast<double>(status.size());
+        }
+      }
+    }
+  return fractions;
+}
+
+// Bytes of the mapping holding address that are backed by huge pages,
+// transparent or hugetlb, according to /proc/self/smaps. -1 if the
+// mapping isn't found.
+static long long HugePageBytes(const void* address)
+{
+  std::ifstream smaps("/proc/self/smaps");
+  const unsigned long target = reinterpret_cast<unsigned long>(address);
+  std::string line;
+  bool inMapping = false;
+  bool found = false;
+  long long kiloBytes = 0;
+  while(std::getline(smaps, line))
+    {
+    unsigned long begin = 0;
+    unsigned long end = 0;
+    if(std::sscanf(line.c_str(), "%lx-%lx ", &begin, &end) == 2 &&
+       line.find(':') > line.find(' '))
+      {
+      if(inMapping)
+        {
+        break;
+        }
+      inMapping = (target >= begin && target < end);
+      found = found || inMapping;
+      continue;
+      }
+    if(!inMapping)
+      {
+      continue;
+      }
+    long long value = 0;
+    if(std::sscanf(line.c_str(), "AnonHugePages: %lld", &value) == 1 ||
+       std::sscanf(line.c_str(), "Private_Hugetlb: %lld", &value) == 1 ||
+       std::sscanf(line.c_str(), "Shared_Hugetlb: %lld", &value) == 1)
+      {
+      kiloBytes += value;
+      }
+    }
+  return found ? kiloBytes * 1024 : -1;
+}
+
+//print where the pages of a placed buffer ended up
+static void PrintPlacement(const std::string& name, const PlacedBuffer& buffer,
+                           HugePageMode requested, double firstTouchTime,
+                           const NumaTopology& topology)
+{
+  std::cout << "Placement \'" << name << "\' results:\n"
+            << "\tfirst touch time = " << firstTouchTime << "s\n"
+            << "\tmegabytes = " << buffer.GetLength() / (1024.0 * 1024.0) << "\n"
+            << "\thuge pages requested = " << HugePageModeName(requested) << "\n"
+            << "\thuge pages used = " << HugePageModeName(buffer.GetHugePageMode()) << "\n"
+            << "\tsystem thp mode = " << SystemHugePageMode() << "\n";
+  const long long hugeBytes = HugePageBytes(buffer.GetData());
+  if(hugeBytes >= 0)
+    {
+    std::cout << "\thuge page megabytes = " << hugeBytes / (1024.0 * 1024.0) << "\n";
+    }
+  const std::vector<double> fractions =
+    PagesPerNode(buffer.GetData(), buffer.GetLength(), topology);
+  for(std::size_t i=0; i < fractions.size(); ++i)
+    {
+    std::cout << "\tnode " << topology.GetNodeId(static_cast<int>(i))
+              << " pages = " << (fractions[i] * 100.0) << "%\n";
+    }
+  if(fractions.empty())
+    {
+    std::cout << "\tnode pages = unavailable\n";
+    }
+  std::cout.flush();
+}
+
+}
+
+#endif
@@ -0,0 +1,347 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __perfCounters_h
+#define __perfCounters_h
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench
+{
+
+//hardware events counted around each timed trial with --counters
+enum CounterType
+{
+  COUNTER_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  //last level cache misses
+  COUNTER_LLC_MISSES,
+  COUNTER_BRANCH_MISSES,
+  //cycles the back end was stalled, mostly waiting on memory
+  COUNTER_STALLED_CYCLES,
+  NUM_COUNTERS
+};
+
+//name of a counter in the console output and the results file
+static const char* CounterName(int counter)
+{
+  static const char* names[NUM_COUNTERS] = { "cycles", "instructions",
+                                             "llc_misses", "branch_misses",
+                                             "stalled_cycles" };
+  return names[counter];
+}
+
+// Counts of every event for a thread or a sum of threads. Events the CPU
+// or the kernel can't count stay invalid with a count of 0. Counts are
+// scaled up when the kernel had to multiplex the event.
+struct CounterValues
+{
+  CounterValues()
+    {
+    for(int i=0; i < NUM_COUNTERS; ++i)
+      {
+      this->Counts[i] = 0;
+      this->Valid[i] = false;
+      }
+    }
+
+  void Add(const CounterValues& other)
+  {
+    for(int i=0; i < NUM_COUNTERS; ++i)
+      {
+      this->Counts[i] += other.Counts[i];
+      this->Valid[i] = this->Valid[i] || other.Valid[i];
+      }
+  }
+
+  //counts[numerator] / counts[denominator], 0 if either isn't valid
+  double Ratio(int numerator, int denominator) const
+  {
+    if(!this->Valid[numerator] || !this->Valid[denominator] ||
+       this->Counts[denominator] == 0)
+      {
+      return 0.0;
+      }
+    return static_cast<double>(this->Counts[numerator]) /
+           static_cast<double>(this->Counts[denominator]);
+  }
+
+  //instructions per cycle
+  double IPC() const
+    { return this->Ratio(COUNTER_INSTRUCTIONS, COUNTER_CYCLES); }
+
+  //how often counter happened per output triangle, 0 if it isn't valid
+  double PerTriangle(int counter, long long numTriangles) const
+  {
+    if(!this->Valid[counter] || numTriangles <= 0)
+      {
+      return 0.0;
+      }
+    return static_cast<double>(this->Counts[counter]) / static_cast<double>(numTriangles);
+  }
+
+  long long Counts[NUM_COUNTERS];
+  bool Valid[NUM_COUNTERS];
+};
+
+struct ThreadCounters
+{
+  ThreadCounters():
+    ThreadId(0)
+    {
+    }
+
+  long long ThreadId;
+  CounterValues Values;
+};
+
+//counters of a single trial, per thread of the process and summed up
+struct TrialCounters
+{
+  std::vector<ThreadCounters> Threads;
+  CounterValues Total;
+};
+
+// Counts hardware events of every thread of the process through
+// perf_event_open. Events are opened per thread rather than inherited, as
+// the worker threads of the device adapter exist before a trial starts, so
+// each trial can be broken down per thread. Only user space is counted, so
+// that the default perf_event_paranoid setting allows it.
+class PerfCounters
+{
+public:
+  PerfCounters():
+    NumThreads(0)
+    {
+    for(int i=0; i < NUM_COUNTERS; ++i)
+      {
+      this->Supported[i] = false;
+      }
+    }
+
+  ~PerfCounters()
+    {
+    this->Close();
+    }
+
+  // Check which events can be counted on this machine. Returns false and
+  // sets error when not even cycles can be counted, in which case Start and
+  // Stop do nothing. Other events that can't be counted are left out.
+  bool Initialize(std::string& error)
+  {
+#ifdef __linux__
+    for(int i=0; i < NUM_COUNTERS; ++i)
+      {
+      const int fd = OpenEvent(i, 0);
+      this->Supported[i] = (fd >= 0);
+      if(fd >= 0)
+        {
+        ::close(fd);
+        }
+      else if(i == COUNTER_CYCLES)
+        {
+        error = std::strerror(errno);
+        if(errno == EACCES || errno == EPERM)
+          {
+          error += ", see /proc/sys/kernel/perf_event_paranoid";
+          }
+        else if(errno == ENOENT || errno == EOPNOTSUPP)
+          {
+          error += ", the CPU or hypervisor exposes no hardware counters";
+          }
+        }
+      }
+    return this->Supported[COUNTER_CYCLES];
+#else
+    error = "perf_event_open is only available on Linux";
+    return false;
+#endif
+  }
+
+  bool IsSupported(int counter) const
+    { return this->Supported[counter]; }
+
+  // Open the events on every thread the process has right now and start
+  // counting. Meant to be called right before the timed region, after the
+  // warmups have started the worker threads.
+  void Start()
+  {
+#ifdef __linux__
+    this->Close();
+    const std::vector<long long> threads = ThreadIds();
+    for(std::size_t t=0; t < threads.size(); ++t)
+      {
+      for(int i=0; i < NUM_COUNTERS; ++i)
+        {
+        if(!this->Supported[i])
+          {
+          continue;
+          }
+        Event event;
+        event.ThreadIndex = t;
+        event.ThreadId = threads[t];
+        event.Counter = i;
+        event.Fd = OpenEvent(i, static_cast<pid_t>(threads[t]));
+        if(event.Fd >= 0)
+          {
+          this->Events.push_back(event);
+          }
+        }
+      }
+    this->NumThreads = threads.size();
+
+    for(std::size_t i=0; i < this->Events.size(); ++i)
+      {
+      ::ioctl(this->Events[i].Fd, PERF_EVENT_IOC_RESET, 0);
+      }
+    for(std::size_t i=0; i < this->Events.size(); ++i)
+      {
+      ::ioctl(this->Events[i].Fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+  }
+
+  //stop counting and return what every thread counted since Start
+  TrialCounters Stop()
+  {
+    TrialCounters counters;
+#ifdef __linux__
+    for(std::size_t i=0; i < this->Events.size(); ++i)
+      {
+      ::ioctl(this->Events[i].Fd, PERF_EVENT_IOC_DISABLE, 0);
+      }
+
+    counters.Threads.resize(this->NumThreads);
+    for(std::size_t i=0; i < this->Events.size(); ++i)
+      {
+      const Event& event = this->Events[i];
+      ThreadCounters& thread = counters.Threads[event.ThreadIndex];
+      thread.ThreadId = event.ThreadId;
+
+      //value, time enabled, time running. A thread that was never
+      //scheduled while counting has nothing to scale and counted 0
+      unsigned long long values[3];
+      if(::read(event.Fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)))
+        {
+        continue;
+        }
+      double count = static_cast<double>(values[0]);
+      if(values[2] > 0 && values[2] < values[1])
+        {
+        count *= static_cast<double>(values[1]) / static_cast<double>(values[2]);
+        }
+      thread.Values.Counts[event.Counter] = static_cast<long long>(count);
+      thread.Values.Valid[event.Counter] = true;
+      }
+
+    for(std::size_t t=0; t < counters.Threads.size(); ++t)
+      {
+      counters.Total.Add(counters.Threads[t].Values);
+      }
+    this->Close();
+#endif
+    return counters;
+  }
+
+private:
+  PerfCounters(const PerfCounters&);
+  void operator=(const PerfCounters&);
+
+  struct Event
+  {
+    std::size_t ThreadIndex;
+    long long ThreadId;
+    int Counter;
+    int Fd;
+  };
+
+  void Close()
+  {
+#ifdef __linux__
+    for(std::size_t i=0; i < this->Events.size(); ++i)
+      {
+      ::close(this->Events[i].Fd);
+      }
+#endif
+    this->Events.clear();
+    this->NumThreads = 0;
+  }
+
+#ifdef __linux__
+  //open a disabled counter of the given event on thread tid, 0 for the
+  //calling thread. Returns -1 and sets errno when it can't.
+  static int OpenEvent(int counter, pid_t tid)
+  {
+    static const unsigned long long configs[NUM_COUNTERS] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES,
+      PERF_COUNT_HW_STALLED_CYCLES_BACKEND };
+
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[counter];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(::syscall(__NR_perf_event_open, &attr, tid, -1, -1, 0));
+  }
+
+  //ids of every thread of the process
+  static std::vector<long long> ThreadIds()
+  {
+    std::vector<long long> ids;
+    DIR* tasks = ::opendir("/proc/self/task");
+    if(!tasks)
+      {
+      ids.push_back(static_cast<long long>(::syscall(SYS_gettid)));
+      return ids;
+      }
+    while(dirent* entry = ::readdir(tasks))
+      {
+      if(entry->d_name[0] != '.')
+        {
+        ids.push_back(std::atoll(entry->d_name));
+        }
+      }
+    ::closedir(tasks);
+    return ids;
+  }
+#endif
+
+  bool Supported[NUM_COUNTERS];
+  std::vector<Event> Events;
+  std::size_t NumThreads;
+};
+
+}
+
+#endif
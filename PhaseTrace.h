@@ -0,0 +1,445 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __phaseTrace_h
+#define __phaseTrace_h
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace bench
+{
+
+//a phase of the benchmark, or the share of a phase a thread worked on,
+//times in nanoseconds of the monotonic clock
+struct PhaseEvent
+{
+  std::string Name;
+  long long Begin;
+  long long End;
+  //number of phases it is nested in
+  int Depth;
+  long long ThreadId;
+  //items of work the thread did in the phase, 0 for the phase itself
+  long long NumItems;
+};
+
+// Records nested phases, e.g. each dispatcher invocation of a filter, as
+// begin/end pairs. Phases are opened and closed by the thread running the
+// benchmark around the work it hands the device adapter, and kept in a
+// single buffer in the order they began. Every thread that works on a
+// phase, the benchmark thread among them when it takes part, records its
+// own share of it from inside the worklets with WorkItem: when it started
+// working on the phase, when it last did and how many items it did, in a
+// buffer of its own so recording takes no lock. These are only merged
+// with the phases when the trace is written, where they show how the work
+// of each phase was spread over the threads. Nothing at all is done while
+// the trace is disabled, which it is unless --phases or --trace asked for
+// it. Timestamps come from CLOCK_MONOTONIC, which unlike gettimeofday
+// never jumps and has nanosecond resolution.
+class PhaseTrace
+{
+public:
+  static bool IsEnabled()
+    { return Enabled(); }
+
+  static void SetEnabled(bool enabled)
+    { Enabled() = enabled; }
+
+  //nanoseconds of the monotonic clock
+  static long long Now()
+  {
+    timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+  }
+
+  //open a phase, nested in the ones already open
+  static void Begin(const std::string& name)
+  {
+    if(!Enabled())
+      {
+      return;
+      }
+    Buffer& buffer = GetBuffer();
+    PhaseEvent event;
+    event.Name = name;
+    event.Depth = static_cast<int>(buffer.Open.size());
+    event.ThreadId = static_cast<long long>(::syscall(SYS_gettid));
+    event.End = 0;
+    event.NumItems = 0;
+    buffer.Open.push_back(buffer.Events.size());
+    buffer.Events.push_back(event);
+    ++buffer.Serial;
+    buffer.Events.back().Begin = Now();
+  }
+
+  //close the innermost open phase
+  static void End()
+  {
+    if(!Enabled())
+      {
+      return;
+      }
+    const long long now = Now();
+    Buffer& buffer = GetBuffer();
+    if(buffer.Open.empty())
+      {
+      return;
+      }
+    buffer.Events[buffer.Open.back()].End = now;
+    buffer.Open.pop_back();
+    ++buffer.Serial;
+  }
+
+  // Count an item of work of the innermost open phase done by the calling
+  // thread, e.g. a cell classified or a row of cells contoured. The first
+  // item of a phase on a thread begins the share of the thread, which then
+  // ends at its last item to within about WORK_CLOCK_INTERVAL: the clock
+  // is read every so many items, as many as take about that long, so that
+  // worklets doing little per item aren't slowed down by it. Worklets call
+  // it through BENCHMARK_TRACE_WORK_ITEM.
+  static void WorkItem()
+  {
+    if(!Enabled())
+      {
+      return;
+      }
+    WorkerBuffer& worker = CurrentWorkerBuffer();
+    const Buffer& buffer = GetBuffer();
+    if(worker.Serial != buffer.Serial)
+      {
+      worker.Serial = buffer.Serial;
+      worker.Recording = !buffer.Open.empty();
+      if(worker.Recording)
+        {
+        const PhaseEvent& phase = buffer.Events[buffer.Open.back()];
+        PhaseEvent event;
+        event.Name = phase.Name;
+        event.Depth = phase.Depth + 1;
+        event.ThreadId = worker.ThreadId;
+        event.NumItems = 0;
+        event.Begin = Now();
+        event.End = event.Begin;
+        worker.Events.push_back(event);
+        worker.Countdown = worker.Period;
+        }
+      }
+    if(!worker.Recording)
+      {
+      return;
+      }
+
+    PhaseEvent& event = worker.Events.back();
+    ++event.NumItems;
+    if(--worker.Countdown > 0)
+      {
+      return;
+      }
+    const long long now = Now();
+    if(now - event.End < WORK_CLOCK_INTERVAL / 2)
+      {
+      worker.Period *= 2;
+      }
+    else if(now - event.End > WORK_CLOCK_INTERVAL && worker.Period > 1)
+      {
+      worker.Period /= 2;
+      }
+    worker.Countdown = worker.Period;
+    event.End = now;
+  }
+
+  //number of phases begun so far, the cursor Events starts from
+  static std::size_t GetNumberOfEvents()
+    { return GetBuffer().Events.size(); }
+
+  // Phases begun from the first-th one on that have ended, in the order
+  // they began. Keeping the number of events from before a trial as the
+  // cursor gets the phases of that trial without going over the earlier
+  // ones again.
+  static std::vector<PhaseEvent> Events(std::size_t first = 0)
+  {
+    std::vector<PhaseEvent> events;
+    const std::vector<PhaseEvent>& recorded = GetBuffer().Events;
+    for(std::size_t i=first; i < recorded.size(); ++i)
+      {
+      if(recorded[i].End != 0)
+        {
+        events.push_back(recorded[i]);
+        }
+      }
+    return events;
+  }
+
+  //the shares of the phases every thread worked on, in no given order.
+  //Not meant to be called while worklets run.
+  static std::vector<PhaseEvent> WorkEvents()
+  {
+    std::vector<PhaseEvent> events;
+    pthread_mutex_lock(&Mutex());
+    const std::vector<WorkerBuffer*>& workers = WorkerBuffers();
+    for(std::size_t i=0; i < workers.size(); ++i)
+      {
+      events.insert(events.end(), workers[i]->Events.begin(), workers[i]->Events.end());
+      }
+    pthread_mutex_unlock(&Mutex());
+    return events;
+  }
+
+  // Write every recorded phase and the share every thread worked on of it
+  // as a Chrome trace event file, which chrome://tracing and
+  // ui.perfetto.dev open. Each is a complete ("X") event on the row of its
+  // thread: the phases on the one of the benchmark thread, the shares,
+  // with the number of items done, on the one of every worker, under the
+  // phases when the benchmark thread worked too.
+  static bool WriteChromeTrace(const std::string& path)
+  {
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+    if(!out)
+      {
+      return false;
+      }
+
+    const std::vector<PhaseEvent> events = Events();
+    const std::vector<PhaseEvent> work = WorkEvents();
+    const long long origin = events.empty() ? 0 : events.front().Begin;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for(std::size_t i=0; i < events.size() + work.size(); ++i)
+      {
+      const bool isWork = i >= events.size();
+      const PhaseEvent& event = isWork ? work[i - events.size()] : events[i];
+      char times[96];
+      std::sprintf(times, "\"ts\":%.3f,\"dur\":%.3f",
+                   static_cast<double>(event.Begin - origin) / 1000.0,
+                   static_cast<double>(event.End - event.Begin) / 1000.0);
+      out << (i > 0 ? ",\n" : "")
+          << "{\"name\":\"" << EscapeName(event.Name) << "\",\"cat\":\""
+          << (isWork ? "work" : "phase") << "\",\"ph\":\"X\","
+          << times << ",\"pid\":" << ::getpid() << ",\"tid\":" << event.ThreadId;
+      if(isWork)
+        {
+        out << ",\"args\":{\"items\":" << event.NumItems << "}";
+        }
+      out << "}";
+      }
+    out << "\n]}\n";
+    out.flush();
+    return static_cast<bool>(out);
+  }
+
+private:
+  //nanoseconds WorkItem aims at between two reads of the clock
+  static const long long WORK_CLOCK_INTERVAL = 10000;
+
+  struct Buffer
+  {
+    Buffer():
+      Serial(0)
+      {
+      }
+
+    std::vector<PhaseEvent> Events;
+    //index in Events of the phases still open, innermost last
+    std::vector<std::size_t> Open;
+    //changes whenever a phase begins or ends
+    long long Serial;
+  };
+
+  struct WorkerBuffer
+  {
+    long long ThreadId;
+    std::vector<PhaseEvent> Events;
+    //the Serial of Buffer when the thread last did an item, and whether a
+    //phase was open then
+    long long Serial;
+    bool Recording;
+    //items between two reads of the clock, and left until the next one
+    long long Period;
+    long long Countdown;
+  };
+
+  static bool& Enabled()
+  {
+    static bool enabled = false;
+    return enabled;
+  }
+
+  static Buffer& GetBuffer()
+  {
+    static Buffer buffer;
+    return buffer;
+  }
+
+  static pthread_mutex_t& Mutex()
+  {
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    return mutex;
+  }
+
+  //the buffer of every thread that ever worked on a phase, kept until the
+  //process exits so the shares of finished threads stay in the trace
+  static std::vector<WorkerBuffer*>& WorkerBuffers()
+  {
+    static std::vector<WorkerBuffer*> buffers;
+    return buffers;
+  }
+
+  static WorkerBuffer& CurrentWorkerBuffer()
+  {
+    static __thread WorkerBuffer* current = NULL;
+    if(!current)
+      {
+      current = new WorkerBuffer;
+      current->ThreadId = static_cast<long long>(::syscall(SYS_gettid));
+      current->Serial = -1;
+      current->Recording = false;
+      current->Period = 1;
+      current->Countdown = 1;
+      pthread_mutex_lock(&Mutex());
+      WorkerBuffers().push_back(current);
+      pthread_mutex_unlock(&Mutex());
+      }
+    return *current;
+  }
+
+  static std::string EscapeName(const std::string& name)
+  {
+    std::string escaped;
+    for(std::size_t i=0; i < name.size(); ++i)
+      {
+      if(name[i] == '"' || name[i] == '\\')
+        {
+        escaped += '\\';
+        }
+      escaped += name[i];
+      }
+    return escaped;
+  }
+};
+
+// Counts an item of work of the current phase from inside a worklet. CUDA
+// threads can't record anything, in device code it does nothing.
+#ifdef __CUDA_ARCH__
+#define BENCHMARK_TRACE_WORK_ITEM()
+#else
+#define BENCHMARK_TRACE_WORK_ITEM() bench::PhaseTrace::WorkItem()
+#endif
+
+// Records a phase for the lifetime of the object. ScopedDevicePhase also
+// synchronizes the device adapter algorithm it is given before the phase
+// ends, so that asynchronous backends don't leak the work of a phase into
+// the next one.
+class ScopedPhase
+{
+public:
+  explicit ScopedPhase(const char* name)
+    {
+    if(PhaseTrace::IsEnabled())
+      {
+      PhaseTrace::Begin(name);
+      }
+    }
+
+  ~ScopedPhase()
+    {
+    PhaseTrace::End();
+    }
+
+private:
+  ScopedPhase(const ScopedPhase&);
+  void operator=(const ScopedPhase&);
+};
+
+template<typename AlgorithmType>
+class ScopedDevicePhase
+{
+public:
+  explicit ScopedDevicePhase(const char* name)
+    {
+    if(PhaseTrace::IsEnabled())
+      {
+      PhaseTrace::Begin(name);
+      }
+    }
+
+  ~ScopedDevicePhase()
+    {
+    if(PhaseTrace::IsEnabled())
+      {
+      AlgorithmType::Synchronize();
+      }
+    PhaseTrace::End();
+    }
+
+private:
+  ScopedDevicePhase(const ScopedDevicePhase&);
+  void operator=(const ScopedDevicePhase&);
+};
+
+// Time spent in each phase over the trials of a benchmark, phases named
+// the same are added up within a trial. Depth is the one of the phase
+// in the trial, for indenting.
+struct PhaseBreakdown
+{
+  std::string Name;
+  int Depth;
+  std::vector<double> Samples;
+};
+
+// Add the phases begun from the firstEvent-th one on, those of trial
+// number trial, to the breakdown. Phases are kept in the order they first
+// ran in, their depth is relative to the shallowest phase of the trial.
+static void AddTrialPhases(std::vector<PhaseBreakdown>& breakdown,
+                           std::size_t trial, std::size_t firstEvent)
+{
+  const std::vector<PhaseEvent> events = PhaseTrace::Events(firstEvent);
+  int minDepth = 0;
+  for(std::size_t i=0; i < events.size(); ++i)
+    {
+    minDepth = (i == 0) ? events[i].Depth : std::min(minDepth, events[i].Depth);
+    }
+
+  for(std::size_t i=0; i < events.size(); ++i)
+    {
+    const PhaseEvent& event = events[i];
+    std::size_t index = 0;
+    while(index < breakdown.size() && breakdown[index].Name != event.Name)
+      {
+      ++index;
+      }
+    if(index == breakdown.size())
+      {
+      PhaseBreakdown phase;
+      phase.Name = event.Name;
+      phase.Depth = event.Depth - minDepth;
+      breakdown.push_back(phase);
+      }
+    std::vector<double>& samples = breakdown[index].Samples;
+    samples.resize(trial + 1, 0.0);
+    samples[trial] += static_cast<double>(event.End - event.Begin) / 1.0e9;
+    }
+}
+
+}
+
+#endif
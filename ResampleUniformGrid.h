@@ -0,0 +1,229 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __resampleUniformGrid_h
+#define __resampleUniformGrid_h
+
+#include <vtkm/Types.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/cont/Timer.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/WorkletMapField.h>
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include "ScalarTypes.h"
+#include "Volume.h"
+
+namespace bench
+{
+
+// Trilinear resampling of a point field on a uniform grid to a grid with
+// a different number of points covering the same bounds. Every output
+// point is computed independently, so the dispatch runs in parallel on
+// whichever device adapter is active. The output keeps the scalar type
+// of the input, integer samples are rounded to the nearest value.
+template<typename FieldType, typename DeviceAdapter>
+class ResampleUniformGrid
+{
+public:
+  typedef typename ScalarTraits<FieldType>::ComputeType ComputeType;
+
+  class Trilinear : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> outputIndex);
+    typedef void ExecutionSignature(_1);
+    typedef _1 InputDomain;
+
+    typedef typename vtkm::cont::ArrayHandle<FieldType>::template ExecutionTypes<DeviceAdapter>::PortalConst InPortalType;
+    typedef typename vtkm::cont::ArrayHandle<FieldType>::template ExecutionTypes<DeviceAdapter>::Portal OutPortalType;
+
+    VTKM_CONT_EXPORT
+    Trilinear(const InPortalType& input, const vtkm::Id3& inDims,
+              const OutPortalType& output, const vtkm::Id3& outDims):
+      Input(input),
+      InDims(inDims),
+      Output(output),
+      OutDims(outDims),
+      Rounding(std::numeric_limits<FieldType>::is_integer ? ComputeType(0.5) : ComputeType(0))
+      {
+      for(int i=0; i < 3; ++i)
+        {
+        this->Scale[i] = (outDims[i] > 1) ?
+          static_cast<ComputeType>(inDims[i] - 1) / static_cast<ComputeType>(outDims[i] - 1) : ComputeType(0);
+        }
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id outIndex) const
+    {
+      const vtkm::Id outIjk[3] = { outIndex % this->OutDims[0],
+                                   (outIndex / this->OutDims[0]) % this->OutDims[1],
+                                   outIndex / (this->OutDims[0] * this->OutDims[1]) };
+
+      //lower corner of the input cell holding the sample and the
+      //parametric position of the sample inside of it
+      vtkm::Id lower[3];
+      ComputeType t[3];
+      for(int i=0; i < 3; ++i)
+        {
+        const ComputeType pos = this->Scale[i] * static_cast<ComputeType>(outIjk[i]);
+        lower[i] = static_cast<vtkm::Id>(pos);
+        if(lower[i] > this->InDims[i] - 2)
+          {
+          lower[i] = (this->InDims[i] > 1) ? this->InDims[i] - 2 : 0;
+          }
+        t[i] = (this->InDims[i] > 1) ? pos - static_cast<ComputeType>(lower[i]) : ComputeType(0);
+        }
+
+      const vtkm::Id xStep = (this->InDims[0] > 1) ? 1 : 0;
+      const vtkm::Id yStep = (this->InDims[1] > 1) ? this->InDims[0] : 0;
+      const vtkm::Id zStep = (this->InDims[2] > 1) ? this->InDims[0] * this->InDims[1] : 0;
+      const vtkm::Id base = lower[0] + this->InDims[0] * (lower[1] + this->InDims[1] * lower[2]);
+
+      const ComputeType v000 = static_cast<ComputeType>(this->Input.Get(base));
+      const ComputeType v100 = static_cast<ComputeType>(this->Input.Get(base + xStep));
+      const ComputeType v010 = static_cast<ComputeType>(this->Input.Get(base + yStep));
+      const ComputeType v110 = static_cast<ComputeType>(this->Input.Get(base + yStep + xStep));
+      const ComputeType v001 = static_cast<ComputeType>(this->Input.Get(base + zStep));
+      const ComputeType v101 = static_cast<ComputeType>(this->Input.Get(base + zStep + xStep));
+      const ComputeType v011 = static_cast<ComputeType>(this->Input.Get(base + zStep + yStep));
+      const ComputeType v111 = static_cast<ComputeType>(this->Input.Get(base + zStep + yStep + xStep));
+
+      const ComputeType v00 = v000 + t[0] * (v100 - v000);
+      const ComputeType v10 = v010 + t[0] * (v110 - v010);
+      const ComputeType v01 = v001 + t[0] * (v101 - v001);
+      const ComputeType v11 = v011 + t[0] * (v111 - v011);
+      const ComputeType v0 = v00 + t[1] * (v10 - v00);
+      const ComputeType v1 = v01 + t[1] * (v11 - v01);
+      this->Output.Set(outIndex, static_cast<FieldType>(v0 + t[2] * (v1 - v0) + this->Rounding));
+    }
+
+  private:
+    InPortalType Input;
+    vtkm::Id3 InDims;
+    OutPortalType Output;
+    vtkm::Id3 OutDims;
+    ComputeType Rounding;
+    ComputeType Scale[3];
+  };
+
+  //number of points along each axis once resampled by ratio
+  static vtkm::Id3 OutputDimensions(const vtkm::Id3& inDims, double ratio)
+  {
+    vtkm::Id3 outDims;
+    for(int i=0; i < 3; ++i)
+      {
+      outDims[i] = static_cast<vtkm::Id>(std::floor((inDims[i] - 1) * ratio)) + 1;
+      if(outDims[i] < 2 && inDims[i] > 1)
+        {
+        outDims[i] = 2;
+        }
+      }
+    return outDims;
+  }
+
+  static void Run(const vtkm::cont::ArrayHandle<FieldType>& input,
+                  const vtkm::Id3& inDims,
+                  const vtkm::Id3& outDims,
+                  vtkm::cont::ArrayHandle<FieldType>& output)
+  {
+    const vtkm::Id numOutputValues = outDims[0] * outDims[1] * outDims[2];
+
+    Trilinear worklet(input.PrepareForInput(DeviceAdapter()), inDims,
+                      output.PrepareForOutput(numOutputValues, DeviceAdapter()),
+                      outDims);
+    vtkm::worklet::DispatcherMapField<Trilinear, DeviceAdapter> dispatcher(worklet);
+    dispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numOutputValues));
+  }
+};
+
+// Replaces the values of a volume, stored as FieldType, by their resampling
+// on DeviceAdapter
+template<typename DeviceAdapter>
+struct ResampleVolumeFunctor
+{
+  ResampleVolumeFunctor(bench::Volume& volume, const vtkm::Id3& inDims,
+                        const vtkm::Id3& outDims):
+    Target(volume),
+    InDims(inDims),
+    OutDims(outDims)
+    {
+    }
+
+  template<typename FieldType>
+  void operator()(FieldType)
+  {
+    typedef ResampleUniformGrid<FieldType, DeviceAdapter> Resampler;
+
+    vtkm::cont::ArrayHandle<FieldType> output;
+    Resampler::Run(this->Target.GetArrayHandle<FieldType>(),
+                   this->InDims, this->OutDims, output);
+
+    const int newDims[3] = { static_cast<int>(this->OutDims[0]),
+                             static_cast<int>(this->OutDims[1]),
+                             static_cast<int>(this->OutDims[2]) };
+    this->Target.SetArrayHandle(output, newDims);
+  }
+
+  bench::Volume& Target;
+  vtkm::Id3 InDims;
+  vtkm::Id3 OutDims;
+};
+
+// Replace the values of a volume by a trilinear resampling of them, scaled
+// by ratio along every axis, in the scalar type the volume has. The spacing
+// is adjusted so the resampled volume covers the same bounds. The time the
+// resampling takes is reported on its own so it is never confused with the
+// benchmarks. Runs on the device adapter of the tag it is given.
+template<typename DeviceAdapter>
+static void ResampleVolume(bench::Volume& volume, double ratio, DeviceAdapter)
+{
+  int dims[3];
+  volume.GetDimensions(dims);
+  const vtkm::Id3 inDims(dims[0], dims[1], dims[2]);
+  const vtkm::Id3 outDims =
+    ResampleUniformGrid<vtkm::Float32, DeviceAdapter>::OutputDimensions(inDims, ratio);
+
+  double spacing[3];
+  for(int i=0; i < 3; ++i)
+    {
+    spacing[i] = volume.GetSpacing()[i];
+    if(outDims[i] > 1)
+      {
+      spacing[i] *= static_cast<double>(inDims[i] - 1) / static_cast<double>(outDims[i] - 1);
+      }
+    }
+
+  vtkm::cont::Timer<> timer;
+  ResampleVolumeFunctor<DeviceAdapter> resample(volume, inDims, outDims);
+  CastAndCallScalarType(volume.GetScalarType(), resample);
+  const double resampleTime = timer.GetElapsedTime();
+  volume.SetSpacing(spacing);
+
+  std::cout << "Resample results:\n"
+            << "\tratio = " << ratio << "\n"
+            << "\tscalar type = " << ScalarTypeName(volume.GetScalarType()) << "\n"
+            << "\tinput dims = " << inDims[0] << ", " << inDims[1] << ", " << inDims[2] << "\n"
+            << "\toutput dims = " << outDims[0] << ", " << outDims[1] << ", " << outDims[2] << "\n"
+            << "\ttime = " << resampleTime << "s" << std::endl;
+}
+}
+
+#endif
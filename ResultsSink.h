@@ -0,0 +1,588 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __resultsSink_h
+#define __resultsSink_h
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "compare_runner.h"
+
+//git revision the benchmarks were built from, written by CMake at every
+//build
+#ifdef BENCHMARK_HAS_GIT_HASH_HEADER
+#include "BenchmarkGitHash.h"
+#endif
+#ifndef BENCHMARK_GIT_HASH
+#define BENCHMARK_GIT_HASH "unknown"
+#endif
+
+namespace bench
+{
+
+// Describes the run every record written to the results file is tagged
+// with, so that records from many runs can be told apart once collected.
+struct RunInfo
+{
+  RunInfo():
+    File(""),
+    Device(""),
+    IsoValue(0.0f),
+    LoadTime(0.0),
+    Host(""),
+    GitHash(BENCHMARK_GIT_HASH),
+    StartTime("")
+    {
+    for(int i=0; i < 3; ++i)
+      {
+      this->Dimensions[i] = 0;
+      }
+    }
+
+  std::string File;
+  std::string Device;
+  int Dimensions[3];
+  float IsoValue;
+  double LoadTime;
+  PhaseMemory LoadMemory;
+  std::string Host;
+  std::string GitHash;
+  //UTC time the run started at, in ISO 8601
+  std::string StartTime;
+};
+
+static std::string HostName()
+{
+  char name[256];
+  if(::gethostname(name, sizeof(name)) != 0)
+    {
+    return "unknown";
+    }
+  name[sizeof(name) - 1] = '\0';
+  return name;
+}
+
+static std::string UtcTimeStamp()
+{
+  const std::time_t now = std::time(NULL);
+  std::tm utc;
+  char buffer[32];
+  if(::gmtime_r(&now, &utc) == NULL ||
+     std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc) == 0)
+    {
+    return "";
+    }
+  return buffer;
+}
+
+// A flat set of named values, kept in the order they were added. Values
+// are formatted when added, numbers with enough digits to round trip a
+// trial time. Numbers that aren't finite, e.g. the ratio of a benchmark
+// that took no time, are left empty: an empty CSV cell and null in JSON.
+class Record
+{
+public:
+  struct Field
+  {
+    std::string Key;
+    std::string Value;
+    bool IsString;
+  };
+
+  void Add(const std::string& key, const std::string& value)
+  {
+    this->Push(key, value, true);
+  }
+
+  void Add(const std::string& key, const char* value)
+  {
+    this->Push(key, value, true);
+  }
+
+  template<typename T>
+  void Add(const std::string& key, T value)
+  {
+    std::ostringstream str;
+    if(IsFinite(value))
+      {
+      str << std::setprecision(9) << value;
+      }
+    this->Push(key, str.str(), false);
+  }
+
+  //the field named key, NULL if the record has none
+  const Field* Find(const std::string& key) const
+  {
+    for(std::size_t i=0; i < this->Fields.size(); ++i)
+      {
+      if(this->Fields[i].Key == key)
+        {
+        return &this->Fields[i];
+        }
+      }
+    return NULL;
+  }
+
+  const std::vector<Field>& GetFields() const
+    { return this->Fields; }
+
+private:
+  //NaN is the only value not equal to itself, and inf - inf is NaN
+  template<typename T>
+  static bool IsFinite(T value)
+  {
+    return value == value && (value - value) == (value - value);
+  }
+
+  void Push(const std::string& key, const std::string& value, bool isString)
+  {
+    Field field;
+    field.Key = key;
+    field.Value = value;
+    field.IsString = isString;
+    this->Fields.push_back(field);
+  }
+
+  std::vector<Field> Fields;
+};
+
+// Writes benchmark results as machine readable records: one per timed
+// trial and one summary per benchmark run, plus one per thread and trial
+// when hardware counters were read, one per phase when they were traced
+// and one per MPI rank and trial in the MPI driver. Files ending in .csv
+// get CSV with a fixed set of columns, anything else gets JSON lines.
+// Records are appended, so a single file can collect many runs; the CSV
+// header is only written to an empty file, and a CSV file whose header
+// isn't the one of this build is refused.
+class ResultsSink
+{
+public:
+  enum FormatType { JSON_LINES, CSV };
+
+  ResultsSink():
+    Format(JSON_LINES)
+    {
+    }
+
+  bool Open(const std::string& path, const RunInfo& info)
+  {
+    this->Info = info;
+    this->Format = (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0) ?
+                   CSV : JSON_LINES;
+
+    //records would land under the wrong columns of a file written by a
+    //build with other ones
+    std::string existingHeader;
+    if(this->Format == CSV && ReadFirstLine(path, existingHeader) &&
+       existingHeader != HeaderLine())
+      {
+      std::cerr << "results file " << path << " has other columns than this "
+                << "build writes, use a new file" << std::endl;
+      return false;
+      }
+
+    this->Stream.open(path.c_str(), std::ios::out | std::ios::app);
+    if(!this->Stream)
+      {
+      std::cerr << "unable to open results file " << path << std::endl;
+      return false;
+      }
+
+    if(this->Format == CSV && this->Stream.tellp() == std::streampos(0))
+      {
+      this->Stream << HeaderLine() << "\n";
+      //the children of isolated contenders would write it again otherwise
+      this->Stream.flush();
+      }
+    return true;
+  }
+
+  bool IsOpen() const
+    { return this->Stream.is_open(); }
+
+  //write a record per trial of result followed by its summary record
+  void Write(const Result& result)
+  {
+    if(!this->IsOpen())
+      {
+      return;
+      }
+
+    for(std::size_t i=0; i < result.Samples.size(); ++i)
+      {
+      Record record = this->NewRecord("trial", result);
+      record.Add("trial", i);
+      record.Add("isovalue", this->Info.IsoValue);
+      record.Add("triangles", (i < result.NumTriangles.size()) ? result.NumTriangles[i] : 0);
+      record.Add("wall_time", result.Samples[i]);
+      if(i < result.TrialMemory.size())
+        {
+        const PhaseMemory& memory = result.TrialMemory[i];
+        record.Add("resident_bytes", memory.ResidentBytes);
+        record.Add("peak_resident_bytes", memory.PeakResidentBytes);
+        record.Add("allocated_bytes", memory.AllocatedBytes);
+        record.Add("allocation_calls", memory.AllocationCalls);
+        record.Add("peak_heap_bytes", memory.PeakHeapBytes);
+        }
+      if(i < result.Counters.size())
+        {
+        AddCounters(record, result.Counters[i].Total,
+                    (i < result.NumTriangles.size()) ? result.NumTriangles[i] : 0);
+        }
+      this->AddRunInfo(record);
+      this->Write(record);
+      }
+
+    //median time of every phase the contender recorded, when traced
+    const double trialMedian = result.Samples.empty() ? 0.0 : Median(result.Samples);
+    for(std::size_t i=0; i < result.Phases.size(); ++i)
+      {
+      const PhaseBreakdown& phase = result.Phases[i];
+      const double median = Median(phase.Samples);
+      Record record = this->NewRecord("phase", result);
+      record.Add("phase", phase.Name);
+      record.Add("phase_depth", phase.Depth);
+      record.Add("phase_median", median);
+      record.Add("phase_fraction", (trialMedian > 0.0) ? median / trialMedian : 0.0);
+      if(!result.PhaseNote.empty())
+        {
+        record.Add("phase_note", result.PhaseNote);
+        }
+      this->AddRunInfo(record);
+      this->Write(record);
+      }
+
+    //what each thread counted on every trial, when counters were read
+    for(std::size_t i=0; i < result.Counters.size(); ++i)
+      {
+      const std::vector<ThreadCounters>& threads = result.Counters[i].Threads;
+      for(std::size_t t=0; t < threads.size(); ++t)
+        {
+        Record record = this->NewRecord("thread", result);
+        record.Add("trial", i);
+        record.Add("thread_id", threads[t].ThreadId);
+        AddCounters(record, threads[t].Values, 0);
+        this->AddRunInfo(record);
+        this->Write(record);
+        }
+      }
+
+    //compute and barrier time of each MPI rank on every trial
+    for(std::size_t r=0; r < result.Ranks.size(); ++r)
+      {
+      const RankTimes& rank = result.Ranks[r];
+      for(std::size_t i=0; i < rank.Compute.size(); ++i)
+        {
+        Record record = this->NewRecord("rank", result);
+        record.Add("trial", i);
+        record.Add("rank", rank.Rank);
+        record.Add("compute_time", rank.Compute[i]);
+        record.Add("barrier_time", (i < rank.Barrier.size()) ? rank.Barrier[i] : 0.0);
+        this->AddRunInfo(record);
+        this->Write(record);
+        }
+      }
+
+    const Summary summary = Summarize(result.Samples);
+    Record record = this->NewRecord("summary", result);
+    record.Add("isovalue", this->Info.IsoValue);
+    record.Add("triangles", result.NumTriangles.empty() ? 0 : result.NumTriangles.back());
+    record.Add("median", summary.Median);
+    record.Add("median_abs_dev", summary.MedianAbsDev);
+    record.Add("mean", summary.Mean);
+    record.Add("std_dev", summary.StdDev);
+    record.Add("min", summary.Min);
+    record.Add("max", summary.Max);
+    record.Add("num_trials", summary.NumSamples);
+    record.Add("median_ci_low", result.MedianInterval.low);
+    record.Add("median_ci_high", result.MedianInterval.high);
+    record.Add("stop_reason", result.StopReason);
+    record.Add("output_bytes", result.OutputBytes);
+    if(result.FieldBytes > 0)
+      {
+      record.Add("field_bytes", result.FieldBytes);
+      record.Add("field_bandwidth", FieldBandwidth(result));
+      }
+    if(!result.Ranks.empty())
+      {
+      record.Add("imbalance", RankImbalance(result));
+      }
+    if(!result.Counters.empty())
+      {
+      record.Add("ipc", MedianCounterMetric(result, InstructionsPerCycle()));
+      record.Add("llc_misses_per_triangle",
+                 MedianCounterMetric(result, CountPerTriangle(COUNTER_LLC_MISSES)));
+      record.Add("branch_misses_per_triangle",
+                 MedianCounterMetric(result, CountPerTriangle(COUNTER_BRANCH_MISSES)));
+      }
+    this->AddMemory(record, result);
+    this->AddRunInfo(record);
+    this->Write(record);
+    this->Stream.flush();
+  }
+
+  void Write(const Record& record)
+  {
+    if(this->Format == CSV)
+      {
+      this->WriteCSV(record);
+      }
+    else
+      {
+      this->WriteJSON(record);
+      }
+  }
+
+private:
+  ResultsSink(const ResultsSink&);
+  void operator=(const ResultsSink&);
+
+  //every column a CSV record can fill, in order
+  static const std::vector<std::string>& Columns()
+  {
+    static std::vector<std::string> columns;
+    if(columns.empty())
+      {
+      const char* names[] = { "record", "algorithm", "device", "cores",
+                              "dims_x", "dims_y", "dims_z", "scalar_type", "trial",
+                              "isovalue", "triangles", "wall_time",
+                              "median", "median_abs_dev", "mean", "std_dev",
+                              "min", "max", "num_trials", "median_ci_low",
+                              "median_ci_high", "stop_reason", "output_bytes",
+                              "field_bytes", "field_bandwidth",
+                              "resident_bytes", "peak_resident_bytes",
+                              "allocated_bytes", "allocation_calls",
+                              "peak_heap_bytes", "thread_id", "cycles",
+                              "instructions", "llc_misses", "branch_misses",
+                              "stalled_cycles", "ipc", "llc_misses_per_triangle",
+                              "branch_misses_per_triangle", "phase", "phase_depth",
+                              "phase_median", "phase_fraction", "phase_note", "ranks",
+                              "threads_per_rank", "rank", "compute_time",
+                              "barrier_time", "imbalance", "setup_resident_delta",
+                              "setup_allocated_bytes", "setup_allocation_calls",
+                              "teardown_resident_delta", "teardown_allocated_bytes",
+                              "load_time", "load_resident_delta",
+                              "load_peak_resident_bytes", "load_allocated_bytes",
+                              "file", "host", "git_hash", "start_time" };
+      columns.assign(names, names + sizeof(names) / sizeof(names[0]));
+      }
+    return columns;
+  }
+
+  Record NewRecord(const char* type, const Result& result) const
+  {
+    Record record;
+    record.Add("record", type);
+    record.Add("algorithm", result.Name);
+    record.Add("device", this->Info.Device);
+    record.Add("cores", result.NumCores);
+    if(!result.Ranks.empty())
+      {
+      record.Add("ranks", result.Ranks.size());
+      record.Add("threads_per_rank", result.NumCores / static_cast<int>(result.Ranks.size()));
+      }
+    record.Add("dims_x", this->Info.Dimensions[0]);
+    record.Add("dims_y", this->Info.Dimensions[1]);
+    record.Add("dims_z", this->Info.Dimensions[2]);
+    if(!result.ScalarType.empty())
+      {
+      record.Add("scalar_type", result.ScalarType);
+      }
+    return record;
+  }
+
+  // Memory of a whole benchmark: the trial columns hold the last trial,
+  // except for the peaks which are the highest of setup and every trial
+  void AddMemory(Record& record, const Result& result) const
+  {
+    const PhaseMemory last = result.TrialMemory.empty() ? PhaseMemory() : result.TrialMemory.back();
+    long long peakHeap = result.SetupMemory.PeakHeapBytes;
+    for(std::size_t i=0; i < result.TrialMemory.size(); ++i)
+      {
+      peakHeap = std::max(peakHeap, result.TrialMemory[i].PeakHeapBytes);
+      }
+    record.Add("resident_bytes", last.ResidentBytes);
+    record.Add("peak_resident_bytes", BenchmarkPeakResidentBytes(result));
+    record.Add("allocated_bytes", last.AllocatedBytes);
+    record.Add("allocation_calls", last.AllocationCalls);
+    record.Add("peak_heap_bytes", peakHeap);
+    record.Add("setup_resident_delta", result.SetupMemory.ResidentDelta);
+    record.Add("setup_allocated_bytes", result.SetupMemory.AllocatedBytes);
+    record.Add("setup_allocation_calls", result.SetupMemory.AllocationCalls);
+    record.Add("teardown_resident_delta", result.TeardownMemory.ResidentDelta);
+    record.Add("teardown_allocated_bytes", result.TeardownMemory.AllocatedBytes);
+  }
+
+  // Hardware counters of a trial or a thread, leaving out the events that
+  // couldn't be counted. The per triangle ratios are only added when the
+  // number of triangles is known.
+  static void AddCounters(Record& record, const CounterValues& values,
+                          long long numTriangles)
+  {
+    for(int c=0; c < NUM_COUNTERS; ++c)
+      {
+      if(values.Valid[c])
+        {
+        record.Add(CounterName(c), values.Counts[c]);
+        }
+      }
+    if(values.Valid[COUNTER_INSTRUCTIONS] && values.Valid[COUNTER_CYCLES])
+      {
+      record.Add("ipc", values.IPC());
+      }
+    if(numTriangles > 0 && values.Valid[COUNTER_LLC_MISSES])
+      {
+      record.Add("llc_misses_per_triangle", values.PerTriangle(COUNTER_LLC_MISSES, numTriangles));
+      }
+    if(numTriangles > 0 && values.Valid[COUNTER_BRANCH_MISSES])
+      {
+      record.Add("branch_misses_per_triangle", values.PerTriangle(COUNTER_BRANCH_MISSES, numTriangles));
+      }
+  }
+
+  void AddRunInfo(Record& record) const
+  {
+    record.Add("load_time", this->Info.LoadTime);
+    record.Add("load_resident_delta", this->Info.LoadMemory.ResidentDelta);
+    record.Add("load_peak_resident_bytes", this->Info.LoadMemory.PeakResidentBytes);
+    record.Add("load_allocated_bytes", this->Info.LoadMemory.AllocatedBytes);
+    record.Add("file", this->Info.File);
+    record.Add("host", this->Info.Host);
+    record.Add("git_hash", this->Info.GitHash);
+    record.Add("start_time", this->Info.StartTime);
+  }
+
+  static std::string HeaderLine()
+  {
+    const std::vector<std::string>& columns = Columns();
+    std::string header;
+    for(std::size_t i=0; i < columns.size(); ++i)
+      {
+      header += (i > 0 ? "," : "") + columns[i];
+      }
+    return header;
+  }
+
+  //false when the file doesn't exist or is empty
+  static bool ReadFirstLine(const std::string& path, std::string& line)
+  {
+    std::ifstream file(path.c_str());
+    if(!std::getline(file, line))
+      {
+      return false;
+      }
+    if(!line.empty() && line[line.size() - 1] == '\r')
+      {
+      line.erase(line.size() - 1);
+      }
+    return true;
+  }
+
+  void WriteJSON(const Record& record)
+  {
+    const std::vector<Record::Field>& fields = record.GetFields();
+    this->Stream << "{";
+    for(std::size_t i=0; i < fields.size(); ++i)
+      {
+      this->Stream << (i > 0 ? "," : "") << "\"" << EscapeJSON(fields[i].Key) << "\":";
+      if(fields[i].IsString)
+        {
+        this->Stream << "\"" << EscapeJSON(fields[i].Value) << "\"";
+        }
+      else if(fields[i].Value.empty())
+        {
+        this->Stream << "null";
+        }
+      else
+        {
+        this->Stream << fields[i].Value;
+        }
+      }
+    this->Stream << "}\n";
+  }
+
+  void WriteCSV(const Record& record)
+  {
+    const std::vector<std::string>& columns = Columns();
+    for(std::size_t i=0; i < columns.size(); ++i)
+      {
+      const Record::Field* field = record.Find(columns[i]);
+      this->Stream << (i > 0 ? "," : "") << (field ? EscapeCSV(field->Value) : "");
+      }
+    this->Stream << "\n";
+  }
+
+  static std::string EscapeJSON(const std::string& str)
+  {
+    std::string escaped;
+    for(std::size_t i=0; i < str.size(); ++i)
+      {
+      const unsigned char c = static_cast<unsigned char>(str[i]);
+      if(c == '"' || c == '\\')
+        {
+        escaped += '\\';
+        escaped += static_cast<char>(c);
+        }
+      else if(c < 0x20)
+        {
+        char code[8];
+        std::sprintf(code, "\\u%04x", c);
+        escaped += code;
+        }
+      else
+        {
+        escaped += static_cast<char>(c);
+        }
+      }
+    return escaped;
+  }
+
+  static std::string EscapeCSV(const std::string& str)
+  {
+    if(str.find_first_of(",\"\n") == std::string::npos)
+      {
+      return str;
+      }
+
+    std::string escaped = "\"";
+    for(std::size_t i=0; i < str.size(); ++i)
+      {
+      escaped += str[i];
+      if(str[i] == '"')
+        {
+        escaped += '"';
+        }
+      }
+    return escaped + "\"";
+  }
+
+  RunInfo Info;
+  FormatType Format;
+  std::ofstream Stream;
+};
+
+}
+
+#endif
@@ -0,0 +1,661 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __rooflineIsosurfaceUniformGrid_h
+#define __rooflineIsosurfaceUniformGrid_h
+
+#include <vtkm/Types.h>
+#include <vtkm/worklet/MarchingCubesDataTables.h>
+
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+#include <tbb/blocked_range2d.h>
+#include <tbb/parallel_for.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BENCH_ROOFLINE_X86 1
+#include <immintrin.h>
+#else
+#define BENCH_ROOFLINE_X86 0
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "MarchingCubesHelpers.h"
+#include "PhaseTrace.h"
+#include "ScalarTypes.h"
+
+namespace bench
+{
+
+namespace roofline
+{
+
+//the instructions points are classified with
+enum ClassifyPath
+{
+  CLASSIFY_SCALAR,
+  CLASSIFY_AVX2,
+  CLASSIFY_AVX512
+};
+
+static const char* ClassifyPathName(ClassifyPath path)
+{
+  switch(path)
+    {
+    case CLASSIFY_AVX2: return "avx2";
+    case CLASSIFY_AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+// The widest classification the CPU running the benchmark has. The vector
+// paths are compiled for their instruction set whatever the flags of the
+// build, so the same binary runs everywhere.
+static ClassifyPath DetectClassifyPath()
+{
+#if BENCH_ROOFLINE_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f"))
+    {
+    return CLASSIFY_AVX512;
+    }
+  if(__builtin_cpu_supports("avx2"))
+    {
+    return CLASSIFY_AVX2;
+    }
+#endif
+  return CLASSIFY_SCALAR;
+}
+
+// Sets bit i%8 of bits[i/8] when values[i] is above isovalue, for i from
+// begin, a multiple of 8, to count. The bits past count are cleared.
+template<typename FieldType, typename ComputeType>
+static void ClassifyPointsScalar(const FieldType* values,
+                                 vtkm::Id begin,
+                                 vtkm::Id count,
+                                 ComputeType isovalue,
+                                 vtkm::UInt8* bits)
+{
+  for(vtkm::Id i=begin; i < count; i += 8)
+    {
+    const vtkm::Id n = std::min<vtkm::Id>(8, count - i);
+    vtkm::UInt8 byte = 0;
+    for(vtkm::Id b=0; b < n; ++b)
+      {
+      byte |= (static_cast<ComputeType>(values[i + b]) > isovalue) ? (1 << b) : 0;
+      }
+    bits[i / 8] = byte;
+    }
+}
+
+#if BENCH_ROOFLINE_X86
+// The vector versions of ClassifyPointsScalar, they classify the whole
+// groups of 8 or 16 values and return how many values that was. Narrow
+// integers are widened to float first, like ComputeType does.
+__attribute__((target("avx2")))
+static vtkm::Id ClassifyPointsAVX2(const vtkm::Float32* values, vtkm::Id count,
+                                   vtkm::Float32 isovalue, vtkm::UInt8* bits)
+{
+  const __m256 iso = _mm256_set1_ps(isovalue);
+  vtkm::Id i = 0;
+  for(; i + 8 <= count; i += 8)
+    {
+    const __m256 above = _mm256_cmp_ps(_mm256_loadu_ps(values + i), iso, _CMP_GT_OQ);
+    bits[i / 8] = static_cast<vtkm::UInt8>(_mm256_movemask_ps(above));
+    }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static vtkm::Id ClassifyPointsAVX2(const vtkm::Float64* values, vtkm::Id count,
+                                   vtkm::Float64 isovalue, vtkm::UInt8* bits)
+{
+  const __m256d iso = _mm256_set1_pd(isovalue);
+  vtkm::Id i = 0;
+  for(; i + 8 <= count; i += 8)
+    {
+    const __m256d low = _mm256_cmp_pd(_mm256_loadu_pd(values + i), iso, _CMP_GT_OQ);
+    const __m256d high = _mm256_cmp_pd(_mm256_loadu_pd(values + i + 4), iso, _CMP_GT_OQ);
+    bits[i / 8] = static_cast<vtkm::UInt8>(_mm256_movemask_pd(low) |
+                                           (_mm256_movemask_pd(high) << 4));
+    }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static vtkm::Id ClassifyPointsAVX2(const vtkm::UInt8* values, vtkm::Id count,
+                                   vtkm::Float32 isovalue, vtkm::UInt8* bits)
+{
+  const __m256 iso = _mm256_set1_ps(isovalue);
+  vtkm::Id i = 0;
+  for(; i + 8 <= count; i += 8)
+    {
+    const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(values + i));
+    const __m256 widened = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(packed));
+    bits[i / 8] = static_cast<vtkm::UInt8>(
+      _mm256_movemask_ps(_mm256_cmp_ps(widened, iso, _CMP_GT_OQ)));
+    }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static vtkm::Id ClassifyPointsAVX2(const vtkm::UInt16* values, vtkm::Id count,
+                                   vtkm::Float32 isovalue, vtkm::UInt8* bits)
+{
+  const __m256 iso = _mm256_set1_ps(isovalue);
+  vtkm::Id i = 0;
+  for(; i + 8 <= count; i += 8)
+    {
+    const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    const __m256 widened = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(packed));
+    bits[i / 8] = static_cast<vtkm::UInt8>(
+      _mm256_movemask_ps(_mm256_cmp_ps(widened, iso, _CMP_GT_OQ)));
+    }
+  return i;
+}
+
+//16 floats per compare, the other types use the AVX2 version
+__attribute__((target("avx512f")))
+static vtkm::Id ClassifyPointsAVX512(const vtkm::Float32* values, vtkm::Id count,
+                                     vtkm::Float32 isovalue, vtkm::UInt8* bits)
+{
+  const __m512 iso = _mm512_set1_ps(isovalue);
+  vtkm::Id i = 0;
+  for(; i + 16 <= count; i += 16)
+    {
+    const __mmask16 above = _mm512_cmp_ps_mask(_mm512_loadu_ps(values + i), iso, _CMP_GT_OQ);
+    bits[i / 8] = static_cast<vtkm::UInt8>(above & 0xff);
+    bits[i / 8 + 1] = static_cast<vtkm::UInt8>(above >> 8);
+    }
+  return i;
+}
+
+template<typename FieldType, typename ComputeType>
+static vtkm::Id ClassifyPointsAVX512(const FieldType* values, vtkm::Id count,
+                                     ComputeType isovalue, vtkm::UInt8* bits)
+{
+  return ClassifyPointsAVX2(values, count, isovalue, bits);
+}
+#endif
+
+//ClassifyPointsScalar with the vector instructions of path
+template<typename FieldType, typename ComputeType>
+static void ClassifyPoints(ClassifyPath path,
+                           const FieldType* values,
+                           vtkm::Id count,
+                           ComputeType isovalue,
+                           vtkm::UInt8* bits)
+{
+  vtkm::Id done = 0;
+#if BENCH_ROOFLINE_X86
+  if(path == CLASSIFY_AVX512)
+    {
+    done = ClassifyPointsAVX512(values, count, isovalue, bits);
+    }
+  else if(path == CLASSIFY_AVX2)
+    {
+    done = ClassifyPointsAVX2(values, count, isovalue, bits);
+    }
+#else
+  (void)path;
+#endif
+  ClassifyPointsScalar(values, done, count, isovalue, bits);
+}
+
+//cells [ZBegin, ZEnd) x [YBegin, YEnd) of rows of cells along x
+struct SlabRange
+{
+  vtkm::Id ZBegin;
+  vtkm::Id ZEnd;
+  vtkm::Id YBegin;
+  vtkm::Id YEnd;
+};
+
+//a field pointer with the Get of a portal, for mc::PointGradient
+template<typename FieldType>
+struct FieldPointer
+{
+  FieldType Get(vtkm::Id index) const
+    { return this->Values[index]; }
+
+  const FieldType* Values;
+};
+
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+template<typename Body>
+struct TBBSlabBody
+{
+  explicit TBBSlabBody(const Body& body):
+    Wrapped(body)
+    {
+    }
+
+  void operator()(const tbb::blocked_range2d<vtkm::Id>& range) const
+  {
+    SlabRange slab;
+    slab.ZBegin = range.rows().begin();
+    slab.ZEnd = range.rows().end();
+    slab.YBegin = range.cols().begin();
+    slab.YEnd = range.cols().end();
+    this->Wrapped(slab);
+  }
+
+  const Body& Wrapped;
+};
+#endif
+}
+
+// A marching cubes that is as close as we can get to what the CPU allows,
+// the reference point of how far the VTK-m isosurface is from the peak.
+// It has the output of the VTK-m one, a triangle soup with a normal per
+// vertex in index space, but is specialized at compile time over the
+// scalar type and whether normals are generated, reads the field through
+// a plain pointer and uses the VTK-m marching cubes tables as constants.
+//
+// Two passes go over rows of cells along x, in z/y slabs that TBB hands to
+// its threads. A row keeps the bits of its 4 rows of points, classified 8
+// or 16 points per instruction with AVX2 or AVX-512 when the CPU has them,
+// and gets the cases of its cells 8 at a time from them, skipping the
+// blocks that are all inside or all outside. The first pass counts the
+// vertices of every row, an exclusive scan over the rows gives each one
+// where its vertices go, and the second pass writes them, classifying
+// only the rows that have some.
+//
+// The output vectors only ever grow, so after the first trial no memory
+// is allocated.
+template<typename FieldType, bool GenerateNormals>
+class RooflineIsosurfaceUniformGrid
+{
+public:
+  typedef typename ScalarTraits<FieldType>::ComputeType ComputeType;
+  typedef vtkm::Vec<vtkm::Float32,3> PointType;
+
+  RooflineIsosurfaceUniformGrid(const FieldType* field, const vtkm::Id3& pointDims):
+    Field(field),
+    PointDims(pointDims),
+    Path(roofline::DetectClassifyPath())
+    {
+    }
+
+  roofline::ClassifyPath GetClassifyPath() const
+    { return this->Path; }
+
+  // Contour the field at isovalue, vertices and normals get 3 entries per
+  // triangle, normals none without GenerateNormals. Returns the number of
+  // vertices, the vectors may be larger.
+  vtkm::Id Run(ComputeType isovalue,
+               std::vector<PointType>& vertices,
+               std::vector<PointType>& normals)
+  {
+    const vtkm::Id numRows = (this->PointDims[1] - 1) * (this->PointDims[2] - 1);
+    this->RowOffsets.resize(static_cast<std::size_t>(numRows) + 1);
+    if(numRows <= 0)
+      {
+      return 0;
+      }
+
+    //1. vertices of every row
+    {
+    ScopedPhase phase("count");
+    this->ForEachSlab(CountRows(*this, isovalue));
+    }
+
+    //2. where the vertices of each row start
+    vtkm::Id numVertices = 0;
+    {
+    ScopedPhase phase("scan");
+    for(std::size_t row=0; row < static_cast<std::size_t>(numRows); ++row)
+      {
+      const vtkm::Id count = this->RowOffsets[row];
+      this->RowOffsets[row] = numVertices;
+      numVertices += count;
+      }
+    this->RowOffsets[static_cast<std::size_t>(numRows)] = numVertices;
+    }
+
+    if(static_cast<vtkm::Id>(vertices.size()) < numVertices)
+      {
+      vertices.resize(static_cast<std::size_t>(numVertices));
+      }
+    if(GenerateNormals && static_cast<vtkm::Id>(normals.size()) < numVertices)
+      {
+      normals.resize(static_cast<std::size_t>(numVertices));
+      }
+    if(numVertices == 0)
+      {
+      return 0;
+      }
+
+    //3. the vertices
+    {
+    ScopedPhase phase("generate");
+    this->ForEachSlab(GenerateRows(*this, isovalue, &vertices[0],
+                                   GenerateNormals ? &normals[0] : NULL));
+    }
+    return numVertices;
+  }
+
+private:
+  // The bits of the 4 rows of points around a row of cells, kept while a
+  // slab is walked along y so each row of points is classified once per
+  // slab of z. Below and Above are the rows at k and k+1, [0] at j and [1]
+  // at j+1.
+  class RowBits
+  {
+  public:
+    RowBits(const RooflineIsosurfaceUniformGrid& filter, ComputeType isovalue):
+      Filter(filter),
+      IsoValue(isovalue),
+      //one more byte, so the last block of cells can read two of them
+      NumBytes(static_cast<std::size_t>((filter.PointDims[0] + 7) / 8 + 1)),
+      Row(-1),
+      Slice(-1)
+      {
+      for(int i=0; i < 2; ++i)
+        {
+        this->Below[i].assign(this->NumBytes, 0);
+        this->Above[i].assign(this->NumBytes, 0);
+        }
+      }
+
+    //classify the points around the row of cells j, k
+    void Load(vtkm::Id j, vtkm::Id k)
+    {
+      if(k == this->Slice && j == this->Row + 1)
+        {
+        std::swap(this->Below[0], this->Below[1]);
+        std::swap(this->Above[0], this->Above[1]);
+        }
+      else
+        {
+        this->Classify(j, k, this->Below[0]);
+        this->Classify(j, k + 1, this->Above[0]);
+        }
+      this->Classify(j + 1, k, this->Below[1]);
+      this->Classify(j + 1, k + 1, this->Above[1]);
+      this->Row = j;
+      this->Slice = k;
+    }
+
+    // Marching cubes cases of the loaded row of cells. Returns the number
+    // of vertices they generate.
+    vtkm::Id Cases(vtkm::UInt8* cases) const
+    {
+      const vtkm::Id numCells = this->Filter.PointDims[0] - 1;
+      const vtkm::UInt8* b0 = &this->Below[0][0];
+      const vtkm::UInt8* b1 = &this->Below[1][0];
+      const vtkm::UInt8* a0 = &this->Above[0][0];
+      const vtkm::UInt8* a1 = &this->Above[1][0];
+
+      vtkm::Id numVertices = 0;
+      for(vtkm::Id x=0; x < numCells; x += 8)
+        {
+        //the 9 points of the 8 cells of the block along each row
+        const std::size_t byte = static_cast<std::size_t>(x / 8);
+        const unsigned int w0 = b0[byte] | (b0[byte + 1] << 8);
+        const unsigned int w1 = b1[byte] | (b1[byte + 1] << 8);
+        const unsigned int w2 = a0[byte] | (a0[byte + 1] << 8);
+        const unsigned int w3 = a1[byte] | (a1[byte + 1] << 8);
+
+        const int n = static_cast<int>(std::min<vtkm::Id>(8, numCells - x));
+        const unsigned int points = (2u << n) - 1;
+        const unsigned int any = (w0 | w1 | w2 | w3) & points;
+        const unsigned int all = (w0 & w1 & w2 & w3) & points;
+        if(any == 0 || all == points)
+          {
+          std::memset(cases + x, any ? 255 : 0, static_cast<std::size_t>(n));
+          continue;
+          }
+
+        for(int c=0; c < n; ++c)
+          {
+          const unsigned int p0 = w0 >> c;
+          const unsigned int p1 = w1 >> c;
+          const unsigned int p2 = w2 >> c;
+          const unsigned int p3 = w3 >> c;
+          //vertices 0 1 2 3 are i,j i+1,j i+1,j+1 i,j+1 at k, 4 to 7 at k+1
+          const vtkm::UInt8 caseNumber = static_cast<vtkm::UInt8>(
+            (p0 & 3) | ((p1 & 2) << 1) | ((p1 & 1) << 3) |
+            ((p2 & 3) << 4) | ((p3 & 2) << 5) | ((p3 & 1) << 7));
+          cases[x + c] = caseNumber;
+          numVertices += vtkm::worklet::internal::numVerticesTable[caseNumber];
+          }
+        }
+      return numVertices;
+    }
+
+  private:
+    void Classify(vtkm::Id j, vtkm::Id k, std::vector<vtkm::UInt8>& bits) const
+    {
+      const vtkm::Id3& dims = this->Filter.PointDims;
+      roofline::ClassifyPoints(this->Filter.Path,
+                               this->Filter.Field + (k * dims[1] + j) * dims[0],
+                               dims[0], this->IsoValue, &bits[0]);
+    }
+
+    const RooflineIsosurfaceUniformGrid& Filter;
+    ComputeType IsoValue;
+    std::size_t NumBytes;
+    std::vector<vtkm::UInt8> Below[2];
+    std::vector<vtkm::UInt8> Above[2];
+    vtkm::Id Row;
+    vtkm::Id Slice;
+  };
+
+  //the number of vertices of every row of a slab, into RowOffsets
+  class CountRows
+  {
+  public:
+    CountRows(RooflineIsosurfaceUniformGrid& filter, ComputeType isovalue):
+      Filter(filter),
+      IsoValue(isovalue)
+      {
+      }
+
+    void operator()(const roofline::SlabRange& slab) const
+    {
+      const vtkm::Id numRowsY = this->Filter.PointDims[1] - 1;
+      RowBits bits(this->Filter, this->IsoValue);
+      std::vector<vtkm::UInt8> cases(static_cast<std::size_t>(this->Filter.PointDims[0]));
+      for(vtkm::Id k=slab.ZBegin; k < slab.ZEnd; ++k)
+        {
+        for(vtkm::Id j=slab.YBegin; j < slab.YEnd; ++j)
+          {
+          BENCHMARK_TRACE_WORK_ITEM();
+          bits.Load(j, k);
+          this->Filter.RowOffsets[static_cast<std::size_t>(k * numRowsY + j)] =
+            bits.Cases(&cases[0]);
+          }
+        }
+    }
+
+  private:
+    RooflineIsosurfaceUniformGrid& Filter;
+    ComputeType IsoValue;
+  };
+
+  //the vertices of the rows of a slab that have some
+  class GenerateRows
+  {
+  public:
+    GenerateRows(const RooflineIsosurfaceUniformGrid& filter,
+                 ComputeType isovalue,
+                 PointType* vertices,
+                 PointType* normals):
+      Filter(filter),
+      IsoValue(isovalue),
+      Vertices(vertices),
+      Normals(normals)
+      {
+      }
+
+    void operator()(const roofline::SlabRange& slab) const
+    {
+      const vtkm::Id numRowsY = this->Filter.PointDims[1] - 1;
+      RowBits bits(this->Filter, this->IsoValue);
+      std::vector<vtkm::UInt8> cases(static_cast<std::size_t>(this->Filter.PointDims[0]));
+      for(vtkm::Id k=slab.ZBegin; k < slab.ZEnd; ++k)
+        {
+        for(vtkm::Id j=slab.YBegin; j < slab.YEnd; ++j)
+          {
+          BENCHMARK_TRACE_WORK_ITEM();
+          const std::size_t row = static_cast<std::size_t>(k * numRowsY + j);
+          vtkm::Id offset = this->Filter.RowOffsets[row];
+          if(this->Filter.RowOffsets[row + 1] == offset)
+            {
+            continue;
+            }
+
+          bits.Load(j, k);
+          bits.Cases(&cases[0]);
+          for(vtkm::Id i=0; i < this->Filter.PointDims[0] - 1; ++i)
+            {
+            const vtkm::UInt8 caseNumber = cases[static_cast<std::size_t>(i)];
+            if(caseNumber != 0 && caseNumber != 255)
+              {
+              offset += this->Cell(i, j, k, caseNumber, offset);
+              }
+            }
+          }
+        }
+    }
+
+  private:
+    //writes the vertices of cell i, j, k from offset on, returns how many
+    vtkm::Id Cell(vtkm::Id i, vtkm::Id j, vtkm::Id k,
+                  vtkm::UInt8 caseNumber, vtkm::Id offset) const
+    {
+      const vtkm::Id3& dims = this->Filter.PointDims;
+      const vtkm::Id cellIjk[3] = { i, j, k };
+      const vtkm::Id ySlice = dims[0];
+      const vtkm::Id zSlice = dims[0] * dims[1];
+      const vtkm::Id base = i + ySlice * j + zSlice * k;
+      const vtkm::Id pointIds[8] = { base, base + 1, base + 1 + ySlice, base + ySlice,
+                                     base + zSlice, base + 1 + zSlice,
+                                     base + 1 + ySlice + zSlice, base + ySlice + zSlice };
+      ComputeType values[8];
+      for(int v=0; v < 8; ++v)
+        {
+        values[v] = static_cast<ComputeType>(this->Filter.Field[pointIds[v]]);
+        }
+
+      //gradients of the vertices of the crossed edges, computed once
+      vtkm::Vec<ComputeType,3> gradients[8];
+      unsigned int haveGradient = 0;
+      roofline::FieldPointer<FieldType> field;
+      field.Values = this->Filter.Field;
+
+      const vtkm::IdComponent numVertices =
+        vtkm::worklet::internal::numVerticesTable[caseNumber];
+      for(vtkm::IdComponent v=0; v < numVertices; ++v)
+        {
+        const vtkm::IdComponent edge = vtkm::worklet::internal::triTable[caseNumber*16 + v];
+        vtkm::IdComponent v0, v1;
+        mc::EdgeVertices(edge, v0, v1);
+        vtkm::Id offset0[3], offset1[3];
+        mc::VertexOffset(v0, offset0);
+        mc::VertexOffset(v1, offset1);
+
+        const ComputeType f0 = values[v0];
+        const ComputeType f1 = values[v1];
+        const ComputeType t = (f1 != f0) ? (this->IsoValue - f0) / (f1 - f0) : ComputeType(0.5);
+
+        vtkm::Vec<ComputeType,3> vertex;
+        for(int c=0; c < 3; ++c)
+          {
+          const ComputeType p0 = static_cast<ComputeType>(cellIjk[c] + offset0[c]);
+          const ComputeType p1 = static_cast<ComputeType>(cellIjk[c] + offset1[c]);
+          vertex[c] = p0 + t * (p1 - p0);
+          }
+        this->Vertices[offset + v] = mc::ToPoint(vertex);
+
+        if(GenerateNormals)
+          {
+          const vtkm::IdComponent ends[2] = { v0, v1 };
+          const vtkm::Id* endOffsets[2] = { offset0, offset1 };
+          for(int e=0; e < 2; ++e)
+            {
+            if(!(haveGradient & (1u << ends[e])))
+              {
+              const vtkm::Id ijk[3] = { i + endOffsets[e][0],
+                                        j + endOffsets[e][1],
+                                        k + endOffsets[e][2] };
+              gradients[ends[e]] = mc::PointGradient<ComputeType>(field, dims, ijk,
+                                                                  pointIds[ends[e]]);
+              haveGradient |= 1u << ends[e];
+              }
+            }
+
+          vtkm::Vec<ComputeType,3> normal;
+          ComputeType length = 0;
+          for(int c=0; c < 3; ++c)
+            {
+            normal[c] = gradients[v0][c] + t * (gradients[v1][c] - gradients[v0][c]);
+            length += normal[c] * normal[c];
+            }
+          length = std::sqrt(length);
+          if(length > 0)
+            {
+            for(int c=0; c < 3; ++c)
+              {
+              normal[c] /= length;
+              }
+            }
+          this->Normals[offset + v] = mc::ToPoint(normal);
+          }
+        }
+      return numVertices;
+    }
+
+    const RooflineIsosurfaceUniformGrid& Filter;
+    ComputeType IsoValue;
+    PointType* Vertices;
+    PointType* Normals;
+  };
+
+  //run body over all the rows of cells, in parallel with TBB
+  template<typename Body>
+  void ForEachSlab(const Body& body) const
+  {
+    const vtkm::Id numSlices = this->PointDims[2] - 1;
+    const vtkm::Id numRowsY = this->PointDims[1] - 1;
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+    //a task gets a slice of z and at least 16 rows of y of it
+    tbb::parallel_for(tbb::blocked_range2d<vtkm::Id>(0, numSlices, 1, 0, numRowsY, 16),
+                      roofline::TBBSlabBody<Body>(body));
+#else
+    roofline::SlabRange slab;
+    slab.ZBegin = 0;
+    slab.ZEnd = numSlices;
+    slab.YBegin = 0;
+    slab.YEnd = numRowsY;
+    body(slab);
+#endif
+  }
+
+  const FieldType* Field;
+  vtkm::Id3 PointDims;
+  roofline::ClassifyPath Path;
+  //vertex counts of every row of cells, then where each one starts
+  std::vector<vtkm::Id> RowOffsets;
+};
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __scalarTypes_h
+#define __scalarTypes_h
+
+#include <vtkm/Types.h>
+
+#include <string>
+
+namespace bench
+{
+
+// Scalar types a volume can be contoured in without converting it first.
+// 8 and 16 bit unsigned integers are how CT scanners write their volumes.
+enum ScalarType
+{
+  SCALAR_UINT8,
+  SCALAR_UINT16,
+  SCALAR_FLOAT32,
+  SCALAR_FLOAT64,
+  SCALAR_UNSUPPORTED
+};
+
+// Per scalar type facts. ComputeType is what isovalues, interpolation
+// weights and gradients are computed in: the narrow integer types are
+// read as they are stored and converted one value at a time, never as a
+// whole array.
+template<typename T> struct ScalarTraits;
+
+template<> struct ScalarTraits<vtkm::UInt8>
+{
+  typedef vtkm::Float32 ComputeType;
+  static ScalarType Type() { return SCALAR_UINT8; }
+  static const char* Name() { return "uint8"; }
+};
+
+template<> struct ScalarTraits<vtkm::UInt16>
+{
+  typedef vtkm::Float32 ComputeType;
+  static ScalarType Type() { return SCALAR_UINT16; }
+  static const char* Name() { return "uint16"; }
+};
+
+template<> struct ScalarTraits<vtkm::Float32>
+{
+  typedef vtkm::Float32 ComputeType;
+  static ScalarType Type() { return SCALAR_FLOAT32; }
+  static const char* Name() { return "float"; }
+};
+
+template<> struct ScalarTraits<vtkm::Float64>
+{
+  typedef vtkm::Float64 ComputeType;
+  static ScalarType Type() { return SCALAR_FLOAT64; }
+  static const char* Name() { return "double"; }
+};
+
+//the scalar type of a canonical NRRD type name, see nrrd::CanonicalType
+static ScalarType ScalarTypeFromNrrd(const std::string& type)
+{
+  if(type == "uint8") { return SCALAR_UINT8; }
+  if(type == "uint16") { return SCALAR_UINT16; }
+  if(type == "float") { return SCALAR_FLOAT32; }
+  if(type == "double") { return SCALAR_FLOAT64; }
+  return SCALAR_UNSUPPORTED;
+}
+
+static const char* ScalarTypeName(ScalarType type)
+{
+  switch(type)
+    {
+    case SCALAR_UINT8: return ScalarTraits<vtkm::UInt8>::Name();
+    case SCALAR_UINT16: return ScalarTraits<vtkm::UInt16>::Name();
+    case SCALAR_FLOAT32: return ScalarTraits<vtkm::Float32>::Name();
+    case SCALAR_FLOAT64: return ScalarTraits<vtkm::Float64>::Name();
+    default: return "unsupported";
+    }
+}
+
+static std::size_t ScalarTypeSize(ScalarType type)
+{
+  switch(type)
+    {
+    case SCALAR_UINT8: return sizeof(vtkm::UInt8);
+    case SCALAR_UINT16: return sizeof(vtkm::UInt16);
+    case SCALAR_FLOAT32: return sizeof(vtkm::Float32);
+    case SCALAR_FLOAT64: return sizeof(vtkm::Float64);
+    default: return 0;
+    }
+}
+
+// Call functor with a value of the C++ type of a runtime scalar type, the
+// way vtkm::cont::CastAndCall hands a functor the concrete array type.
+// functor has a templated operator()(T) that only uses the type of its
+// argument. Returns false for SCALAR_UNSUPPORTED.
+template<typename Functor>
+static bool CastAndCallScalarType(ScalarType type, Functor& functor)
+{
+  switch(type)
+    {
+    case SCALAR_UINT8: functor(vtkm::UInt8()); return true;
+    case SCALAR_UINT16: functor(vtkm::UInt16()); return true;
+    case SCALAR_FLOAT32: functor(vtkm::Float32()); return true;
+    case SCALAR_FLOAT64: functor(vtkm::Float64()); return true;
+    default: return false;
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __syntheticField_h
+#define __syntheticField_h
+
+#include <vtkm/Types.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleImplicit.h>
+#include <vtkm/cont/DeviceAdapterAlgorithm.h>
+
+#include <cmath>
+#include <string>
+
+#include "Volume.h"
+
+namespace bench
+{
+
+// Closed form scalar fields sampled on the points of a uniform grid that
+// spans [-1,1] along every axis. The value of a point is computed from its
+// index alone, so the same functor backs an ArrayHandleImplicit that is
+// evaluated on access and the parallel fill of a materialized volume.
+//  - tangle: the tangle cube of VTK-Iso/SerialIso.cxx
+//  - sphere: distance to the center, nested spheres for 0 to 1.7
+//  - gyroid: two periods of sin(x)cos(y) + sin(y)cos(z) + sin(z)cos(x),
+//    a surface that reaches every region of the volume for -1.5 to 1.5
+class SyntheticField
+{
+public:
+  enum FunctionType { TANGLE, SPHERE, GYROID };
+
+  VTKM_EXEC_CONT_EXPORT
+  SyntheticField():
+    Function(TANGLE),
+    Dims(0, 0, 0)
+    {
+    }
+
+  VTKM_EXEC_CONT_EXPORT
+  SyntheticField(FunctionType function, const vtkm::Id3& dims):
+    Function(function),
+    Dims(dims)
+    {
+    }
+
+  VTKM_EXEC_CONT_EXPORT
+  vtkm::Float32 operator()(vtkm::Id index) const
+  {
+    const vtkm::Id ijk[3] = { index % this->Dims[0],
+                              (index / this->Dims[0]) % this->Dims[1],
+                              index / (this->Dims[0] * this->Dims[1]) };
+    vtkm::Float32 p[3];
+    for(int i=0; i < 3; ++i)
+      {
+      p[i] = (this->Dims[i] > 1) ?
+        -1.0f + 2.0f * static_cast<vtkm::Float32>(ijk[i]) / static_cast<vtkm::Float32>(this->Dims[i] - 1) : 0.0f;
+      }
+
+    switch(this->Function)
+      {
+      case SPHERE:
+        return std::sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+      case GYROID:
+        {
+        const vtkm::Float32 scale = 2.0f * 3.14159265f;
+        const vtkm::Float32 x = scale * p[0], y = scale * p[1], z = scale * p[2];
+        return std::sin(x)*std::cos(y) + std::sin(y)*std::cos(z) + std::sin(z)*std::cos(x);
+        }
+      case TANGLE:
+      default:
+        {
+        const vtkm::Float32 x = 3.0f * p[0], y = 3.0f * p[1], z = 3.0f * p[2];
+        return (x*x*x*x - 5.0f*x*x + y*y*y*y - 5.0f*y*y + z*z*z*z - 5.0f*z*z + 11.8f) * 0.2f + 0.5f;
+        }
+      }
+  }
+
+  FunctionType GetFunction() const
+    { return this->Function; }
+
+  const vtkm::Id3& GetDimensions() const
+    { return this->Dims; }
+
+  vtkm::Id GetNumberOfValues() const
+    { return this->Dims[0] * this->Dims[1] * this->Dims[2]; }
+
+  //the function called name, returns false if there is none
+  static bool FromName(const std::string& name, FunctionType& function)
+  {
+    if(name == "tangle") { function = TANGLE; return true; }
+    if(name == "sphere") { function = SPHERE; return true; }
+    if(name == "gyroid") { function = GYROID; return true; }
+    return false;
+  }
+
+private:
+  FunctionType Function;
+  vtkm::Id3 Dims;
+};
+
+typedef vtkm::cont::ArrayHandleImplicit<vtkm::Float32, SyntheticField> SyntheticFieldHandle;
+
+//array that computes the values of field when they are read
+static SyntheticFieldHandle MakeSyntheticFieldHandle(const SyntheticField& field)
+{
+  return vtkm::cont::make_ArrayHandleImplicit<vtkm::Float32>(field, field.GetNumberOfValues());
+}
+
+// Fill volume with the values of field. The values are computed in
+// parallel on the device of the tag it is given by copying the implicit
+// array into a basic one, which the volume then shares.
+template<typename DeviceAdapter>
+static void FillSyntheticVolume(bench::Volume& volume, const SyntheticField& field,
+                                DeviceAdapter)
+{
+  vtkm::cont::ArrayHandle<vtkm::Float32> values;
+  vtkm::cont::DeviceAdapterAlgorithm<DeviceAdapter>::Copy(MakeSyntheticFieldHandle(field), values);
+
+  const vtkm::Id3& dims = field.GetDimensions();
+  const int intDims[3] = { static_cast<int>(dims[0]),
+                           static_cast<int>(dims[1]),
+                           static_cast<int>(dims[2]) };
+  double spacing[3];
+  const double origin[3] = { -1.0, -1.0, -1.0 };
+  for(int i=0; i < 3; ++i)
+    {
+    spacing[i] = (dims[i] > 1) ? 2.0 / static_cast<double>(dims[i] - 1) : 1.0;
+    }
+
+  volume.SetArrayHandle(values, intDims);
+  volume.SetSpacing(spacing);
+  volume.SetOrigin(origin);
+}
+
+}
+
+#endif
@@ -0,0 +1,230 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __thresholdUniformGrid_h
+#define __thresholdUniformGrid_h
+
+#include <vtkm/CellType.h>
+#include <vtkm/Types.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/cont/CellSetExplicit.h>
+#include <vtkm/cont/DeviceAdapterAlgorithm.h>
+#include <vtkm/cont/Timer.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/WorkletMapField.h>
+
+#include "MarchingCubesHelpers.h"
+#include "PhaseTrace.h"
+#include "ScalarTypes.h"
+
+namespace bench
+{
+
+//seconds each stage of a ThresholdUniformGrid run took
+struct ThresholdStageTimes
+{
+  ThresholdStageTimes():
+    Classify(0.0),
+    Compact(0.0),
+    Build(0.0)
+    {
+    }
+
+  double Classify;
+  double Compact;
+  double Build;
+};
+
+// Threshold of the cells of a uniform grid by a point field. A cell is
+// kept when the values at all of its 8 points are within [lower, upper],
+// which is what vtkThreshold does by default. The kept cells are written
+// as hexahedra of an explicit cell set over the point ids of the input
+// grid. The points are not compacted: the coordinates of a uniform grid
+// are implicit, so the output refers to all of them.
+//
+// The three stages are synchronized and timed on their own: classify marks
+// the cells to keep, compact gathers their ids and build writes the
+// connectivity of the explicit cell set.
+template<typename FieldType, typename DeviceAdapter>
+class ThresholdUniformGrid
+{
+public:
+  typedef typename ScalarTraits<FieldType>::ComputeType ComputeType;
+  typedef typename vtkm::cont::ArrayHandle<FieldType>::template ExecutionTypes<DeviceAdapter>::PortalConst FieldPortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::Id>::template ExecutionTypes<DeviceAdapter>::PortalConst IdPortalConstType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::Id>::template ExecutionTypes<DeviceAdapter>::Portal IdPortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::UInt8>::template ExecutionTypes<DeviceAdapter>::Portal ShapePortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::IdComponent>::template ExecutionTypes<DeviceAdapter>::Portal NumIndicesPortalType;
+
+  //1 for a cell whose 8 values are all within the range, 0 otherwise
+  class ClassifyCell : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> cellId, FieldOut<IdType> keep);
+    typedef _2 ExecutionSignature(_1);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    ClassifyCell(const FieldPortalType& field,
+                 ComputeType lower,
+                 ComputeType upper,
+                 const vtkm::Id3& pointDims):
+      Field(field),
+      Lower(lower),
+      Upper(upper),
+      PointDims(pointDims)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    vtkm::Id operator()(vtkm::Id cellId) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      vtkm::Id pointIds[8];
+      mc::CellPointIds(cellId, this->PointDims, pointIds);
+      for(vtkm::IdComponent i=0; i < 8; ++i)
+        {
+        const ComputeType value = static_cast<ComputeType>(this->Field.Get(pointIds[i]));
+        if(value < this->Lower || value > this->Upper)
+          {
+          return 0;
+          }
+        }
+      return 1;
+    }
+
+  private:
+    FieldPortalType Field;
+    ComputeType Lower;
+    ComputeType Upper;
+    vtkm::Id3 PointDims;
+  };
+
+  // Writes the shape, number of points and the 8 point ids of kept cell k.
+  // Uniform grid cells number their points like VTK hexahedra.
+  class BuildCell : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> keptIndex);
+    typedef void ExecutionSignature(_1);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    BuildCell(const IdPortalConstType& cellIds,
+              const ShapePortalType& shapes,
+              const NumIndicesPortalType& numIndices,
+              const IdPortalType& connectivity,
+              const vtkm::Id3& pointDims):
+      CellIds(cellIds),
+      Shapes(shapes),
+      NumIndices(numIndices),
+      Connectivity(connectivity),
+      PointDims(pointDims)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id keptIndex) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      vtkm::Id pointIds[8];
+      mc::CellPointIds(this->CellIds.Get(keptIndex), this->PointDims, pointIds);
+
+      this->Shapes.Set(keptIndex, static_cast<vtkm::UInt8>(vtkm::VTKM_HEXAHEDRON));
+      this->NumIndices.Set(keptIndex, 8);
+      for(vtkm::IdComponent i=0; i < 8; ++i)
+        {
+        this->Connectivity.Set(8 * keptIndex + i, pointIds[i]);
+        }
+    }
+
+  private:
+    IdPortalConstType CellIds;
+    ShapePortalType Shapes;
+    NumIndicesPortalType NumIndices;
+    IdPortalType Connectivity;
+    vtkm::Id3 PointDims;
+  };
+
+  explicit ThresholdUniformGrid(const vtkm::Id3& pointDims):
+    PointDims(pointDims)
+    {
+    }
+
+  // Keep the cells of field whose values are all in [lower, upper].
+  // cellIds gets the ids of the kept cells in the input grid, to map cell
+  // data with, and cellSet the kept cells. Returns the number of them.
+  vtkm::Id Run(ComputeType lower,
+               ComputeType upper,
+               const vtkm::cont::ArrayHandle<FieldType>& field,
+               vtkm::cont::ArrayHandle<vtkm::Id>& cellIds,
+               vtkm::cont::CellSetExplicit<>& cellSet,
+               ThresholdStageTimes& times)
+  {
+    typedef vtkm::cont::DeviceAdapterAlgorithm<DeviceAdapter> Algorithm;
+
+    const vtkm::Id numCells =
+      (this->PointDims[0]-1) * (this->PointDims[1]-1) * (this->PointDims[2]-1);
+
+    //1. mark the cells to keep
+    vtkm::cont::Timer<DeviceAdapter> timer;
+    vtkm::cont::ArrayHandle<vtkm::Id> keep;
+    {
+    ScopedDevicePhase<Algorithm> phase("classify");
+    ClassifyCell classify(field.PrepareForInput(DeviceAdapter()), lower, upper, this->PointDims);
+    vtkm::worklet::DispatcherMapField<ClassifyCell, DeviceAdapter> classifyDispatcher(classify);
+    classifyDispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numCells), keep);
+    }
+    times.Classify = timer.GetElapsedTime();
+
+    //2. gather their ids, the indices of the non zero entries of keep
+    timer.Reset();
+    {
+    ScopedDevicePhase<Algorithm> phase("compact");
+    Algorithm::StreamCompact(keep, cellIds);
+    keep.ReleaseResources();
+    }
+    times.Compact = timer.GetElapsedTime();
+
+    //3. write the explicit cells
+    timer.Reset();
+    const vtkm::Id numKept = cellIds.GetNumberOfValues();
+    {
+    ScopedDevicePhase<Algorithm> phase("build");
+    vtkm::cont::ArrayHandle<vtkm::UInt8> shapes;
+    vtkm::cont::ArrayHandle<vtkm::IdComponent> numIndices;
+    vtkm::cont::ArrayHandle<vtkm::Id> connectivity;
+    BuildCell build(cellIds.PrepareForInput(DeviceAdapter()),
+                    shapes.PrepareForOutput(numKept, DeviceAdapter()),
+                    numIndices.PrepareForOutput(numKept, DeviceAdapter()),
+                    connectivity.PrepareForOutput(8 * numKept, DeviceAdapter()),
+                    this->PointDims);
+    vtkm::worklet::DispatcherMapField<BuildCell, DeviceAdapter> buildDispatcher(build);
+    buildDispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numKept));
+
+    cellSet.GetNodeToCellConnectivity().Fill(shapes, numIndices, connectivity);
+    }
+    times.Build = timer.GetElapsedTime();
+    return numKept;
+  }
+
+private:
+  vtkm::Id3 PointDims;
+};
+
+}
+
+#endif
@@ -52,7 +52,7 @@ static const int ISO_NUM=10;
 
 Timer timer;
 
-void process(vtkMultiProcessController* controller, void* vtkNotUsed(arg))
+void process(vtkMultiProcessController* controller, void* arg)
 {
     int myId = controller->GetLocalProcessId();
 
@@ -60,7 +60,7 @@ void process(vtkMultiProcessController* controller, void* vtkNotUsed(arg))
 
 #ifdef SUPERNOVA
     vtkNew<vtkPNrrdReader> reader;
-    std::string file = "/home/csewell/CGABenchmarks/data/normal_1349.nhdr";
+    const std::string& file = *static_cast<std::string*>(arg);
     reader->SetFileName(file.c_str());
 
     reader->UpdateInformation();
@@ -216,8 +216,19 @@ int main(int argc, char* argv[])
     vtkNew<vtkMPIController> controller;
     controller->Initialize(&argc, &argv);
 
+#ifdef SUPERNOVA
+    if (argc < 2)
+    {
+        if (controller->GetLocalProcessId() == 0)
+            std::cerr << "usage: " << argv[0] << " file.nhdr" << std::endl;
+        controller->Finalize();
+        return 1;
+    }
+#endif
+    std::string file = (argc > 1) ? argv[1] : "";
+
     // Execute the function named "process" on all processes
-    controller->SetSingleMethod(process, 0);
+    controller->SetSingleMethod(process, &file);
     controller->SingleMethodExecute();
 
     // Clean-up and exit
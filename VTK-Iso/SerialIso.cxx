@@ -76,8 +76,13 @@ int main()
 {
   std::vector<double> samples;
 
+  // Iterate until the 95% confidence interval of the median is within
+  // TARGET_PRECISION percent of it, MAX_RUNTIME seconds were spent or
+  // MAX_ITERATIONS were run, whichever comes first
   const double MAX_RUNTIME = 30;
-  const size_t MAX_ITERATIONS = 1; 
+  const size_t MIN_ITERATIONS = 5;
+  const size_t MAX_ITERATIONS = 100;
+  const double TARGET_PRECISION = 2.0;
   samples.reserve(MAX_ITERATIONS);
   size_t iter = 0;
   Timer timer;
@@ -108,7 +113,17 @@ int main()
     
     iso->Delete();
     data->Delete();
+
+    if (samples.size() >= MIN_ITERATIONS){
+      std::vector<double> sorted(samples);
+      std::sort(sorted.begin(), sorted.end());
+      const stats::ConfidenceInterval interval = stats::BootstrapMedianInterval(samples);
+      if (stats::RelativeHalfWidth(interval, stats::PercentileValue(sorted, 50.0)) <= TARGET_PRECISION){
+        break;
+      }
+    }
   }
+  const stats::ConfidenceInterval interval = stats::BootstrapMedianInterval(samples);
     
   std::sort(samples.begin(), samples.end());
   stats::Winsorize(samples, 5.0);
@@ -119,7 +134,8 @@ int main()
       << "\tstd dev = " << stats::StandardDeviation(samples) << "s\n"
       << "\tmin = " << samples.front() << "s\n"
       << "\tmax = " << samples.back() << "s\n"
-      << "\t# of runs = " << samples.size() << "\n";
+      << "\t# of runs = " << samples.size() << "\n"
+      << "\tmedian 95% CI = [" << interval.low << "s, " << interval.high << "s]\n";
 
   return 0;
 }
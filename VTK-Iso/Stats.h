@@ -1,12 +1,17 @@
 
 #include <string>
 #include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include <vector>
 #ifdef _WIN32
 #include <sys/timeb.h>
 #include <sys/types.h>
 #else //!_WIN32
 #include <limits.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #endif
 
@@ -97,6 +102,129 @@ double MedianAbsDeviation(const std::vector<double> &samples){
   std::sort(abs_deviations.begin(), abs_deviations.end());
   return PercentileValue(abs_deviations, 50.0);
 }
+// Result of comparing two independent sets of samples with a Mann-Whitney
+// U test. `u` is the U statistic of the second set, the number of pairs
+// in which its sample is the larger one (ties count for half).
+struct MannWhitneyResult {
+  double u;
+  // z score of u under the normal approximation, with tie and continuity
+  // corrections, positive when the second set tends to be larger
+  double z;
+  // two sided p-value of the null hypothesis that neither set tends to
+  // be larger than the other
+  double p_value;
+  // Cliff's delta, P(second > first) - P(second < first), in [-1, 1].
+  // |delta| below 0.147 is usually read as negligible, 0.33 as small and
+  // 0.474 as medium
+  double effect_size;
+};
+// Mann-Whitney U test of the samples of `after` against those of
+// `before`. Neither needs to be sorted. The p-value uses the normal
+// approximation, which is adequate from about 8 samples per set.
+MannWhitneyResult MannWhitneyU(const std::vector<double> &before, const std::vector<double> &after){
+  MannWhitneyResult result = { 0.0, 0.0, 1.0, 0.0 };
+  const double n1 = static_cast<double>(before.size());
+  const double n2 = static_cast<double>(after.size());
+  if (before.empty() || after.empty()){
+    return result;
+  }
+  // Rank the pooled samples, giving tied samples the mean of their ranks
+  std::vector<std::pair<double, int> > pooled;
+  pooled.reserve(before.size() + after.size());
+  for (std::vector<double>::const_iterator it = before.begin(); it != before.end(); ++it){
+    pooled.push_back(std::make_pair(*it, 0));
+  }
+  for (std::vector<double>::const_iterator it = after.begin(); it != after.end(); ++it){
+    pooled.push_back(std::make_pair(*it, 1));
+  }
+  std::sort(pooled.begin(), pooled.end());
+  double after_rank_sum = 0;
+  double tie_term = 0;
+  for (size_t i = 0; i < pooled.size();){
+    size_t j = i;
+    while (j < pooled.size() && pooled[j].first == pooled[i].first){
+      ++j;
+    }
+    const double rank = (static_cast<double>(i + j) + 1.0) / 2.0;
+    for (size_t k = i; k < j; ++k){
+      if (pooled[k].second == 1){
+        after_rank_sum += rank;
+      }
+    }
+    const double ties = static_cast<double>(j - i);
+    tie_term += ties * ties * ties - ties;
+    i = j;
+  }
+  result.u = after_rank_sum - n2 * (n2 + 1.0) / 2.0;
+  result.effect_size = 2.0 * result.u / (n1 * n2) - 1.0;
+
+  const double n = n1 + n2;
+  const double mean_u = n1 * n2 / 2.0;
+  const double variance_u = n1 * n2 / 12.0 * ((n + 1.0) - tie_term / (n * (n - 1.0)));
+  if (variance_u <= 0){
+    // every sample is equal
+    return result;
+  }
+  const double deviation = result.u - mean_u;
+  const double corrected = std::max(0.0, std::abs(deviation) - 0.5);
+  result.z = (deviation < 0 ? -corrected : corrected) / std::sqrt(variance_u);
+  result.p_value = std::min(1.0, ::erfc(std::abs(result.z) / std::sqrt(2.0)));
+  return result;
+}
+// Interval estimate of a statistic
+struct ConfidenceInterval {
+  double low;
+  double high;
+};
+// Percentile bootstrap confidence interval of the median of the samples,
+// which don't need to be sorted. The samples are resampled with
+// replacement `resamples` times and the interval is the central
+// `confidence` percent of the medians of the resamples. A fixed seed
+// makes the interval reproducible for the same samples.
+ConfidenceInterval BootstrapMedianInterval(const std::vector<double> &samples,
+                                           const double confidence = 95.0,
+                                           const int resamples = 2000,
+                                           unsigned int seed = 2463534242u){
+  ConfidenceInterval interval = { 0.0, 0.0 };
+  if (samples.empty()){
+    return interval;
+  }
+  if (samples.size() == 1){
+    interval.low = interval.high = samples.front();
+    return interval;
+  }
+  std::vector<double> medians;
+  medians.reserve(resamples);
+  std::vector<double> resample(samples.size());
+  for (int r = 0; r < resamples; ++r){
+    for (size_t i = 0; i < resample.size(); ++i){
+      // xorshift32, good enough to pick indices and independent of rand()
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      resample[i] = samples[seed % samples.size()];
+    }
+    // same median as PercentileValue, without sorting the whole resample
+    const size_t half = (resample.size() - 1) / 2;
+    std::nth_element(resample.begin(), resample.begin() + half, resample.end());
+    double median = resample[half];
+    if (resample.size() % 2 == 0){
+      median = (median + *std::min_element(resample.begin() + half + 1, resample.end())) / 2.0;
+    }
+    medians.push_back(median);
+  }
+  std::sort(medians.begin(), medians.end());
+  interval.low = PercentileValue(medians, (100.0 - confidence) / 2.0);
+  interval.high = PercentileValue(medians, 100.0 - (100.0 - confidence) / 2.0);
+  return interval;
+}
+// Half the width of the interval as a percentage of `center`
+double RelativeHalfWidth(const ConfidenceInterval &interval, const double center){
+  if (center == 0){
+    return 0;
+  }
+  return (interval.high - interval.low) / 2.0 / std::abs(center) * 100.0;
+}
 } // stats
 
 // This is VTK-m's timer in DeviceAdapterAlgorithm
@@ -150,10 +278,11 @@ public:
     retval.Seconds = currentTime.time;
     retval.Microseconds = 1000*currentTime.millitm;
 #else
-    timeval currentTime;
-    gettimeofday(&currentTime, NULL);
+    //monotonic, unlike gettimeofday it doesn't jump when the clock is set
+    timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
     retval.Seconds = currentTime.tv_sec;
-    retval.Microseconds = currentTime.tv_usec;
+    retval.Microseconds = currentTime.tv_nsec / 1000;
 #endif
     return retval;
   }
@@ -0,0 +1,298 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __volume_h
+#define __volume_h
+
+#include <vtkm/Types.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayPortalToIterators.h>
+
+#include <vtkDataArray.h>
+#include <vtkType.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "NrrdReader.h"
+#include "NumaPlacement.h"
+#include "ScalarTypes.h"
+
+namespace bench
+{
+
+//VTK type constant of a scalar type, e.g. VTK_UNSIGNED_SHORT for uint16
+static int VTKScalarType(ScalarType type)
+{
+  switch(type)
+    {
+    case SCALAR_UINT8: return VTK_UNSIGNED_CHAR;
+    case SCALAR_UINT16: return VTK_UNSIGNED_SHORT;
+    case SCALAR_FLOAT32: return VTK_FLOAT;
+    case SCALAR_FLOAT64: return VTK_DOUBLE;
+    default: return VTK_VOID;
+    }
+}
+
+static ScalarType ScalarTypeFromVTK(int type)
+{
+  switch(type)
+    {
+    case VTK_UNSIGNED_CHAR: return SCALAR_UINT8;
+    case VTK_UNSIGNED_SHORT: return SCALAR_UINT16;
+    case VTK_FLOAT: return SCALAR_FLOAT32;
+    case VTK_DOUBLE: return SCALAR_FLOAT64;
+    default: return SCALAR_UNSUPPORTED;
+    }
+}
+
+// The scalar field every contender contours. The values either live in a
+// private memory map of the input file, in storage owned by the volume, in
+// an ArrayHandle produced by a worklet or in a buffer placed across the
+// NUMA nodes, and are shared without copies by the VTK-m ArrayHandle and
+// the vtkImageData handed to the contenders. The volume has to outlive
+// both.
+//
+// The values keep the scalar type they were read in, see ScalarTypes.h.
+// Contenders are templated over it and get at the values through
+// GetValues<T> and GetArrayHandle<T> once GetScalarType has told them T.
+class Volume
+{
+public:
+  Volume():
+    Type(SCALAR_FLOAT32),
+    Data(NULL),
+    NumberOfValues(0)
+    {
+    for(int i=0; i < 3; ++i)
+      {
+      this->Dimensions[i] = 0;
+      this->Spacing[i] = 1.0;
+      this->Origin[i] = 0.0;
+      }
+    }
+
+  //use the values of a mapped NRRD payload in place, header.Type has to
+  //be one of the scalar types of ScalarTypes.h
+  void SetMapped(const boost::shared_ptr<MappedFile>& mapping,
+                 const NrrdHeader& header)
+  {
+    this->Placed.reset();
+    this->Owned.clear();
+    this->Handle.reset();
+    this->Mapping = mapping;
+    this->Type = ScalarTypeFromNrrd(header.Type);
+    this->Data = mapping->GetData();
+    for(int i=0; i < 3; ++i)
+      {
+      this->Dimensions[i] = static_cast<int>(header.Sizes[i]);
+      this->Spacing[i] = header.Spacings[i];
+      this->Origin[i] = header.Origin[i];
+      }
+    this->NumberOfValues = header.NumberOfValues();
+  }
+
+  //allocate storage owned by the volume, returns where to write the values
+  void* Allocate(const int dims[3], ScalarType type)
+  {
+    this->Placed.reset();
+    this->Mapping.reset();
+    this->Handle.reset();
+    this->Type = type;
+    for(int i=0; i < 3; ++i)
+      {
+      this->Dimensions[i] = dims[i];
+      }
+    this->NumberOfValues = static_cast<vtkm::Id>(dims[0]) * dims[1] * dims[2];
+    this->Owned.resize(static_cast<std::size_t>(this->NumberOfValues) * ScalarTypeSize(type));
+    this->Data = this->Owned.empty() ? NULL : &this->Owned[0];
+    return this->Data;
+  }
+
+  //use the values held by an ArrayHandle, e.g. the output of a worklet
+  template<typename T>
+  void SetArrayHandle(const vtkm::cont::ArrayHandle<T>& values,
+                      const int dims[3])
+  {
+    this->Placed.reset();
+    this->Mapping.reset();
+    this->Owned.clear();
+    vtkm::cont::ArrayHandle<T>* handle = new vtkm::cont::ArrayHandle<T>(values);
+    this->Handle.reset(handle);
+    this->Type = ScalarTraits<T>::Type();
+    for(int i=0; i < 3; ++i)
+      {
+      this->Dimensions[i] = dims[i];
+      }
+    this->NumberOfValues = values.GetNumberOfValues();
+    this->Data = (this->NumberOfValues > 0) ?
+      &(*vtkm::cont::ArrayPortalToIteratorBegin(handle->GetPortalControl())) : NULL;
+  }
+
+  // Move the values into a buffer whose pages are first touched by the
+  // threads of the host device adapter, so that each page sits on the node
+  // of the thread that contours it instead of the one of the thread that
+  // read the file, optionally backed by huge pages. Whatever held the
+  // values before is released, image data made before refers to freed
+  // memory and has to be made again. Returns the buffer, NULL on failure.
+  boost::shared_ptr<PlacedBuffer> Place(HugePageMode mode, std::string& error)
+  {
+    boost::shared_ptr<PlacedBuffer> buffer(new PlacedBuffer);
+    const std::size_t length =
+      static_cast<std::size_t>(this->NumberOfValues) * ScalarTypeSize(this->Type);
+    if(!buffer->Allocate(length, mode, error))
+      {
+      return boost::shared_ptr<PlacedBuffer>();
+      }
+    switch(this->Type)
+      {
+      case SCALAR_UINT8: this->CopyTo<vtkm::UInt8>(buffer->GetData()); break;
+      case SCALAR_UINT16: this->CopyTo<vtkm::UInt16>(buffer->GetData()); break;
+      case SCALAR_FLOAT32: this->CopyTo<vtkm::Float32>(buffer->GetData()); break;
+      case SCALAR_FLOAT64: this->CopyTo<vtkm::Float64>(buffer->GetData()); break;
+      default: break;
+      }
+
+    this->Mapping.reset();
+    std::vector<char>().swap(this->Owned);
+    this->Handle.reset();
+    this->Placed = buffer;
+    this->Data = buffer->GetData();
+    return buffer;
+  }
+
+  void SetSpacing(const double spacing[3])
+    { std::copy(spacing, spacing + 3, this->Spacing); }
+  void SetOrigin(const double origin[3])
+    { std::copy(origin, origin + 3, this->Origin); }
+
+  ScalarType GetScalarType() const
+    { return this->Type; }
+
+  //the values in whatever scalar type they have
+  const void* GetData() const
+    { return this->Data; }
+
+  //the values, NULL unless T is the scalar type of the volume
+  template<typename T>
+  const T* GetValues() const
+  {
+    return (ScalarTraits<T>::Type() == this->Type) ?
+      static_cast<const T*>(this->Data) : NULL;
+  }
+
+  //the values converted to float, for code that only handles float such
+  //as PISTON. This is a full copy of the volume
+  void GetValuesAsFloat32(std::vector<vtkm::Float32>& values) const
+  {
+    values.resize(static_cast<std::size_t>(this->NumberOfValues));
+    switch(this->Type)
+      {
+      case SCALAR_UINT8: this->Widen(this->GetValues<vtkm::UInt8>(), values); break;
+      case SCALAR_UINT16: this->Widen(this->GetValues<vtkm::UInt16>(), values); break;
+      case SCALAR_FLOAT32: this->Widen(this->GetValues<vtkm::Float32>(), values); break;
+      case SCALAR_FLOAT64: this->Widen(this->GetValues<vtkm::Float64>(), values); break;
+      default: values.clear(); break;
+      }
+  }
+
+  vtkm::Id GetNumberOfValues() const
+    { return this->NumberOfValues; }
+
+  //size in bytes of the values
+  std::size_t GetNumberOfBytes() const
+    { return static_cast<std::size_t>(this->NumberOfValues) * ScalarTypeSize(this->Type); }
+
+  void GetDimensions(int dims[3]) const
+    { std::copy(this->Dimensions, this->Dimensions + 3, dims); }
+
+  const double* GetSpacing() const
+    { return this->Spacing; }
+
+  const double* GetOrigin() const
+    { return this->Origin; }
+
+  bool IsMapped() const
+    { return this->Mapping.get() != NULL; }
+
+  //ArrayHandle that refers to the values of the volume without copying
+  //them, T has to be the scalar type of the volume
+  template<typename T>
+  vtkm::cont::ArrayHandle<T> GetArrayHandle() const
+  {
+    return vtkm::cont::make_ArrayHandle(this->GetValues<T>(),
+                                        (this->GetValues<T>() != NULL) ? this->NumberOfValues : 0);
+  }
+
+  //vtkImageData whose point scalars refer to the values of the volume
+  vtkSmartPointer<vtkImageData> NewImageData() const
+  {
+    vtkSmartPointer<vtkDataArray> scalars;
+    scalars.TakeReference(vtkDataArray::CreateDataArray(VTKScalarType(this->Type)));
+    scalars->SetName("nodevar");
+    //save=1 so VTK never frees or reallocates memory it doesn't own
+    scalars->SetVoidArray(this->Data, this->NumberOfValues, 1);
+
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(this->Dimensions[0], this->Dimensions[1], this->Dimensions[2]);
+    image->SetSpacing(this->Spacing[0], this->Spacing[1], this->Spacing[2]);
+    image->SetOrigin(this->Origin[0], this->Origin[1], this->Origin[2]);
+    image->GetPointData()->SetScalars(scalars);
+    return image;
+  }
+
+private:
+  Volume(const Volume&);
+  void operator=(const Volume&);
+
+  template<typename T>
+  void CopyTo(void* placed) const
+  {
+    ParallelFirstTouchCopy(static_cast<const T*>(this->Data), static_cast<T*>(placed),
+                           this->NumberOfValues);
+  }
+
+  template<typename T>
+  static void Widen(const T* input, std::vector<vtkm::Float32>& values)
+  {
+    for(std::size_t i=0; i < values.size(); ++i)
+      {
+      values[i] = static_cast<vtkm::Float32>(input[i]);
+      }
+  }
+
+  boost::shared_ptr<MappedFile> Mapping;
+  boost::shared_ptr<PlacedBuffer> Placed;
+  std::vector<char> Owned;
+  //the ArrayHandle<T> the values came in, kept alive for as long as they
+  //are used
+  boost::shared_ptr<void> Handle;
+  ScalarType Type;
+  void* Data;
+  vtkm::Id NumberOfValues;
+  int Dimensions[3];
+  double Spacing[3];
+  double Origin[3];
+};
+
+}
+
+#endif
@@ -0,0 +1,292 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __weldedIsosurfaceUniformGrid_h
+#define __weldedIsosurfaceUniformGrid_h
+
+#include <vtkm/Types.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/cont/DeviceAdapterAlgorithm.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/MarchingCubesDataTables.h>
+#include <vtkm/worklet/WorkletMapField.h>
+
+#include "MarchingCubesHelpers.h"
+#include "PhaseTrace.h"
+#include "ScalarTypes.h"
+
+namespace bench
+{
+
+// Marching cubes on a uniform grid that produces a welded mesh: every
+// interpolated point on a grid edge is generated once and triangles refer
+// to points through an index buffer, instead of the 3 independent
+// vertices per triangle of IsosurfaceFilterUniformGrid.
+//
+// Each output vertex is first tagged with a global id of the grid edge it
+// lies on (the id of the lower edge point * 3 + the edge axis). Sorting
+// and removing duplicate edge ids gives the welded points, and a lower
+// bounds search of each vertex edge id in them gives the index buffer.
+//
+// As in BatchIsosurfaceUniformGrid the field is read in the FieldType it
+// is stored in and interpolated in ScalarTraits::ComputeType.
+template<typename FieldType, typename DeviceAdapter>
+class WeldedIsosurfaceUniformGrid
+{
+public:
+  typedef typename ScalarTraits<FieldType>::ComputeType ComputeType;
+  typedef vtkm::Vec<vtkm::Float32,3> PointType;
+  typedef typename vtkm::cont::ArrayHandle<FieldType>::template ExecutionTypes<DeviceAdapter>::PortalConst FieldPortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::IdComponent>::template ExecutionTypes<DeviceAdapter>::PortalConst TablePortalType;
+  typedef typename vtkm::cont::ArrayHandle<vtkm::Id>::template ExecutionTypes<DeviceAdapter>::Portal IdPortalType;
+
+  //marching cubes case of a cell
+  static VTKM_EXEC_EXPORT vtkm::IdComponent CaseNumber(const FieldPortalType& field,
+                                                       const vtkm::Id pointIds[8],
+                                                       ComputeType isovalue)
+  {
+    FieldType values[8];
+    for(vtkm::IdComponent i=0; i < 8; ++i)
+      {
+      values[i] = field.Get(pointIds[i]);
+      }
+    return mc::CaseNumber(values, isovalue);
+  }
+
+  class ClassifyCell : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> cellId, FieldOut<IdType> numVertices);
+    typedef _2 ExecutionSignature(_1);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    ClassifyCell(const FieldPortalType& field,
+                 const TablePortalType& numVerticesTable,
+                 const vtkm::Id3& pointDims,
+                 ComputeType isovalue):
+      Field(field),
+      NumVerticesTable(numVerticesTable),
+      PointDims(pointDims),
+      Isovalue(isovalue)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    vtkm::Id operator()(vtkm::Id cellId) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      vtkm::Id pointIds[8];
+      mc::CellPointIds(cellId, this->PointDims, pointIds);
+      const vtkm::IdComponent caseNumber = CaseNumber(this->Field, pointIds, this->Isovalue);
+      return static_cast<vtkm::Id>(this->NumVerticesTable.Get(caseNumber));
+    }
+
+  private:
+    FieldPortalType Field;
+    TablePortalType NumVerticesTable;
+    vtkm::Id3 PointDims;
+    ComputeType Isovalue;
+  };
+
+  class GenerateEdgeIds : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> cellId, FieldIn<IdType> outputOffset);
+    typedef void ExecutionSignature(_1, _2);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    GenerateEdgeIds(const FieldPortalType& field,
+                    const TablePortalType& numVerticesTable,
+                    const TablePortalType& triangleTable,
+                    const IdPortalType& edgeIds,
+                    const vtkm::Id3& pointDims,
+                    ComputeType isovalue):
+      Field(field),
+      NumVerticesTable(numVerticesTable),
+      TriangleTable(triangleTable),
+      EdgeIds(edgeIds),
+      PointDims(pointDims),
+      Isovalue(isovalue)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id cellId, vtkm::Id outputOffset) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      vtkm::Id pointIds[8];
+      mc::CellPointIds(cellId, this->PointDims, pointIds);
+      const vtkm::IdComponent caseNumber = CaseNumber(this->Field, pointIds, this->Isovalue);
+      const vtkm::IdComponent numVertices = this->NumVerticesTable.Get(caseNumber);
+
+      for(vtkm::IdComponent v=0; v < numVertices; ++v)
+        {
+        const vtkm::IdComponent edge = this->TriangleTable.Get(caseNumber*16 + v);
+        vtkm::IdComponent v0, v1;
+        mc::EdgeVertices(edge, v0, v1);
+
+        const vtkm::Id low = (pointIds[v0] < pointIds[v1]) ? pointIds[v0] : pointIds[v1];
+        const vtkm::Id step = (pointIds[v0] < pointIds[v1]) ? (pointIds[v1] - pointIds[v0])
+                                                            : (pointIds[v0] - pointIds[v1]);
+        const vtkm::Id axis = (step == 1) ? 0 : ((step == this->PointDims[0]) ? 1 : 2);
+        this->EdgeIds.Set(outputOffset + v, 3 * low + axis);
+        }
+    }
+
+  private:
+    FieldPortalType Field;
+    TablePortalType NumVerticesTable;
+    TablePortalType TriangleTable;
+    IdPortalType EdgeIds;
+    vtkm::Id3 PointDims;
+    ComputeType Isovalue;
+  };
+
+  class InterpolateEdge : public vtkm::worklet::WorkletMapField
+  {
+  public:
+    typedef void ControlSignature(FieldIn<IdType> edgeId,
+                                  FieldOut<Vec3> vertex,
+                                  FieldOut<Vec3> normal);
+    typedef void ExecutionSignature(_1, _2, _3);
+    typedef _1 InputDomain;
+
+    VTKM_CONT_EXPORT
+    InterpolateEdge(const FieldPortalType& field,
+                    const vtkm::Id3& pointDims,
+                    ComputeType isovalue):
+      Field(field),
+      PointDims(pointDims),
+      Isovalue(isovalue)
+      {
+      }
+
+    VTKM_EXEC_EXPORT
+    void operator()(vtkm::Id edgeId,
+                    PointType& vertex,
+                    PointType& normal) const
+    {
+      BENCHMARK_TRACE_WORK_ITEM();
+      mc::InterpolateEdge(this->Field, this->PointDims, this->Isovalue,
+                          edgeId / 3, static_cast<vtkm::IdComponent>(edgeId % 3),
+                          vertex, normal);
+    }
+
+  private:
+    FieldPortalType Field;
+    vtkm::Id3 PointDims;
+    ComputeType Isovalue;
+  };
+
+  WeldedIsosurfaceUniformGrid(const vtkm::Id3& pointDims):
+    PointDims(pointDims),
+    NumVerticesTable(vtkm::cont::make_ArrayHandle(vtkm::worklet::internal::numVerticesTable, 256)),
+    TriangleTable(vtkm::cont::make_ArrayHandle(vtkm::worklet::internal::triTable, 256*16))
+    {
+    }
+
+  // Contour field at isovalue. vertices and normals get one entry per
+  // welded point and indices 3 point ids per triangle.
+  void Run(ComputeType isovalue,
+           const vtkm::cont::ArrayHandle<FieldType>& field,
+           vtkm::cont::ArrayHandle<PointType>& vertices,
+           vtkm::cont::ArrayHandle<PointType>& normals,
+           vtkm::cont::ArrayHandle<vtkm::Id>& indices)
+  {
+    typedef vtkm::cont::DeviceAdapterAlgorithm<DeviceAdapter> Algorithm;
+
+    const vtkm::Id numCells =
+      (this->PointDims[0]-1) * (this->PointDims[1]-1) * (this->PointDims[2]-1);
+    const FieldPortalType fieldPortal = field.PrepareForInput(DeviceAdapter());
+    const TablePortalType numVerticesPortal = this->NumVerticesTable.PrepareForInput(DeviceAdapter());
+
+    //1. number of vertices each cell generates
+    vtkm::cont::ArrayHandle<vtkm::Id> numVerticesPerCell;
+    {
+    ScopedDevicePhase<Algorithm> phase("classify");
+    ClassifyCell classify(fieldPortal, numVerticesPortal, this->PointDims, isovalue);
+    vtkm::worklet::DispatcherMapField<ClassifyCell, DeviceAdapter> classifyDispatcher(classify);
+    classifyDispatcher.Invoke(vtkm::cont::make_ArrayHandleCounting(vtkm::Id(0), numCells),
+                              numVerticesPerCell);
+    }
+
+    //2. keep the cells that generate triangles and find where their
+    //   vertices go
+    vtkm::cont::ArrayHandle<vtkm::Id> validCells;
+    vtkm::cont::ArrayHandle<vtkm::Id> validNumVertices;
+    {
+    ScopedDevicePhase<Algorithm> phase("compact");
+    Algorithm::StreamCompact(numVerticesPerCell, validCells);
+    Algorithm::StreamCompact(numVerticesPerCell, numVerticesPerCell, validNumVertices);
+    numVerticesPerCell.ReleaseResources();
+    }
+
+    vtkm::cont::ArrayHandle<vtkm::Id> outputOffsets;
+    vtkm::Id numOutputVertices = 0;
+    {
+    ScopedDevicePhase<Algorithm> phase("scan");
+    numOutputVertices = Algorithm::ScanExclusive(validNumVertices, outputOffsets);
+    validNumVertices.ReleaseResources();
+    }
+
+    //3. global edge id of every output vertex
+    vtkm::cont::ArrayHandle<vtkm::Id> edgeIds;
+    {
+    ScopedDevicePhase<Algorithm> phase("edge ids");
+    GenerateEdgeIds generate(fieldPortal, numVerticesPortal,
+                             this->TriangleTable.PrepareForInput(DeviceAdapter()),
+                             edgeIds.PrepareForOutput(numOutputVertices, DeviceAdapter()),
+                             this->PointDims, isovalue);
+    vtkm::worklet::DispatcherMapField<GenerateEdgeIds, DeviceAdapter> generateDispatcher(generate);
+    generateDispatcher.Invoke(validCells, outputOffsets);
+    }
+
+    //4. weld: unique edge ids are the output points, the position of each
+    //   vertex edge id among them is its index
+    vtkm::cont::ArrayHandle<vtkm::Id> uniqueEdgeIds;
+    {
+    ScopedDevicePhase<Algorithm> weld("weld");
+    {
+    ScopedDevicePhase<Algorithm> phase("sort");
+    Algorithm::Copy(edgeIds, uniqueEdgeIds);
+    Algorithm::Sort(uniqueEdgeIds);
+    }
+    {
+    ScopedDevicePhase<Algorithm> phase("unique");
+    Algorithm::Unique(uniqueEdgeIds);
+    }
+    ScopedDevicePhase<Algorithm> phase("lower bounds");
+    Algorithm::LowerBounds(uniqueEdgeIds, edgeIds, indices);
+    }
+
+    //5. interpolate each welded point once
+    ScopedDevicePhase<Algorithm> phase("interpolate");
+    InterpolateEdge interpolate(fieldPortal, this->PointDims, isovalue);
+    vtkm::worklet::DispatcherMapField<InterpolateEdge, DeviceAdapter> interpolateDispatcher(interpolate);
+    interpolateDispatcher.Invoke(uniqueEdgeIds, vertices, normals);
+  }
+
+private:
+  vtkm::Id3 PointDims;
+  vtkm::cont::ArrayHandle<vtkm::IdComponent> NumVerticesTable;
+  vtkm::cont::ArrayHandle<vtkm::IdComponent> TriangleTable;
+};
+
+}
+
+#endif
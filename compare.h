@@ -14,96 +14,653 @@
 //
 //=============================================================================
 
-//marching cubes algorithms
-#include "compare_vtkm_mc.h"
-#include "compare_vtk_mc.h"
-#ifdef PISTON_ENABLED
-#include "compare_piston_mc.h"
-#endif
+#include "ArgumentsParser.h"
 
+#include "compare_contenders.h"
+
+#include "Baseline.h"
+#include "compare_runner.h"
+#include "ContenderRegistry.h"
+#include "MemoryUsage.h"
+#include "NrrdReader.h"
+#include "NumaPlacement.h"
+#include "ResampleUniformGrid.h"
+#include "ResultsSink.h"
 #include "saveAsPly.h"
+#include "ScalarTypes.h"
+#include "SyntheticField.h"
+#include "Volume.h"
 
 #include <vtkDataArray.h>
+#include <vtkFloatArray.h>
 #include <vtkImageData.h>
-#include <vtkImageResample.h>
 #include <vtkNrrdReader.h>
 #include <vtkPointData.h>
 #include <vtkSmartPointer.h>
 
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
 static const int NUM_TRIALS = 10;
+static const int NUM_WARMUPS = 2;
 
+// Loads a NRRD volume of one of the scalar types of ScalarTypes.h in that
+// type. Raw payloads are memory mapped and used in place, anything else
+// (compressed or ascii encodings) goes through vtkNrrdReader and is copied
+// into the volume. When resampleSize isn't 1 the volume is
+// then resampled in parallel on the device of the tag. The returned
+// vtkImageData shares its scalars with the volume. loadTime and loadMemory
+// are set to the time reading took and the memory it used, not counting
+// the resampling.
+template<typename DeviceAdapter>
 static vtkSmartPointer<vtkImageData>
-ReadData(std::vector<vtkm::Float32> &buffer, std::string file,  double resampleSize=1.0)
+ReadData(bench::Volume& volume, std::string file, double& loadTime,
+         bench::PhaseMemory& loadMemory, double resampleSize, DeviceAdapter device)
 {
-  //make sure we are testing float benchmarks only
-  assert(sizeof(float) == sizeof(vtkm::Float32));
-
   std::cout << "loading file: " << file << " " << resampleSize << std::endl;
-  vtkNew<vtkNrrdReader> reader;
-  reader->SetFileName(file.c_str());
-  reader->Update();
-
-  //re-sample the dataset
-  /*vtkNew<vtkImageResample> resample;
-  resample->SetInputConnection(reader->GetOutputPort());
-  resample->SetAxisMagnificationFactor(0,resampleSize);
-  resample->SetAxisMagnificationFactor(1,resampleSize);
-  resample->SetAxisMagnificationFactor(2,resampleSize);
-
-  resample->Update();*/
-reader->Update();
-
-  //take ref
-  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
-  vtkImageData *newImageData = vtkImageData::SafeDownCast(reader->GetOutputDataObject(0)); //resample->GetOutputDataObject(0));
-  image.TakeReference( newImageData );
-  image->Register(NULL);
-
-  //now set the buffer
-  vtkDataArray *newData = image->GetPointData()->GetScalars();
-  vtkm::Float32* rawBuffer = reinterpret_cast<vtkm::Float32*>( newData->GetVoidPointer(0) );
-  buffer.resize( newData->GetNumberOfTuples() );
-  std::copy(rawBuffer, rawBuffer + newData->GetNumberOfTuples(), buffer.begin() );
-
-  return image;
+  bench::MemoryProbe probe;
+  probe.Begin();
+  vtkm::cont::Timer<> timer;
+
+  bench::NrrdHeader header;
+  boost::shared_ptr<bench::MappedFile> mapping;
+  std::string error;
+  if(header.Read(file, error) &&
+     bench::ScalarTypeFromNrrd(header.Type) != bench::SCALAR_UNSUPPORTED &&
+     bench::MapNrrdPayload(header, mapping, error))
+    {
+    volume.SetMapped(mapping, header);
+    }
+  else
+    {
+    if(!error.empty())
+      {
+      std::cout << "unable to map payload (" << error << "), "
+                << "falling back to vtkNrrdReader" << std::endl;
+      }
+
+    vtkNew<vtkNrrdReader> reader;
+    reader->SetFileName(file.c_str());
+    reader->Update();
+
+    vtkImageData *readImage = vtkImageData::SafeDownCast(reader->GetOutputDataObject(0));
+    vtkDataArray *newData = readImage ? readImage->GetPointData()->GetScalars() : NULL;
+    const bench::ScalarType type = newData ?
+      bench::ScalarTypeFromVTK(newData->GetDataType()) : bench::SCALAR_UNSUPPORTED;
+    if(type == bench::SCALAR_UNSUPPORTED)
+      {
+      std::cerr << "only uint8, uint16, float and double volumes are supported" << std::endl;
+      return NULL;
+      }
+
+    int dims[3];
+    readImage->GetDimensions(dims);
+    const char* rawBuffer = static_cast<const char*>(newData->GetVoidPointer(0));
+    std::copy(rawBuffer, rawBuffer + newData->GetNumberOfTuples() * bench::ScalarTypeSize(type),
+              static_cast<char*>(volume.Allocate(dims, type)));
+    volume.SetSpacing(readImage->GetSpacing());
+    volume.SetOrigin(readImage->GetOrigin());
+    }
+
+  loadTime = timer.GetElapsedTime();
+  loadMemory = probe.End();
+  std::cout << "Load \'" << file << "\' results:\n"
+            << "\tscalar type = " << bench::ScalarTypeName(volume.GetScalarType()) << "\n"
+            << "\tmemory mapped = " << (volume.IsMapped() ? "yes" : "no") << "\n"
+            << "\tload time = " << loadTime << "s\n"
+            << "\tresident memory added = " << bench::ToMegaBytes(loadMemory.ResidentDelta) << "MB\n"
+            << "\tpeak resident memory = " << bench::ToMegaBytes(loadMemory.PeakResidentBytes) << "MB\n"
+            << "\tallocated = " << bench::ToMegaBytes(loadMemory.AllocatedBytes) << "MB" << std::endl;
+
+  if(resampleSize != 1.0)
+    {
+    bench::ResampleVolume(volume, resampleSize, device);
+    }
+
+  return volume.NewImageData();
 }
 
 
-int RunComparison(std::string device,
-                  std::string file,
-                  std::string writeLoc,
-                  int targetNumCores,
-                  int maxNumCores,
-                  float isoValue,
-                  double resampleRatio)
+// Fills the volume with a synthetic field, computed in parallel on the
+// device of the tag instead of read from disk. loadTime is set to the time the fill
+// took and loadMemory to the memory it used. Like ReadData the volume is
+// then resampled when resampleSize isn't 1, and the returned vtkImageData
+// shares its scalars with it.
+template<typename DeviceAdapter>
+static vtkSmartPointer<vtkImageData>
+GenerateData(bench::Volume& volume, const std::string& name,
+             const bench::SyntheticField& field, double& loadTime,
+             bench::PhaseMemory& loadMemory, double resampleSize, DeviceAdapter device)
 {
-  std::vector<vtkm::Float32> buffer;
-  vtkSmartPointer< vtkImageData > image = ReadData(buffer, file, resampleRatio);
+  std::cout << "generating field: " << name << " " << resampleSize << std::endl;
+  bench::MemoryProbe probe;
+  probe.Begin();
+  vtkm::cont::Timer<> timer;
 
-  //get dims of image data
-  int dims[3]; image->GetDimensions(dims);
-  std::cout << "data dims are: " << dims[0] << ", " << dims[1] << ", " << dims[2] << std::endl;
+  bench::FillSyntheticVolume(volume, field, device);
+
+  loadTime = timer.GetElapsedTime();
+  loadMemory = probe.End();
+  std::cout << "Generate \'" << name << "\' results:\n"
+            << "\tvalues = " << volume.GetNumberOfValues() << "\n"
+            << "\tgenerate time = " << loadTime << "s\n"
+            << "\tresident memory added = " << bench::ToMegaBytes(loadMemory.ResidentDelta) << "MB" << std::endl;
+
+  if(resampleSize != 1.0)
+    {
+    bench::ResampleVolume(volume, resampleSize, device);
+    }
+
+  return volume.NewImageData();
+}
+
+// Loads the volume as the work of a CoreLimit, so the synthetic fill and
+// the resampling run on the threads of the largest core count of the sweep
+// rather than in a default scheduler of the main thread that a smaller
+// limit couldn't bound. Generates field when it isn't NULL, named name,
+// else reads file. With serial set it is all done on the calling thread
+// with the serial device adapter instead, for a process that must not
+// start TBB before it forks isolated contenders.
+struct LoadVolume
+{
+  LoadVolume(bench::Volume& volume, const std::string& file,
+             const bench::SyntheticField* field, const std::string& name,
+             bench::RunInfo& info, double resampleSize, bool serial):
+    Volume(volume),
+    File(file),
+    Field(field),
+    Name(name),
+    Info(info),
+    ResampleSize(resampleSize),
+    Serial(serial)
+    {
+    }
+
+  void operator()()
+  {
+    if(this->Serial)
+      {
+      this->Load(vtkm::cont::DeviceAdapterTagSerial());
+      }
+    else
+      {
+      this->Load(VTKM_DEFAULT_DEVICE_ADAPTER_TAG());
+      }
+  }
+
+  template<typename DeviceAdapter>
+  void Load(DeviceAdapter device)
+  {
+    this->Image = this->Field ?
+      GenerateData(this->Volume, this->Name, *this->Field, this->Info.LoadTime,
+                   this->Info.LoadMemory, this->ResampleSize, device) :
+      ReadData(this->Volume, this->File, this->Info.LoadTime,
+               this->Info.LoadMemory, this->ResampleSize, device);
+  }
+
+  bench::Volume& Volume;
+  std::string File;
+  const bench::SyntheticField* Field;
+  std::string Name;
+  bench::RunInfo& Info;
+  double ResampleSize;
+  bool Serial;
+  vtkSmartPointer<vtkImageData> Image;
+};
+
+// Moves the values of the volume into memory first touched by the threads
+// that will contour them and returns new image data sharing it, NULL when
+// that failed. Without a reserved pool hugetlb falls back to transparent
+// huge pages, and hugePages is set to them.
+static vtkSmartPointer<vtkImageData>
+PlaceData(bench::Volume& volume, bench::HugePageMode& hugePages,
+          const bench::NumaTopology& topology)
+{
+  vtkm::cont::Timer<> timer;
+  std::string error;
+  boost::shared_ptr<bench::PlacedBuffer> buffer = volume.Place(hugePages, error);
+  if(!buffer && hugePages == bench::HUGE_PAGES_HUGETLB)
+    {
+    std::cout << "unable to get hugetlb pages (" << error << "), "
+              << "falling back to transparent huge pages" << std::endl;
+    timer.Reset();
+    hugePages = bench::HUGE_PAGES_TRANSPARENT;
+    buffer = volume.Place(hugePages, error);
+    }
+  if(!buffer)
+    {
+    std::cerr << "unable to place the volume: " << error << std::endl;
+    return NULL;
+    }
+
+  bench::PrintPlacement("volume", *buffer, hugePages, timer.GetElapsedTime(), topology);
+  return volume.NewImageData();
+}
+
+// Places the volume again whenever the threads a run contours it with
+// change, first touched by the threads of its core count and pinned cpus,
+// so each run reads pages on the nodes of its own threads instead of those
+// the largest core count would have put them on. Every contender run on
+// the same threads reuses the placement: a placement is copied from the
+// previous one, which holds the volume twice until the copy is done, so
+// it happens once per step of the core sweep and not per contender.
+// Hugetlb pages that were unavailable once aren't asked for again.
+class PlaceVolume : public bench::InputPreparation
+{
+public:
+  PlaceVolume(bench::Volume& volume, bench::HugePageMode hugePages,
+              const bench::NumaTopology& topology):
+    Volume(volume),
+    HugePages(hugePages),
+    Topology(topology),
+    NumCores(0)
+    {
+    }
+
+  virtual bool Prepare(bench::ContenderContext& context)
+  {
+    if(this->Image.GetPointer() == NULL ||
+       this->NumCores != context.NumCores || this->PinnedCpus != context.PinnedCpus)
+      {
+      std::cout << "placing the volume for " << context.NumCores << " cores" << std::endl;
+      this->Image = PlaceData(this->Volume, this->HugePages, this->Topology);
+      this->NumCores = context.NumCores;
+      this->PinnedCpus = context.PinnedCpus;
+      }
+    context.Image = this->Image;
+    return this->Image.GetPointer() != NULL;
+  }
+
+private:
+  bench::Volume& Volume;
+  bench::HugePageMode HugePages;
+  const bench::NumaTopology& Topology;
+  //the threads of the last placement and the image sharing its values
+  int NumCores;
+  std::vector<int> PinnedCpus;
+  vtkSmartPointer<vtkImageData> Image;
+};
+
+// Reports a result and writes it to the results file. Gets it once the
+// contender has returned and freed its state, which ends its teardown. In
+// the child of an isolated contender this is all that happens to it.
+class ReportResults : public bench::ResultCollector
+{
+public:
+  explicit ReportResults(bench::ResultsSink& results):
+    Results(results)
+    {
+    }
 
-  std::cout << "vtkMarchingCubes,Accelerator,Cores,Time,Trial" << std::endl;
+  virtual void Collect(const bench::Result& collected)
   {
-  const int singleCore = 1;
-  vtk::RunImageMarchingCubes(image, device,
-                             singleCore, maxNumCores, isoValue, NUM_TRIALS);
+    bench::Result result = collected;
+    bench::EndTeardown(result);
+    bench::PrintFieldThroughput(result);
+    std::cout << "Teardown \'" << result.Name << "\' results:\n"
+              << "\tresident memory added = "
+              << bench::ToMegaBytes(result.TeardownMemory.ResidentDelta) << "MB" << std::endl;
+    this->Results.Write(result);
   }
 
-  std::cout << "vtkmIsoSurfaceUniformGrid,Accelerator,Cores,Time,Trial" << std::endl;
+private:
+  bench::ResultsSink& Results;
+};
+
+// Keeps a result for the scaling report and the baseline check, which
+// outlive every contender, isolated or not
+class KeepResults : public bench::ResultCollector
+{
+public:
+  KeepResults(bench::ScalingTable& scaling, bench::BaselineCheck& baseline):
+    Scaling(scaling),
+    Baseline(baseline)
+    {
+    }
+
+  virtual void Collect(const bench::Result& result)
   {
-  vtkm::RunIsoSurfaceUniformGrid(buffer, image, device,
-                                 targetNumCores, maxNumCores, isoValue, NUM_TRIALS);
+    this->Scaling.Add(result);
+    this->Baseline.Add(result);
   }
 
-  std::cout << "pistonMarchingCubes,Accelerator,Cores,Time,Trial" << std::endl;
+private:
+  bench::ScalingTable& Scaling;
+  bench::BaselineCheck& Baseline;
+};
+
+// Both of the above, for a contender run in this process
+class CollectResults : public bench::ResultCollector
+{
+public:
+  CollectResults(ReportResults& report, KeepResults& keep):
+    Report(report),
+    Keep(keep)
+    {
+    }
+
+  virtual void Collect(const bench::Result& result)
   {
-  piston::RunIsoSurfaceUniformGrid(buffer, image, device,
-                                   targetNumCores, maxNumCores, isoValue, NUM_TRIALS);
+    this->Report.Collect(result);
+    this->Keep.Collect(result);
   }
-  return 0;
+
+private:
+  ReportResults& Report;
+  KeepResults& Keep;
+};
+
+// Runs a contender at context.NumCores, in a child process of its own with
+// --isolate
+static void RunContender(bench::Contender& contender,
+                         const bench::ContenderContext& context,
+                         bool isolate,
+                         ReportResults& report,
+                         KeepResults& keep)
+{
+  if(isolate)
+    {
+    bench::RunIsolated(contender, context, report, keep);
+    return;
+    }
+
+  CollectResults collect(report, keep);
+  bench::RunOnCores(contender, context, collect);
+}
+
+int RunComparison(std::string device,
+                  const vtkm::testing::ArgumentsParser& parser,
+                  int targetNumCores,
+                  int maxNumCores)
+{
+  const std::string file = parser.file();
+  const std::string writeLoc = parser.writeLocation();
+  const float isoValue = parser.isovalue();
+  const double resampleRatio = parser.ratio();
+
+  //--synthetic replaces the file by a generated field, which --implicit
+  //computes on access instead of storing in the volume
+  const bool synthetic = !parser.synthetic().empty();
+  const bool implicit = synthetic && parser.implicit();
+  //--stream contours the file slab by slab instead of loading it
+  const bool streaming = !synthetic && !parser.slabSizes().empty();
+  bench::SyntheticField::FunctionType function = bench::SyntheticField::TANGLE;
+  if(synthetic && !bench::SyntheticField::FromName(parser.synthetic(), function))
+    {
+    std::cerr << "unknown synthetic field " << parser.synthetic() << std::endl;
+    return 1;
+    }
+  const bench::SyntheticField field(function,
+                                    vtkm::Id3(parser.dims(), parser.dims(), parser.dims()));
+
+  const int pipeline = parser.pipeline();
+  if(pipeline != bench::PIPELINE_THRESHOLD && pipeline != bench::PIPELINE_MARCHING_CUBES)
+    {
+    std::cerr << "unknown pipeline " << pipeline
+              << ", 1 is threshold and 2 marching cubes" << std::endl;
+    return 1;
+    }
+  if(pipeline == bench::PIPELINE_THRESHOLD && (implicit || streaming))
+    {
+    std::cerr << "the threshold pipeline needs a volume, "
+              << "it can't be used with --implicit or --stream" << std::endl;
+    return 1;
+    }
+
+  //everything but the input and the core count of the contenders, which
+  //say from it whether they run before anything is loaded
+  bench::ContenderContext context;
+  context.Input = implicit ? bench::INPUT_IMPLICIT :
+                  (streaming ? bench::INPUT_STREAM : bench::INPUT_VOLUME);
+  context.Pipeline = pipeline;
+  context.Device = device;
+  context.MaxNumCores = maxNumCores;
+  context.IsoValue = isoValue;
+  context.Parser = &parser;
+
+  const bench::ContenderRegistry& registry = bench::ContenderRegistry::Instance();
+  for(std::size_t i=0; i < parser.algorithms().size(); ++i)
+    {
+    if(!registry.Has(parser.algorithms()[i]))
+      {
+      const std::vector<std::string> names = registry.GetNames();
+      std::cerr << "unknown algorithm " << parser.algorithms()[i] << ", one of";
+      for(std::size_t j=0; j < names.size(); ++j)
+        {
+        std::cerr << " " << names[j];
+        }
+      std::cerr << std::endl;
+      return 1;
+      }
+    }
+  bench::ContenderRegistry::ContenderList contenders;
+  {
+  const bench::ContenderRegistry::ContenderList selected =
+    registry.Select(parser.algorithms(), device);
+  for(std::size_t i=0; i < selected.size(); ++i)
+    {
+    if(selected[i]->Accepts(context))
+      {
+      contenders.push_back(selected[i]);
+      }
+    }
+  }
+  if(contenders.empty())
+    {
+    std::cerr << "none of the algorithms selected runs on " << device
+              << " for this pipeline and input" << std::endl;
+    return 1;
+    }
+  if(parser.isolate() && !parser.traceFile().empty())
+    {
+    std::cout << "the phases of isolated contenders are not in the trace, "
+              << "they are recorded by their child processes" << std::endl;
+    }
+
+  bench::HugePageMode hugePages = bench::HUGE_PAGES_NONE;
+  if(!bench::HugePageModeFromName(parser.hugePages(), hugePages))
+    {
+    std::cerr << "unknown huge page mode " << parser.hugePages() << std::endl;
+    return 1;
+    }
+  const bench::NumaTopology topology;
+  //each run pins the threads of its own core limit, the main thread is
+  //pinned before anything is touched, so the placement matches the runs
+  std::vector<int> pinnedCpus;
+  if(parser.pin())
+    {
+    pinnedCpus = topology.CompactCpuOrder();
+    if(!pinnedCpus.empty())
+      {
+      bench::PinCurrentThread(pinnedCpus.front());
+      }
+    }
+  if(parser.numa())
+    {
+    bench::UseFreshPagesForLargeAllocations();
+    }
+  if(parser.numa() || parser.pin())
+    {
+    std::cout << "Topology 'numa' results:\n"
+              << "\tnodes = " << topology.GetNumberOfNodes() << "\n"
+              << "\tcpus per node = " << topology.GetCpusPerNode() << "\n"
+              << "\tpinned = " << (parser.pin() ? "yes" : "no") << std::endl;
+    }
+
+  bench::RunInfo info;
+  info.File = synthetic ? ("synthetic:" + parser.synthetic()) : file;
+  info.Device = device;
+  info.IsoValue = isoValue;
+  info.Host = bench::HostName();
+  info.StartTime = bench::UtcTimeStamp();
+
+  //declared first so it outlives every array that shares its memory
+  bench::Volume volume;
+  vtkSmartPointer< vtkImageData > image;
+  int dims[3] = { parser.dims(), parser.dims(), parser.dims() };
+  bench::NrrdHeader header;
+  if(streaming)
+    {
+    std::string error;
+    long long payloadOffset = 0;
+    if(!header.Read(file, error) ||
+       !bench::LocateNrrdPayload(header, payloadOffset, error) ||
+       bench::ScalarTypeFromNrrd(header.Type) == bench::SCALAR_UNSUPPORTED)
+      {
+      std::cerr << "unable to stream " << file << ": "
+                << (error.empty() ? "only uint8, uint16, float and double volumes are supported" : error)
+                << std::endl;
+      return 1;
+      }
+    for(int i=0; i < 3; ++i)
+      {
+      dims[i] = static_cast<int>(header.Sizes[i]);
+      }
+    }
+  else if(!implicit)
+    {
+    //forking a process that has started TBB is undefined, with --isolate
+    //the parent leaves it to the children
+    LoadVolume load(volume, file, synthetic ? &field : NULL, parser.synthetic(),
+                    info, resampleRatio, parser.isolate());
+    if(parser.isolate())
+      {
+      load();
+      }
+    else
+      {
+      bench::RunOnCores(maxNumCores, pinnedCpus, load);
+      }
+    image = load.Image;
+    if(!image)
+      {
+      return 1;
+      }
+
+    //get dims of image data
+    image->GetDimensions(dims);
+    }
+  std::cout << "data dims are: " << dims[0] << ", " << dims[1] << ", " << dims[2] << std::endl;
+  std::copy(dims, dims + 3, info.Dimensions);
+
+  bench::ResultsSink results;
+  if(!parser.resultsFile().empty() && !results.Open(parser.resultsFile(), info))
+    {
+    return 1;
+    }
+
+  bench::RunnerOptions options;
+  options.NumWarmups = NUM_WARMUPS;
+  options.NumTrials = (parser.trials() > 0) ? parser.trials() : NUM_TRIALS;
+  options.TargetPrecision = parser.precision();
+  options.TimeBudget = parser.timeBudget();
+  options.Device = device;
+  options.DumpDirectory = writeLoc;
+  if(parser.counters())
+    {
+    //check once here rather than have every contender report it
+    bench::PerfCounters probe;
+    std::string error;
+    options.Counters = probe.Initialize(error);
+    if(!options.Counters)
+      {
+      std::cout << "hardware counters unavailable (" << error << "), "
+                << "only timing and memory are reported" << std::endl;
+      }
+    }
+  bench::PhaseTrace::SetEnabled(parser.phases());
+  if(!writeLoc.empty())
+    {
+    ply::MakeDirectory(writeLoc);
+    }
+
+  bench::ScalingTable scaling;
+
+  bench::BaselineCheck baseline(info);
+  if(!parser.baseline().empty() &&
+     !baseline.Load(parser.baseline(),
+                    parser.regressionThreshold(), parser.significance()))
+    {
+    return 1;
+    }
+  if(!parser.saveBaseline().empty())
+    {
+    baseline.Record(parser.saveBaseline());
+    }
+
+  //with --numa every core count places the volume on the nodes of its threads
+  PlaceVolume placement(volume, hugePages, topology);
+
+  //only the input of the run is set
+  if(implicit)
+    {
+    context.Field = &field;
+    }
+  else if(streaming)
+    {
+    context.Header = &header;
+    }
+  else
+    {
+    context.Volume = &volume;
+    context.Image = image;
+    if(parser.numa())
+      {
+      context.Preparation = &placement;
+      }
+    }
+  context.Options = &options;
+  context.PinnedCpus = pinnedCpus;
+
+  ReportResults report(results);
+  KeepResults keep(scaling, baseline);
+
+  //serial contenders are only run once, on a single core, whatever the sweep
+  context.NumCores = 1;
+  for(std::size_t i=0; i < contenders.size(); ++i)
+    {
+    if(contenders[i]->IsSerial())
+      {
+      RunContender(*contenders[i], context, parser.isolate(), report, keep);
+      }
+    }
+
+  const std::vector<int> coreCounts = bench::CoreCounts(targetNumCores, maxNumCores);
+  for(std::size_t i=0; i < coreCounts.size(); ++i)
+    {
+    context.NumCores = coreCounts[i];
+    for(std::size_t j=0; j < contenders.size(); ++j)
+      {
+      if(!contenders[j]->IsSerial())
+        {
+        RunContender(*contenders[j], context, parser.isolate(), report, keep);
+        }
+      }
+    }
+
+  scaling.Print(std::cout);
+  if(parser.pin())
+    {
+    scaling.PrintPerSocket(std::cout, topology.GetCpusPerNode());
+    }
+  const bool regressed = !baseline.Finish();
+
+  if(!parser.traceFile().empty())
+    {
+    if(bench::PhaseTrace::WriteChromeTrace(parser.traceFile()))
+      {
+      std::cout << "wrote phase trace to " << parser.traceFile() << std::endl;
+      }
+    else
+      {
+      std::cerr << "unable to write phase trace " << parser.traceFile() << std::endl;
+      }
+    }
+
+  std::cout << "peak resident memory = "
+            << bench::ToMegaBytes(bench::ProcessPeakResidentBytes()) << "MB" << std::endl;
+  return regressed ? 2 : 0;
 }
@@ -0,0 +1,30 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+
+// Every header defining contenders of compare. Each registers its own with
+// bench::ContenderRegistry, they run in the order they are included in.
+
+//marching cubes algorithms
+#include "compare_vtk_mc.h"
+#include "compare_vtkm_mc.h"
+#include "compare_roofline_mc.h"
+#ifdef PISTON_ENABLED
+#include "compare_piston_mc.h"
+#endif
+
+//threshold algorithms
+#include "compare_vtk_threshold.h"
+#include "compare_vtkm_threshold.h"
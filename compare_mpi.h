@@ -0,0 +1,685 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+
+#include <mpi.h>
+
+#include "ArgumentsParser.h"
+
+#include "compare_vtkm_mc.h"
+
+#include "compare_runner.h"
+#include "NrrdReader.h"
+#include "ResultsSink.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+namespace mpi
+{
+namespace detail
+{
+typedef vtkm::detail::DeviceAdapter DeviceAdapter;
+typedef vtkm::detail::IsosurfaceFilter IsosurfaceFilter;
+
+// Cells along z that rank contours when cellsZ cells are split over
+// numRanks ranks, as evenly as possible. The rank holds the numCells + 1
+// slices of points of its cells, the last one being the first of the next
+// rank, so every cell is contoured by exactly one rank.
+static void RankSlab(vtkm::Id cellsZ, int rank, int numRanks,
+                     vtkm::Id& zBegin, vtkm::Id& numCells)
+{
+  zBegin = cellsZ * rank / numRanks;
+  numCells = cellsZ * (rank + 1) / numRanks - zBegin;
+}
+
+// Wait at a barrier of comm without spinning, so that the ranks left out of
+// a configuration don't take cores from the ones running it
+static void IdleBarrier(MPI_Comm comm)
+{
+  MPI_Request request;
+  MPI_Ibarrier(comm, &request);
+  int done = 0;
+  MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+  while(!done)
+    {
+    ::usleep(1000);
+    MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+    }
+}
+
+// The z slab of the volume a rank holds, read once per number of ranks,
+// and the filter contouring it. A rank without cells, when there are more
+// ranks than cells along z, has no filter.
+struct RankState
+{
+  RankState():
+    ZBegin(0),
+    NumCellsZ(0),
+    ReadTime(0.0)
+    {
+    }
+
+  vtkm::Id ZBegin;
+  vtkm::Id NumCellsZ;
+  double ReadTime;
+  std::vector<vtkm::Float32> Values;
+  vtkm::cont::ArrayHandle<vtkm::Float32> Field;
+  vtkm::cont::DataSet DataSet;
+  boost::shared_ptr<IsosurfaceFilter> Filter;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > VerticesArray;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > NormalsArray;
+  vtkm::cont::ArrayHandle<vtkm::Float32> ScalarsArray;
+};
+
+// Split cost, the estimated cost of every layer of cells along z, in
+// numRanks contiguous ranges of about the same total cost. begins gets the
+// first layer of every rank followed by the number of layers. Every rank
+// gets at least a layer when there are enough of them.
+static void BalancedSlabs(const std::vector<double>& cost, int numRanks,
+                          std::vector<vtkm::Id>& begins)
+{
+  const vtkm::Id numLayers = static_cast<vtkm::Id>(cost.size());
+  std::vector<double> prefix(cost.size() + 1, 0.0);
+  for(std::size_t i=0; i < cost.size(); ++i)
+    {
+    prefix[i + 1] = prefix[i] + cost[i];
+    }
+
+  begins.assign(numRanks + 1, 0);
+  begins[numRanks] = numLayers;
+  for(int r=1; r < numRanks; ++r)
+    {
+    const double target = prefix.back() * r / numRanks;
+    vtkm::Id begin = static_cast<vtkm::Id>(
+      std::lower_bound(prefix.begin(), prefix.end(), target) - prefix.begin());
+    if(numLayers >= numRanks)
+      {
+      begin = std::max(begin, begins[r - 1] + 1);
+      begin = std::min(begin, numLayers - (numRanks - r));
+      }
+    begins[r] = std::max(begins[r - 1], std::min(begin, numLayers));
+    }
+}
+
+// Slowest rank's cost over the mean one, when the layers are split at begins
+static double CostImbalance(const std::vector<double>& cost,
+                            const std::vector<vtkm::Id>& begins)
+{
+  const int numRanks = static_cast<int>(begins.size()) - 1;
+  double slowest = 0.0;
+  double sum = 0.0;
+  for(int r=0; r < numRanks; ++r)
+    {
+    double rankCost = 0.0;
+    for(vtkm::Id i = begins[r]; i < begins[r + 1]; ++i)
+      {
+      rankCost += cost[static_cast<std::size_t>(i)];
+      }
+    slowest = std::max(slowest, rankCost);
+    sum += rankCost;
+    }
+  return (sum > 0.0) ? slowest * numRanks / sum : 1.0;
+}
+
+// Read numCellsZ layers of cells from zBegin on with pread, so that each
+// rank only ever touches its part of the file, like vtkPNrrdReader with an
+// update extent
+static bool ReadRankSlab(const bench::NrrdHeader& header, vtkm::Id zBegin,
+                         vtkm::Id numCellsZ, RankState& state, std::string& error)
+{
+  vtkm::cont::Timer<> timer;
+  bench::NrrdSlabReader reader;
+  if(!reader.Open(header, error))
+    {
+    return false;
+    }
+
+  state.ZBegin = zBegin;
+  state.NumCellsZ = numCellsZ;
+  if(state.NumCellsZ == 0)
+    {
+    return true;
+    }
+
+  const vtkm::Id3 pointDims(header.Sizes[0], header.Sizes[1], state.NumCellsZ + 1);
+  const vtkm::Id3 cellDims(pointDims[0] - 1, pointDims[1] - 1, state.NumCellsZ);
+  const vtkm::Id numValues = pointDims[0] * pointDims[1] * pointDims[2];
+  state.Values.resize(static_cast<std::size_t>(numValues));
+  if(!reader.Read(state.ZBegin, pointDims[2], reinterpret_cast<char*>(&state.Values[0])))
+    {
+    std::ostringstream message;
+    message << "unable to read slices " << zBegin << " to " << (zBegin + numCellsZ);
+    error = message.str();
+    return false;
+    }
+
+  state.Field = vtkm::cont::make_ArrayHandle(&state.Values[0], numValues);
+  vtkm::detail::BuildUniformDataSet(state.DataSet, pointDims,
+    vtkm::Vec<vtkm::FloatDefault,3>(0.0f, 0.0f, static_cast<vtkm::FloatDefault>(state.ZBegin)));
+  state.DataSet.AddField(vtkm::cont::Field("nodevar", 1, vtkm::cont::Field::ASSOC_POINTS,
+                                           state.Field));
+  state.Filter.reset(new IsosurfaceFilter(cellDims, state.DataSet));
+  state.ReadTime = timer.GetElapsedTime();
+  return true;
+}
+
+//cells of a layer classified by EstimateLayerCosts, one out of this many
+//along x and along y
+static const vtkm::Id SAMPLE_STRIDE = 4;
+//cost of generating the triangles of an active cell relative to the cost
+//of classifying a cell, which every cell pays
+static const double ACTIVE_CELL_COST = 10.0;
+
+// Estimate what contouring each layer of cells of the slab of a rank costs
+// at isoValue: every cell is classified and the active ones also generate
+// triangles. Only one cell out of SAMPLE_STRIDE^2 of a layer is classified
+// and stands for the ones around it, which is cheap next to the contour
+// and good enough to balance on.
+static std::vector<double> EstimateLayerCosts(const RankState& state,
+                                              const bench::NrrdHeader& header,
+                                              float isoValue)
+{
+  const vtkm::Id dimX = header.Sizes[0];
+  const vtkm::Id dimY = header.Sizes[1];
+  const vtkm::Id sliceSize = dimX * dimY;
+  const double cellsPerLayer = static_cast<double>((dimX - 1) * (dimY - 1));
+
+  std::vector<double> cost(static_cast<std::size_t>(state.NumCellsZ), 0.0);
+  for(vtkm::Id z=0; z < state.NumCellsZ; ++z)
+    {
+    vtkm::Id active = 0;
+    vtkm::Id sampled = 0;
+    for(vtkm::Id y=0; y < dimY - 1; y += SAMPLE_STRIDE)
+      {
+      for(vtkm::Id x=0; x < dimX - 1; x += SAMPLE_STRIDE)
+        {
+        const vtkm::Float32* corner = &state.Values[static_cast<std::size_t>(
+          z * sliceSize + y * dimX + x)];
+        const vtkm::Id offsets[8] = { 0, 1, dimX, dimX + 1, sliceSize, sliceSize + 1,
+                                      sliceSize + dimX, sliceSize + dimX + 1 };
+        int above = 0;
+        for(int i=0; i < 8; ++i)
+          {
+          above += (corner[offsets[i]] > isoValue) ? 1 : 0;
+          }
+        active += (above > 0 && above < 8) ? 1 : 0;
+        ++sampled;
+        }
+      }
+    const double activeFraction = (sampled > 0) ?
+      static_cast<double>(active) / static_cast<double>(sampled) : 0.0;
+    cost[static_cast<std::size_t>(z)] =
+      cellsPerLayer * (1.0 + ACTIVE_CELL_COST * activeFraction);
+    }
+  return cost;
+}
+
+//contour the slab of a rank, returns the number of triangles
+static vtkm::Id RunRankSlab(RankState& state, float isoValue)
+{
+  if(!state.Filter)
+    {
+    return 0;
+    }
+  state.Filter->Run(isoValue, state.Field,
+                    state.VerticesArray, state.NormalsArray, state.ScalarsArray);
+  return state.VerticesArray.GetNumberOfValues() / 3;
+}
+
+//RunRankSlab as the work of a CoreLimit
+struct RankSlabRun
+{
+  RankSlabRun(RankState& state, float isoValue):
+    State(state),
+    IsoValue(isoValue),
+    NumTriangles(0)
+    {
+    }
+
+  void operator()()
+  {
+    this->NumTriangles = RunRankSlab(this->State, this->IsoValue);
+  }
+
+  RankState& State;
+  float IsoValue;
+  vtkm::Id NumTriangles;
+};
+
+}
+
+// Run the VTK-m isosurface on every rank of comm, each one contouring its
+// own z slab with numThreads TBB threads. Every trial starts at a barrier
+// and ends at another one: each rank times its contour and then its wait
+// for the slowest rank, and the trial takes as long as the slowest rank.
+// Only the Result of rank 0 holds the samples, everything is gathered to it.
+static bench::Result RunIsoSurfaceUniformGrid(detail::RankState& state,
+                                              MPI_Comm comm,
+                                              int numThreads,
+                                              float isoValue,
+                                              bool balanced,
+                                              const bench::RunnerOptions& options)
+{
+  int rank = 0;
+  int numRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &numRanks);
+
+  std::ostringstream name;
+  name << "VTK-m MPI Isosurface (" << numRanks << " ranks"
+       << (balanced ? ", balanced" : "") << ")";
+
+  bench::Result result;
+  result.Name = name.str();
+  result.NumCores = numRanks * numThreads;
+
+  bench::CoreLimit coreLimit(numThreads);
+  for(int i=0; i < options.NumWarmups; ++i)
+    {
+    detail::RankSlabRun warmup(state, isoValue);
+    coreLimit.Execute(warmup);
+    MPI_Barrier(comm);
+    }
+
+  const int numTrials = options.NumTrials;
+  std::vector<double> compute(numTrials, 0.0);
+  std::vector<double> barrier(numTrials, 0.0);
+  std::vector<double> wall(numTrials, 0.0);
+  std::vector<long long> triangles(numTrials, 0);
+  for(int i=0; i < numTrials; ++i)
+    {
+    MPI_Barrier(comm);
+    detail::RankSlabRun trial(state, isoValue);
+    vtkm::cont::Timer<> timer;
+    coreLimit.Execute(trial);
+    compute[i] = timer.GetElapsedTime();
+    triangles[i] = trial.NumTriangles;
+    MPI_Barrier(comm);
+    wall[i] = timer.GetElapsedTime();
+    barrier[i] = wall[i] - compute[i];
+    }
+
+  //rank r's trials are at r * numTrials of the gathered arrays
+  std::vector<double> allCompute(rank == 0 ? numRanks * numTrials : 0);
+  std::vector<double> allBarrier(rank == 0 ? numRanks * numTrials : 0);
+  std::vector<double> slowest(numTrials, 0.0);
+  std::vector<long long> totalTriangles(numTrials, 0);
+  MPI_Gather(&compute[0], numTrials, MPI_DOUBLE,
+             rank == 0 ? &allCompute[0] : NULL, numTrials, MPI_DOUBLE, 0, comm);
+  MPI_Gather(&barrier[0], numTrials, MPI_DOUBLE,
+             rank == 0 ? &allBarrier[0] : NULL, numTrials, MPI_DOUBLE, 0, comm);
+  MPI_Reduce(&wall[0], &slowest[0], numTrials, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(&triangles[0], &totalTriangles[0], numTrials, MPI_LONG_LONG, MPI_SUM, 0, comm);
+  if(rank != 0)
+    {
+    return result;
+    }
+
+  result.Samples = slowest;
+  result.NumTriangles.assign(totalTriangles.begin(), totalTriangles.end());
+  result.MedianInterval = stats::BootstrapMedianInterval(result.Samples,
+                                                         bench::MEDIAN_CONFIDENCE);
+  result.StopReason = "fixed number of trials";
+  result.Ranks.resize(numRanks);
+  for(int r=0; r < numRanks; ++r)
+    {
+    bench::RankTimes& times = result.Ranks[r];
+    times.Rank = r;
+    times.Compute.assign(allCompute.begin() + r * numTrials,
+                         allCompute.begin() + (r + 1) * numTrials);
+    times.Barrier.assign(allBarrier.begin() + r * numTrials,
+                         allBarrier.begin() + (r + 1) * numTrials);
+    }
+
+  bench::PrintSummary(result.Name, result.Samples);
+  std::cout << "\tthreads per rank = " << numThreads << "\n"
+            << "\ttotal cores = " << result.NumCores << std::endl;
+  bench::PrintInterval(result);
+  bench::PrintRanks(result);
+  return result;
+}
+
+}
+
+// Median time of every ranks x threads configuration, per total number of
+// cores, so that e.g. a rank per core can be compared to a rank per socket
+// running a thread per core
+static void PrintHybridTable(const std::vector<bench::Result>& results)
+{
+  std::map<int, std::vector<const bench::Result*> > byCores;
+  for(std::size_t i=0; i < results.size(); ++i)
+    {
+    if(!results[i].Samples.empty() && !results[i].Ranks.empty())
+      {
+      byCores[results[i].NumCores].push_back(&results[i]);
+      }
+    }
+
+  std::cout << "Hybrid \'VTK-m MPI Isosurface\' results:\n";
+  typedef std::map<int, std::vector<const bench::Result*> >::const_iterator CoreIterator;
+  for(CoreIterator i = byCores.begin(); i != byCores.end(); ++i)
+    {
+    double best = 0.0;
+    for(std::size_t j=0; j < i->second.size(); ++j)
+      {
+      const double median = bench::Median(i->second[j]->Samples);
+      best = (j == 0) ? median : std::min(best, median);
+      }
+    for(std::size_t j=0; j < i->second.size(); ++j)
+      {
+      const bench::Result& result = *i->second[j];
+      const int numRanks = static_cast<int>(result.Ranks.size());
+      const double median = bench::Median(result.Samples);
+      std::cout << "\tcores = " << i->first
+                << "\tranks x threads = " << numRanks << "x" << (result.NumCores / numRanks)
+                << "\t" << result.Name
+                << "\tmedian = " << median << "s"
+                << ((median == best) ? "\tfastest" : "") << "\n";
+      }
+    }
+  std::cout.flush();
+}
+
+// Compare the cost balanced split of the volume to the equal one, at every
+// number of threads per rank both were run with
+static void PrintBalance(const std::vector<bench::Result>& equal,
+                         const std::vector<bench::Result>& balanced,
+                         double estimateTime,
+                         double equalEstimate,
+                         double balancedEstimate)
+{
+  if(equal.empty() || balanced.empty())
+    {
+    return;
+    }
+
+  std::cout << "Balance \'" << equal.front().Name << "\' results:\n"
+            << "\testimate time = " << estimateTime << "s\n"
+            << "\testimated imbalance = " << equalEstimate << " equal, "
+            << balancedEstimate << " balanced\n";
+  for(std::size_t i=0; i < equal.size() && i < balanced.size(); ++i)
+    {
+    const int numRanks = static_cast<int>(equal[i].Ranks.size());
+    const double equalMedian = bench::Median(equal[i].Samples);
+    const double balancedMedian = bench::Median(balanced[i].Samples);
+    std::cout << "\tthreads per rank = " << (equal[i].NumCores / numRanks)
+              << "\timbalance = " << bench::RankImbalance(equal[i]) << " equal, "
+              << bench::RankImbalance(balanced[i]) << " balanced"
+              << "\tmedian = " << equalMedian << "s equal, " << balancedMedian << "s balanced"
+              << "\tspeedup = " << ((balancedMedian > 0.0) ? equalMedian / balancedMedian : 0.0)
+              << "\n";
+    }
+  std::cout.flush();
+}
+
+// Read the slab of every rank of comm and print how long the slowest took.
+// Returns false on every rank when any of them failed.
+static bool LoadRankSlabs(const bench::NrrdHeader& header, vtkm::Id zBegin,
+                          vtkm::Id numCellsZ, MPI_Comm comm,
+                          mpi::detail::RankState& state)
+{
+  int rank = 0;
+  int numRanks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &numRanks);
+
+  std::string error;
+  int ok = mpi::detail::ReadRankSlab(header, zBegin, numCellsZ, state, error) ? 1 : 0;
+  if(!ok)
+    {
+    std::cerr << "rank " << rank << ": " << error << std::endl;
+    }
+  MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+
+  double slowestRead = 0.0;
+  MPI_Reduce(&state.ReadTime, &slowestRead, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  if(rank == 0)
+    {
+    std::cout << "Load \'" << header.DataFile << "\' results:\n"
+              << "\tranks = " << numRanks << "\n"
+              << "\tslowest rank read time = " << slowestRead << "s" << std::endl;
+    }
+  return ok != 0;
+}
+
+// Benchmark the slabs the ranks of comm hold at every number of threads per
+// rank. The results are only filled on rank 0, which also reports them.
+static std::vector<bench::Result> RunThreadSweep(mpi::detail::RankState& state,
+                                                 MPI_Comm comm,
+                                                 const std::vector<int>& threadCounts,
+                                                 float isoValue,
+                                                 bool balanced,
+                                                 const bench::RunnerOptions& options,
+                                                 bench::ScalingTable& scaling,
+                                                 bench::ResultsSink& results)
+{
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+
+  std::vector<bench::Result> sweep;
+  for(std::size_t t=0; t < threadCounts.size(); ++t)
+    {
+    bench::Result result = mpi::RunIsoSurfaceUniformGrid(state, comm, threadCounts[t],
+                                                         isoValue, balanced, options);
+    if(rank == 0)
+      {
+      scaling.Add(result);
+      results.Write(result);
+      sweep.push_back(result);
+      }
+    }
+  return sweep;
+}
+
+// Sweep the VTK-m isosurface over every number of ranks in --ranks, out of
+// the ranks mpirun launched, and every number of threads per rank given by
+// --cores. maxNumCores is the number of cores of a node: the threads of
+// the ranks sharing a node are bounded so they don't oversubscribe it.
+// Each rank gets an equal number of cells along z, and with --balance the
+// sweep is repeated with the layers of cells split by estimated cost.
+int RunMPIComparison(const vtkm::testing::ArgumentsParser& parser, int maxNumCores)
+{
+  int worldRank = 0;
+  int worldSize = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+  MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+  const bool root = (worldRank == 0);
+
+  const std::string file = parser.file();
+  const float isoValue = parser.isovalue();
+  bench::NrrdHeader header;
+  std::string error;
+  long long payloadOffset = 0;
+  if(!header.Read(file, error) ||
+     !bench::LocateNrrdPayload(header, payloadOffset, error) ||
+     header.Type != "float")
+    {
+    if(root)
+      {
+      std::cerr << "unable to read " << file << ": "
+                << (error.empty() ? "only float volumes are supported" : error) << std::endl;
+      }
+    return 1;
+    }
+  const vtkm::Id cellsZ = header.Sizes[2] - 1;
+
+  bench::RunInfo info;
+  info.File = file;
+  info.Device = "MPI+TBB";
+  info.IsoValue = isoValue;
+  info.Host = bench::HostName();
+  info.StartTime = bench::UtcTimeStamp();
+  for(int i=0; i < 3; ++i)
+    {
+    info.Dimensions[i] = static_cast<int>(header.Sizes[i]);
+    }
+
+  bench::ResultsSink results;
+  if(root && !parser.resultsFile().empty() && !results.Open(parser.resultsFile(), info))
+    {
+    return 1;
+    }
+
+  bench::RunnerOptions options;
+  if(parser.trials() > 0)
+    {
+    options.NumTrials = parser.trials();
+    }
+  options.Device = info.Device;
+
+  std::vector<int> rankCounts = parser.rankCounts();
+  if(rankCounts.empty())
+    {
+    rankCounts.push_back(worldSize);
+    }
+
+  //ranks sharing a node with this one
+  MPI_Comm node;
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, worldRank, MPI_INFO_NULL, &node);
+
+  if(root)
+    {
+    std::cout << "data dims are: " << header.Sizes[0] << ", " << header.Sizes[1]
+              << ", " << header.Sizes[2] << "\n"
+              << "ranks launched = " << worldSize << std::endl;
+    }
+
+  bench::ScalingTable scaling;
+  std::vector<bench::Result> all;
+  int status = 0;
+  for(std::size_t c=0; c < rankCounts.size(); ++c)
+    {
+    const int numRanks = rankCounts[c];
+    if(numRanks < 1 || numRanks > worldSize)
+      {
+      if(root)
+        {
+        std::cerr << "skipping " << numRanks << " ranks, "
+                  << worldSize << " were launched" << std::endl;
+        }
+      continue;
+      }
+
+    //bound the threads of a rank by the cores of its node over the ranks
+    //of this configuration on it, the tightest node decides for everyone
+    const int active = (worldRank < numRanks) ? 1 : 0;
+    int activeOnNode = 0;
+    MPI_Allreduce(&active, &activeOnNode, 1, MPI_INT, MPI_SUM, node);
+    int maxThreads = std::max(1, maxNumCores / std::max(1, activeOnNode));
+    MPI_Allreduce(MPI_IN_PLACE, &maxThreads, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    const std::vector<int> threadCounts = bench::CoreCounts(parser.cores(), maxThreads);
+
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, active ? 0 : MPI_UNDEFINED, worldRank, &comm);
+    if(comm != MPI_COMM_NULL)
+      {
+      std::vector<bench::Result> equal;
+      std::vector<double> layerCosts;
+      double estimateTime = 0.0;
+      {
+      mpi::detail::RankState state;
+      vtkm::Id zBegin = 0;
+      vtkm::Id numCellsZ = 0;
+      mpi::detail::RankSlab(cellsZ, worldRank, numRanks, zBegin, numCellsZ);
+      if(LoadRankSlabs(header, zBegin, numCellsZ, comm, state))
+        {
+        equal = RunThreadSweep(state, comm, threadCounts, isoValue, false,
+                               options, scaling, results);
+        all.insert(all.end(), equal.begin(), equal.end());
+
+        if(parser.balance() && numRanks > 1)
+          {
+          //every rank estimates its own layers, then they all get the
+          //estimate of the whole volume
+          vtkm::cont::Timer<> timer;
+          const std::vector<double> local =
+            mpi::detail::EstimateLayerCosts(state, header, isoValue);
+          std::vector<int> counts(numRanks, 0);
+          std::vector<int> displacements(numRanks, 0);
+          for(int r=0; r < numRanks; ++r)
+            {
+            vtkm::Id begin = 0;
+            vtkm::Id count = 0;
+            mpi::detail::RankSlab(cellsZ, r, numRanks, begin, count);
+            counts[r] = static_cast<int>(count);
+            displacements[r] = static_cast<int>(begin);
+            }
+          layerCosts.resize(static_cast<std::size_t>(cellsZ));
+          MPI_Allgatherv(local.empty() ? NULL : const_cast<double*>(&local[0]),
+                         static_cast<int>(local.size()), MPI_DOUBLE,
+                         &layerCosts[0], &counts[0], &displacements[0], MPI_DOUBLE, comm);
+          estimateTime = timer.GetElapsedTime();
+          MPI_Allreduce(MPI_IN_PLACE, &estimateTime, 1, MPI_DOUBLE, MPI_MAX, comm);
+          }
+        }
+      else
+        {
+        status = 1;
+        }
+      }
+
+      if(!layerCosts.empty())
+        {
+        std::vector<vtkm::Id> equalBegins(numRanks + 1, cellsZ);
+        for(int r=0; r < numRanks; ++r)
+          {
+          vtkm::Id count = 0;
+          mpi::detail::RankSlab(cellsZ, r, numRanks, equalBegins[r], count);
+          }
+        std::vector<vtkm::Id> begins;
+        mpi::detail::BalancedSlabs(layerCosts, numRanks, begins);
+
+        mpi::detail::RankState state;
+        if(LoadRankSlabs(header, begins[worldRank], begins[worldRank + 1] - begins[worldRank],
+                         comm, state))
+          {
+          const std::vector<bench::Result> balanced =
+            RunThreadSweep(state, comm, threadCounts, isoValue, true,
+                           options, scaling, results);
+          all.insert(all.end(), balanced.begin(), balanced.end());
+          if(root)
+            {
+            PrintBalance(equal, balanced, estimateTime,
+                         mpi::detail::CostImbalance(layerCosts, equalBegins),
+                         mpi::detail::CostImbalance(layerCosts, begins));
+            }
+          }
+        else
+          {
+          status = 1;
+          }
+        }
+      MPI_Comm_free(&comm);
+      }
+    mpi::detail::IdleBarrier(MPI_COMM_WORLD);
+    }
+  MPI_Comm_free(&node);
+
+  if(root)
+    {
+    scaling.Print(std::cout);
+    PrintHybridTable(all);
+    }
+  MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  return status;
+}
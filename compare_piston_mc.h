@@ -17,7 +17,17 @@
 #include <piston/marching_cube.h>
 #include <piston/image3d.h>
 
-#include "Stats.h"
+#include <thrust/host_vector.h>
+#include <thrust/iterator/iterator_traits.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+#include "compare_runner.h"
+#include "ContenderRegistry.h"
+#include "saveAsPly.h"
+#include "Volume.h"
 
 namespace piston
 {
@@ -29,9 +39,9 @@ struct piston_scalar_image3d : piston::image3d<thrust::device_system_tag>
   typedef PointDataContainer::iterator PointDataIterator;
 
   piston_scalar_image3d(vtkm::IdComponent xsize, vtkm::IdComponent ysize, vtkm::IdComponent zsize,
-                        const std::vector<vtkm::Float32> &data)
+                        const vtkm::Float32* data)
     : piston::image3d< thrust::device_system_tag >(xsize, ysize, zsize),
-      point_data_vector(data)
+      point_data_vector(data, data + static_cast<std::size_t>(xsize) * ysize * zsize)
   {
     assert(this->NPoints == this->point_data_vector.size());
   }
@@ -44,53 +54,147 @@ struct piston_scalar_image3d : piston::image3d<thrust::device_system_tag>
   }
 };
 
-static void RunIsoSurfaceUniformGrid(const std::vector<vtkm::Float32>& buffer,
+typedef piston::marching_cube< piston_scalar_image3d,
+                               piston_scalar_image3d > MC;
+
+namespace detail
+{
+//copy the piston output vertices to the host so they can be written out
+template<typename Iterator>
+static void CopyVertices(Iterator begin, Iterator end,
+                         vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> >& vertices)
+{
+  typedef typename thrust::iterator_value<Iterator>::type PistonVertexType;
+  thrust::host_vector<PistonVertexType> hostVertices(begin, end);
+
+  vertices.Allocate(static_cast<vtkm::Id>(hostVertices.size()));
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> >::PortalControl portal =
+    vertices.GetPortalControl();
+  for(std::size_t i=0; i < hostVertices.size(); ++i)
+    {
+    const PistonVertexType& v = hostVertices[i];
+    portal.Set(static_cast<vtkm::Id>(i), vtkm::Vec<vtkm::Float32,3>(v.x, v.y, v.z));
+    }
+}
+
+//everything the piston isosurface needs to hold between trials
+struct IsoSurfaceUniformGridState
+{
+  boost::shared_ptr<piston_scalar_image3d> Image;
+  boost::shared_ptr<MC> Marching;
+};
+
+struct IsoSurfaceUniformGridSetup
+{
+  IsoSurfaceUniformGridSetup(IsoSurfaceUniformGridState& state,
+                             const bench::Volume& input,
+                             vtkImageData* image,
+                             float isoValue):
+    State(state),
+    Input(input),
+    Image(image),
+    IsoValue(isoValue)
+    {
+    }
+
+  void operator()()
+  {
+    int dims[3];
+    this->Image->GetDimensions(dims);
+
+    //piston only contours float, other scalar types are widened on the way
+    //into the copy of the volume it makes anyway
+    std::vector<vtkm::Float32> widened;
+    const vtkm::Float32* values = this->Input.GetValues<vtkm::Float32>();
+    if(!values)
+      {
+      this->Input.GetValuesAsFloat32(widened);
+      values = widened.empty() ? NULL : &widened[0];
+      }
+    this->State.Image.reset(
+      new piston_scalar_image3d(dims[0],dims[1],dims[2],values));
+    this->State.Marching.reset(
+      new MC(*this->State.Image,*this->State.Image,this->IsoValue));
+  }
+
+  IsoSurfaceUniformGridState& State;
+  const bench::Volume& Input;
+  vtkImageData* Image;
+  float IsoValue;
+};
+
+struct IsoSurfaceUniformGridKernel
+{
+  IsoSurfaceUniformGridKernel(IsoSurfaceUniformGridState& state,
+                              float isoValue):
+    State(state),
+    IsoValue(isoValue)
+    {
+    }
+
+  vtkm::Id operator()(int)
+  {
+    MC& marching = *this->State.Marching;
+    marching.set_isovalue(this->IsoValue);
+    marching();
+    return marching.num_total_vertices / 3;
+  }
+
+  IsoSurfaceUniformGridState& State;
+  float IsoValue;
+};
+}
+
+static bench::Result RunIsoSurfaceUniformGrid(const bench::Volume& input,
                                      vtkImageData* image,
                                      const std::string& device,
                                      int numCores,
                                      int maxNumCores,
                                      float isoValue,
-                                     int MAX_NUM_TRIALS)
+                                     const bench::RunnerOptions& options)
 {
+  detail::IsoSurfaceUniformGridState state;
+  detail::IsoSurfaceUniformGridSetup setup(state, input, image, isoValue);
+  detail::IsoSurfaceUniformGridKernel kernel(state, isoValue);
+
+  bench::Result result =
+    bench::RunBenchmark("Piston Isosurface", numCores, setup, kernel, options);
+  bench::SetField<vtkm::Float32>(result, input.GetNumberOfValues());
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty())
+    {
+    vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > verticesArray;
+    detail::CopyVertices(state.Marching->vertices_begin(),
+                         state.Marching->vertices_end(),
+                         verticesArray);
+    saveAsPly(verticesArray, dumpPath);
+    }
+  return result;
+}
 
-  int dims[3];
-  image->GetDimensions(dims);
-
-  typedef piston::marching_cube< piston_scalar_image3d,
-                                 piston_scalar_image3d > MC;
-  
-  piston_scalar_image3d pimage(dims[0],dims[1],dims[2],buffer);
-  MC marching(pimage,pimage,isoValue);
-
-  vtkm::cont::Timer<> timer;
-  std::vector<double> samples;
-  samples.reserve(MAX_NUM_TRIALS);
-  timer.Reset();
+// The Piston isosurface as a contender of compare, named piston. It is
+// only registered when compare_contenders.h includes this header, which
+// it does when built with Piston.
+class IsoSurfaceContender : public bench::Contender
+{
+public:
+  IsoSurfaceContender(): bench::Contender("piston", bench::DEVICE_ANY) {}
 
-  for(int i=0; i < MAX_NUM_TRIALS; ++i)
+  virtual bool Accepts(const bench::ContenderContext& context) const
   {
-    //piston_scalar_image3d pimage(dims[0],dims[1],dims[2],buffer);
-    //MC marching(pimage,pimage,isoValue);
-    marching.set_isovalue(isoValue);
-    marching();
-
-    std::cout << isoValue << " " << marching.num_total_vertices << std::endl;
-    isoValue += 0.005;
+    return context.Input == bench::INPUT_VOLUME &&
+           context.Pipeline == bench::PIPELINE_MARCHING_CUBES;
   }
 
-  samples.push_back(timer.GetElapsedTime());
-
-  std::sort(samples.begin(), samples.end());
-  stats::Winsorize(samples, 5.0);
-  std::cout << "Benchmark \'Piston Isosurface\' results:\n"
-        << "\tmedian = " << stats::PercentileValue(samples, 50.0) << "s\n"
-        << "\tmedian abs dev = " << stats::MedianAbsDeviation(samples) << "s\n"
-        << "\tmean = " << stats::Mean(samples) << "s\n"
-        << "\tstd dev = " << stats::StandardDeviation(samples) << "s\n"
-        << "\tmin = " << samples.front() << "s\n"
-        << "\tmax = " << samples.back() << "s\n"
-        << "\t# of runs = " << samples.size() << "\n";
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunIsoSurfaceUniformGrid(*context.Volume, context.Image, context.Device,
+                                               context.NumCores, context.MaxNumCores,
+                                               context.IsoValue, *context.Options));
+  }
+};
 
-}
+static bench::ContenderRegistration IsoSurfaceRegistration(new IsoSurfaceContender);
 
 }
@@ -0,0 +1,169 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+
+#include <vtkm/cont/ArrayHandle.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <iostream>
+#include <vector>
+
+#include "compare_runner.h"
+#include "ContenderRegistry.h"
+#include "RooflineIsosurfaceUniformGrid.h"
+#include "saveAsPly.h"
+#include "ScalarTypes.h"
+#include "Volume.h"
+
+namespace roofline
+{
+namespace detail
+{
+
+template<typename FieldType, bool GenerateNormals>
+struct IsoSurfaceUniformGridState
+{
+  typedef bench::RooflineIsosurfaceUniformGrid<FieldType, GenerateNormals> FilterType;
+
+  boost::shared_ptr<FilterType> Filter;
+  std::vector< vtkm::Vec<vtkm::Float32,3> > Vertices;
+  std::vector< vtkm::Vec<vtkm::Float32,3> > Normals;
+  vtkm::Id NumVertices;
+};
+
+template<typename FieldType, bool GenerateNormals>
+struct IsoSurfaceUniformGridSetup
+{
+  typedef IsoSurfaceUniformGridState<FieldType, GenerateNormals> StateType;
+
+  IsoSurfaceUniformGridSetup(StateType& state,
+                             const bench::Volume& input):
+    State(state),
+    Input(input)
+    {
+    }
+
+  void operator()()
+  {
+    int dims[3];
+    this->Input.GetDimensions(dims);
+
+    //reads the memory of the input volume in place
+    this->State.Filter.reset(new typename StateType::FilterType(
+      this->Input.template GetValues<FieldType>(), vtkm::Id3(dims[0], dims[1], dims[2])));
+    this->State.NumVertices = 0;
+  }
+
+  StateType& State;
+  const bench::Volume& Input;
+};
+
+template<typename FieldType, bool GenerateNormals>
+struct IsoSurfaceUniformGridKernel
+{
+  typedef IsoSurfaceUniformGridState<FieldType, GenerateNormals> StateType;
+
+  IsoSurfaceUniformGridKernel(StateType& state,
+                              float isoValue):
+    State(state),
+    IsoValue(isoValue)
+    {
+    }
+
+  vtkm::Id operator()(int)
+  {
+    this->State.NumVertices =
+      this->State.Filter->Run(this->IsoValue,
+                              this->State.Vertices, this->State.Normals);
+    return this->State.NumVertices / 3;
+  }
+
+  StateType& State;
+  float IsoValue;
+};
+
+}
+
+// The roofline isosurface of a volume stored as FieldType, see
+// bench::RooflineIsosurfaceUniformGrid. Without normals it is the bound of
+// the classification and the interpolation of the points alone.
+template<typename FieldType, bool GenerateNormals>
+static bench::Result RunIsoSurfaceUniformGrid(const bench::Volume& input,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     float isoValue,
+                                     const bench::RunnerOptions& options)
+{
+  detail::IsoSurfaceUniformGridState<FieldType, GenerateNormals> state;
+  detail::IsoSurfaceUniformGridSetup<FieldType, GenerateNormals> setup(state, input);
+  detail::IsoSurfaceUniformGridKernel<FieldType, GenerateNormals> kernel(state, isoValue);
+
+  bench::Result result =
+    bench::RunBenchmark(GenerateNormals ? "Roofline Isosurface" : "Roofline Isosurface Points",
+                        numCores, setup, kernel, options);
+  bench::SetField<FieldType>(result, input.GetNumberOfValues());
+  std::cout << "Roofline \'" << result.Name << "\' results:\n"
+            << "\tclassification = "
+            << bench::roofline::ClassifyPathName(state.Filter->GetClassifyPath()) << std::endl;
+
+  const vtkm::Id numVertices = state.NumVertices;
+  result.OutputBytes = numVertices * (GenerateNormals ? 2 : 1) * sizeof(vtkm::Vec<vtkm::Float32,3>);
+  bench::PrintOutputSize(result.Name, numVertices, numVertices / 3, result.OutputBytes);
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty() && numVertices > 0)
+    {
+    vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > vertices =
+      vtkm::cont::make_ArrayHandle(&state.Vertices[0], numVertices);
+    saveAsPly(vertices, dumpPath);
+    }
+  return result;
+}
+
+// The roofline isosurface as a contender of compare, named roofline. It
+// runs on the CPU threads of the Serial and TBB devices only.
+class IsoSurfaceContender : public bench::Contender
+{
+public:
+  IsoSurfaceContender(): bench::Contender("roofline", bench::DEVICE_SERIAL | bench::DEVICE_TBB) {}
+
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return context.Input == bench::INPUT_VOLUME &&
+           context.Pipeline == bench::PIPELINE_MARCHING_CUBES;
+  }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    bench::RunInScalarType<IsoSurfaceContender>(context, collector);
+  }
+
+  template<typename FieldType>
+  static void RunTyped(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunIsoSurfaceUniformGrid<FieldType, true>(*context.Volume, context.Device,
+                                                                context.NumCores, context.MaxNumCores,
+                                                                context.IsoValue, *context.Options));
+    collector.Collect(RunIsoSurfaceUniformGrid<FieldType, false>(*context.Volume, context.Device,
+                                                                 context.NumCores, context.MaxNumCores,
+                                                                 context.IsoValue, *context.Options));
+  }
+};
+
+static bench::ContenderRegistration IsoSurfaceRegistration(new IsoSurfaceContender);
+
+}
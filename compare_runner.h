@@ -0,0 +1,838 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __compare_runner_h
+#define __compare_runner_h
+
+#include <vtkm/Types.h>
+#include <vtkm/cont/Timer.h>
+
+#include <vtkm/cont/DeviceAdapterSerial.h>
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+#include <vtkm/cont/tbb/DeviceAdapterTBB.h>
+#include <tbb/task_arena.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <map>
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include "MemoryUsage.h"
+#include "PerfCounters.h"
+#include "PhaseTrace.h"
+#include "ScalarTypes.h"
+#include "Stats.h"
+
+namespace bench
+{
+
+// Device adapter to use for parallel work on host memory, e.g. serializing
+// output. It is the TBB adapter in the TBB build and serial otherwise, as
+// the Cuda adapter can't touch host buffers.
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+typedef vtkm::cont::DeviceAdapterTagTBB HostDeviceAdapterTag;
+#else
+typedef vtkm::cont::DeviceAdapterTagSerial HostDeviceAdapterTag;
+#endif
+
+// Runs work on at most numCores threads of the device adapter. The TBB
+// backend runs it in a task arena of numCores slots, the calling thread
+// taking one of them. An arena has the concurrency it was created with
+// whatever the process did with TBB before, unlike a task_scheduler_init,
+// which is ignored once the default scheduler of the thread exists. The
+// other backends run the work on the calling thread, there is nothing to
+// limit.
+class CoreLimit
+{
+public:
+  explicit CoreLimit(int numCores):
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+    Arena(numCores),
+#endif
+    NumCores(numCores)
+    {
+    }
+
+  int GetNumberOfCores() const
+    { return this->NumCores; }
+
+  // Call functor() within the limit. Under TBB the concurrency of the
+  // arena it runs in is checked against the core count first, and a
+  // mismatch is reported on stderr, as every result of the work would be
+  // recorded at the wrong core count.
+  template<typename Functor>
+  void Execute(Functor& functor)
+  {
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+    CheckedCall<Functor> call(functor, this->NumCores);
+    this->Arena.execute(call);
+#else
+    functor();
+#endif
+  }
+
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+  tbb::task_arena& GetArena()
+    { return this->Arena; }
+#endif
+
+private:
+  CoreLimit(const CoreLimit&);
+  void operator=(const CoreLimit&);
+
+#if VTKM_DEVICE_ADAPTER == VTKM_DEVICE_ADAPTER_TBB
+  template<typename Functor>
+  struct CheckedCall
+  {
+    CheckedCall(Functor& functor, int numCores):
+      Call(functor),
+      NumCores(numCores)
+      {
+      }
+
+    void operator()()
+    {
+      const int concurrency = tbb::this_task_arena::max_concurrency();
+      if(concurrency != this->NumCores)
+        {
+        std::cerr << "warning: asked for " << this->NumCores << " cores but TBB runs "
+                  << concurrency << " threads" << std::endl;
+        }
+      this->Call();
+    }
+
+    Functor& Call;
+    int NumCores;
+  };
+
+  tbb::task_arena Arena;
+#endif
+  int NumCores;
+};
+
+// Expand the --cores argument into the list of core counts to benchmark.
+//  0 means all cores, -1 means every count from 1 to maxNumCores
+static std::vector<int> CoreCounts(int targetNumCores, int maxNumCores)
+{
+  std::vector<int> counts;
+  if(targetNumCores == -1)
+    {
+    for(int i=1; i <= maxNumCores; ++i)
+      {
+      counts.push_back(i);
+      }
+    }
+  else if(targetNumCores <= 0)
+    {
+    counts.push_back(maxNumCores);
+    }
+  else
+    {
+    counts.push_back(targetNumCores);
+    }
+  return counts;
+}
+
+struct RunnerOptions
+{
+  RunnerOptions():
+    NumWarmups(2),
+    NumTrials(10),
+    Device(""),
+    DumpDirectory(""),
+    Counters(false),
+    TargetPrecision(0.0),
+    TimeBudget(60.0),
+    MaxTrials(1000),
+    PhaseNote("")
+    {
+    }
+
+  //number of untimed runs of the kernel before sampling starts
+  int NumWarmups;
+  //number of timed runs of the kernel, each one is a separate sample. The
+  //least number of them when TargetPrecision is set
+  int NumTrials;
+  //name of the device adapter the benchmarks run on
+  std::string Device;
+  //folder the output of each contender is written to, empty to not write
+  std::string DumpDirectory;
+  //count hardware events around each timed trial, see PerfCounters
+  bool Counters;
+  //when above 0, keep running trials until the half width of the 95%
+  //confidence interval of the median is at most this percent of the
+  //median, TimeBudget seconds were spent in trials or MaxTrials were run
+  double TargetPrecision;
+  double TimeBudget;
+  int MaxTrials;
+  //why the phases of the benchmark can't be broken down any further,
+  //empty when they are. Goes into its report and results
+  std::string PhaseNote;
+};
+
+// Path of the file the output of a contender is dumped to, made from the
+// contender name, the device and the number of cores so that runs don't
+// overwrite each other. Empty when dumping is disabled.
+static std::string DumpPath(const RunnerOptions& options,
+                            const std::string& name,
+                            int numCores)
+{
+  if(options.DumpDirectory.empty())
+    {
+    return std::string();
+    }
+
+  std::string fileName = name + "_" + options.Device;
+  for(std::size_t i=0; i < fileName.size(); ++i)
+    {
+    if(!std::isalnum(static_cast<unsigned char>(fileName[i])))
+      {
+      fileName[i] = '_';
+      }
+    }
+
+  std::ostringstream path;
+  path << options.DumpDirectory << "/" << fileName << "_" << numCores << ".ply";
+  return path.str();
+}
+
+// Time an MPI rank spent contouring its part of the volume on every timed
+// trial, and then waiting at the barrier for the slowest rank
+struct RankTimes
+{
+  RankTimes():
+    Rank(0)
+    {
+    }
+
+  int Rank;
+  std::vector<double> Compute;
+  std::vector<double> Barrier;
+};
+
+//samples and triangle counts of each timed trial of a single benchmark run
+struct Result
+{
+  Result():
+    NumCores(0),
+    OutputBytes(0),
+    FieldBytes(0)
+    {
+    this->MedianInterval.low = 0.0;
+    this->MedianInterval.high = 0.0;
+    }
+
+  std::string Name;
+  int NumCores;
+  std::vector<double> Samples;
+  std::vector<vtkm::Id> NumTriangles;
+  //bootstrapped 95% confidence interval of the median of the samples and
+  //why sampling stopped
+  stats::ConfidenceInterval MedianInterval;
+  std::string StopReason;
+  //bytes of the arrays holding the output of the last trial, 0 if unknown
+  long long OutputBytes;
+  //scalar type of the field the contender contoured and the bytes of it
+  //a trial reads, empty and 0 when the contender reads no stored field
+  std::string ScalarType;
+  long long FieldBytes;
+
+  //memory used by setup and by each timed trial
+  PhaseMemory SetupMemory;
+  std::vector<PhaseMemory> TrialMemory;
+  //hardware counters of each timed trial, empty unless they were asked for
+  //and the machine has them
+  std::vector<TrialCounters> Counters;
+  //time of each phase the contender recorded in every timed trial, empty
+  //unless the phase trace is enabled, and why they aren't broken down
+  //further when they can't be
+  std::vector<PhaseBreakdown> Phases;
+  std::string PhaseNote;
+  //split of every trial per MPI rank, empty outside of the MPI driver.
+  //NumCores is then the number of ranks times the threads of each
+  std::vector<RankTimes> Ranks;
+  //memory released once the contender is done with its state, measured
+  //by EndTeardown from the end of the last trial on
+  PhaseMemory TeardownMemory;
+  MemoryProbe TeardownProbe;
+};
+
+//measure the teardown of a contender, to call once it has returned
+static void EndTeardown(Result& result)
+{
+  result.TeardownMemory = result.TeardownProbe.End();
+}
+
+//record that every trial of result reads numValues values of type T
+template<typename T>
+static void SetField(Result& result, vtkm::Id numValues)
+{
+  result.ScalarType = ScalarTraits<T>::Name();
+  result.FieldBytes = static_cast<long long>(numValues) * static_cast<long long>(sizeof(T));
+}
+
+//highest resident set size during the setup and the timed trials
+static long long BenchmarkPeakResidentBytes(const Result& result)
+{
+  long long peak = result.SetupMemory.PeakResidentBytes;
+  for(std::size_t i=0; i < result.TrialMemory.size(); ++i)
+    {
+    peak = std::max(peak, result.TrialMemory[i].PeakResidentBytes);
+    }
+  return peak;
+}
+
+//print the size of the output a contender produced on its last trial
+static void PrintOutputSize(const std::string& name, vtkm::Id numPoints,
+                            vtkm::Id numTriangles, long long bytes)
+{
+  std::cout << "Output \'" << name << "\' results:\n"
+            << "\tpoints = " << numPoints << "\n"
+            << "\ttriangles = " << numTriangles << "\n"
+            << "\tbytes = " << bytes << std::endl;
+}
+
+//median of a set of samples that do not need to be sorted
+static double Median(std::vector<double> samples)
+{
+  std::sort(samples.begin(), samples.end());
+  return stats::PercentileValue(samples, 50.0);
+}
+
+//GB/s of the field a trial reads at the median trial time, 0 if unknown
+static double FieldBandwidth(const Result& result)
+{
+  const double median = result.Samples.empty() ? 0.0 : Median(result.Samples);
+  return (median > 0.0) ? (static_cast<double>(result.FieldBytes) / median) / 1.0e9 : 0.0;
+}
+
+// Print how fast a contender consumes its field. The bandwidth compares
+// the scalar types of a volume by what they cost in memory traffic, the
+// value rate by the work done, which is the same whatever the type.
+static void PrintFieldThroughput(const Result& result)
+{
+  const std::size_t valueSize = ScalarTypeSize(ScalarTypeFromNrrd(result.ScalarType));
+  if(result.FieldBytes <= 0 || valueSize == 0)
+    {
+    return;
+    }
+  const double median = result.Samples.empty() ? 0.0 : Median(result.Samples);
+  const double numValues = static_cast<double>(result.FieldBytes) / static_cast<double>(valueSize);
+  std::cout << "Throughput \'" << result.Name << "\' results:\n"
+            << "\tscalar type = " << result.ScalarType << "\n"
+            << "\tfield bytes per trial = " << result.FieldBytes << "\n"
+            << "\tfield bandwidth = " << FieldBandwidth(result) << "GB/s\n"
+            << "\tvalue rate = " << ((median > 0.0) ? (numValues / median) / 1.0e6 : 0.0)
+            << "Mvalues/s" << std::endl;
+}
+
+// Collects the median time of each algorithm at every core count it was
+// run with, so that strong scaling numbers can be derived once a sweep is
+// done. Speedup and parallel efficiency are relative to the smallest core
+// count that the algorithm was run with.
+class ScalingTable
+{
+public:
+  void Add(const Result& result)
+  {
+    if(!result.Samples.empty())
+      {
+      this->Medians[result.Name][result.NumCores] = Median(result.Samples);
+      }
+  }
+
+  void Print(std::ostream& out) const
+  {
+    typedef std::map<std::string, std::map<int,double> >::const_iterator AlgIterator;
+    typedef std::map<int,double>::const_iterator CoreIterator;
+    for(AlgIterator alg = this->Medians.begin(); alg != this->Medians.end(); ++alg)
+      {
+      const std::map<int,double>& medians = alg->second;
+      const int baseCores = medians.begin()->first;
+      const double baseTime = medians.begin()->second;
+
+      out << "Scaling \'" << alg->first << "\' results:\n";
+      for(CoreIterator i = medians.begin(); i != medians.end(); ++i)
+        {
+        const double speedup = baseTime / i->second;
+        const double efficiency = speedup * baseCores / i->first;
+        out << "\tcores = " << i->first
+            << "\tmedian = " << i->second << "s"
+            << "\tspeedup = " << speedup
+            << "\tefficiency = " << (efficiency * 100.0) << "%\n";
+        }
+      }
+    out.flush();
+  }
+
+  // Scaling a socket at a time: the median at every core count that is a
+  // whole number of sockets of coresPerSocket cores, against one socket.
+  // Only meaningful when threads are pinned so that a socket is filled
+  // before the next is used. Algorithms the sweep didn't run on a whole
+  // socket are left out.
+  void PrintPerSocket(std::ostream& out, int coresPerSocket) const
+  {
+    typedef std::map<std::string, std::map<int,double> >::const_iterator AlgIterator;
+    typedef std::map<int,double>::const_iterator CoreIterator;
+    for(AlgIterator alg = this->Medians.begin(); alg != this->Medians.end(); ++alg)
+      {
+      const std::map<int,double>& medians = alg->second;
+      const CoreIterator base = medians.find(coresPerSocket);
+      if(coresPerSocket < 1 || base == medians.end())
+        {
+        continue;
+        }
+
+      out << "Socket scaling \'" << alg->first << "\' results:\n";
+      for(CoreIterator i = base; i != medians.end(); ++i)
+        {
+        if(i->first % coresPerSocket != 0)
+          {
+          continue;
+          }
+        const int sockets = i->first / coresPerSocket;
+        const double speedup = base->second / i->second;
+        out << "\tsockets = " << sockets
+            << "\tcores = " << i->first
+            << "\tmedian = " << i->second << "s"
+            << "\tspeedup = " << speedup
+            << "\tefficiency = " << (speedup / sockets * 100.0) << "%\n";
+        }
+      }
+    out.flush();
+  }
+
+private:
+  std::map<std::string, std::map<int,double> > Medians;
+};
+
+//statistics of a set of per trial samples, after a 5% winsorization
+struct Summary
+{
+  Summary():
+    Median(0.0), MedianAbsDev(0.0), Mean(0.0), StdDev(0.0),
+    Min(0.0), Max(0.0), NumSamples(0)
+    {
+    }
+
+  double Median;
+  double MedianAbsDev;
+  double Mean;
+  double StdDev;
+  double Min;
+  double Max;
+  std::size_t NumSamples;
+};
+
+static Summary Summarize(std::vector<double> samples)
+{
+  Summary summary;
+  if(samples.empty())
+    {
+    return summary;
+    }
+
+  std::sort(samples.begin(), samples.end());
+  stats::Winsorize(samples, 5.0);
+  summary.Median = stats::PercentileValue(samples, 50.0);
+  summary.MedianAbsDev = stats::MedianAbsDeviation(samples);
+  summary.Mean = stats::Mean(samples);
+  summary.StdDev = stats::StandardDeviation(samples);
+  summary.Min = samples.front();
+  summary.Max = samples.back();
+  summary.NumSamples = samples.size();
+  return summary;
+}
+
+//print the standard summary block for a set of per trial samples
+static void PrintSummary(const std::string& name, const std::vector<double>& samples)
+{
+  if(samples.empty())
+    {
+    std::cout << "Benchmark \'" << name << "\' has no samples" << std::endl;
+    return;
+    }
+
+  const Summary summary = Summarize(samples);
+  std::cout << "Benchmark \'" << name << "\' results:\n"
+        << "\tmedian = " << summary.Median << "s\n"
+        << "\tmedian abs dev = " << summary.MedianAbsDev << "s\n"
+        << "\tmean = " << summary.Mean << "s\n"
+        << "\tstd dev = " << summary.StdDev << "s\n"
+        << "\tmin = " << summary.Min << "s\n"
+        << "\tmax = " << summary.Max << "s\n"
+        << "\t# of runs = " << summary.NumSamples << "\n";
+}
+
+// Print the median time of every phase a contender recorded and its share
+// of the median trial time, then note when it isn't empty. Nested phases
+// are indented under the ones they ran in, so their times are part of
+// their parent's.
+static void PrintPhases(const Result& result)
+{
+  if(result.Phases.empty() || result.Samples.empty())
+    {
+    return;
+    }
+
+  const double trialMedian = Median(result.Samples);
+  std::cout << "Phases \'" << result.Name << "\' results:\n";
+  for(std::size_t i=0; i < result.Phases.size(); ++i)
+    {
+    const PhaseBreakdown& phase = result.Phases[i];
+    const double median = Median(phase.Samples);
+    std::cout << "\t" << std::string(2 * phase.Depth, ' ') << phase.Name
+              << " = " << median << "s ("
+              << ((trialMedian > 0.0) ? 100.0 * median / trialMedian : 0.0) << "%)\n";
+    }
+  if(!result.PhaseNote.empty())
+    {
+    std::cout << "\t(" << result.PhaseNote << ")\n";
+    }
+  std::cout.flush();
+}
+
+// Load imbalance of the MPI ranks: the median over the trials of the
+// slowest rank's compute time over the mean one. 1 is a perfect balance,
+// the trial time is that many times what it would be if the work was
+// evenly spread. 0 when there are no ranks.
+static double RankImbalance(const Result& result)
+{
+  if(result.Ranks.empty())
+    {
+    return 0.0;
+    }
+
+  std::vector<double> imbalances;
+  for(std::size_t i=0; i < result.Ranks[0].Compute.size(); ++i)
+    {
+    double slowest = 0.0;
+    double sum = 0.0;
+    for(std::size_t r=0; r < result.Ranks.size(); ++r)
+      {
+      const double compute = result.Ranks[r].Compute[i];
+      slowest = std::max(slowest, compute);
+      sum += compute;
+      }
+    const double mean = sum / static_cast<double>(result.Ranks.size());
+    imbalances.push_back((mean > 0.0) ? slowest / mean : 1.0);
+    }
+  return imbalances.empty() ? 0.0 : Median(imbalances);
+}
+
+// Print the median compute and barrier time of every MPI rank. Ranks that
+// wait long at the barrier finished their part early, so the spread of the
+// compute times is what load imbalance costs.
+static void PrintRanks(const Result& result)
+{
+  if(result.Ranks.empty())
+    {
+    return;
+    }
+
+  const int numRanks = static_cast<int>(result.Ranks.size());
+  std::cout << "Ranks \'" << result.Name << "\' results:\n"
+            << "\tranks = " << numRanks << "\n"
+            << "\tthreads per rank = " << (result.NumCores / numRanks) << "\n"
+            << "\timbalance (max/mean compute) = " << RankImbalance(result) << "\n";
+  for(std::size_t i=0; i < result.Ranks.size(); ++i)
+    {
+    const RankTimes& rank = result.Ranks[i];
+    const double compute = Median(rank.Compute);
+    const double barrier = Median(rank.Barrier);
+    const double total = compute + barrier;
+    std::cout << "\trank " << rank.Rank << ": compute = " << compute << "s"
+              << "\tbarrier = " << barrier << "s ("
+              << ((total > 0.0) ? 100.0 * barrier / total : 0.0) << "%)\n";
+    }
+  std::cout.flush();
+}
+
+//confidence level of Result::MedianInterval, in percent
+static const double MEDIAN_CONFIDENCE = 95.0;
+
+//print the confidence interval of the median and why sampling stopped
+static void PrintInterval(const Result& result)
+{
+  if(result.Samples.empty())
+    {
+    return;
+    }
+  const double median = Median(result.Samples);
+  std::cout << "\tmedian " << MEDIAN_CONFIDENCE << "% CI = ["
+            << result.MedianInterval.low << "s, " << result.MedianInterval.high << "s] (+/- "
+            << stats::RelativeHalfWidth(result.MedianInterval, median) << "%)\n"
+            << "\tstopped after " << result.Samples.size() << " trials: "
+            << result.StopReason << std::endl;
+}
+
+//print how much memory setup and the timed trials used
+static void PrintMemory(const Result& result)
+{
+  std::vector<double> allocated;
+  long long peakHeap = 0;
+  for(std::size_t i=0; i < result.TrialMemory.size(); ++i)
+    {
+    allocated.push_back(static_cast<double>(result.TrialMemory[i].AllocatedBytes));
+    peakHeap = std::max(peakHeap, result.TrialMemory[i].PeakHeapBytes);
+    }
+
+  std::cout << "Memory \'" << result.Name << "\' results:\n"
+            << "\tsetup resident memory added = " << ToMegaBytes(result.SetupMemory.ResidentDelta) << "MB\n"
+            << "\tpeak resident memory = " << ToMegaBytes(BenchmarkPeakResidentBytes(result)) << "MB\n";
+  if(AllocationCountingEnabled())
+    {
+    std::cout << "\tsetup allocated = " << ToMegaBytes(result.SetupMemory.AllocatedBytes) << "MB in "
+              << result.SetupMemory.AllocationCalls << " calls\n"
+              << "\tmedian trial allocated = "
+              << ToMegaBytes(static_cast<long long>(allocated.empty() ? 0.0 : Median(allocated))) << "MB\n"
+              << "\tpeak trial heap in use = " << ToMegaBytes(peakHeap) << "MB\n";
+    }
+  std::cout.flush();
+}
+
+//median over the trials of a metric derived from their counters
+template<typename MetricFunctor>
+static double MedianCounterMetric(const Result& result, MetricFunctor metric)
+{
+  std::vector<double> values;
+  for(std::size_t i=0; i < result.Counters.size(); ++i)
+    {
+    const long long triangles = (i < result.NumTriangles.size()) ? result.NumTriangles[i] : 0;
+    values.push_back(metric(result.Counters[i].Total, triangles));
+    }
+  return values.empty() ? 0.0 : Median(values);
+}
+
+struct InstructionsPerCycle
+{
+  double operator()(const CounterValues& values, long long) const
+    { return values.IPC(); }
+};
+
+struct CountPerTriangle
+{
+  explicit CountPerTriangle(int counter): Counter(counter) {}
+  double operator()(const CounterValues& values, long long triangles) const
+    { return values.PerTriangle(this->Counter, triangles); }
+  int Counter;
+};
+
+struct StalledCycleRatio
+{
+  double operator()(const CounterValues& values, long long) const
+    { return values.Ratio(COUNTER_STALLED_CYCLES, COUNTER_CYCLES); }
+};
+
+// Print the median of the counters of every trial with the derived IPC and
+// misses per output triangle, then what each thread counted on the median
+// trial. A low IPC with many stalled cycles and LLC misses points to a
+// memory bound kernel, a high IPC to a compute bound one.
+static void PrintCounters(const Result& result)
+{
+  if(result.Counters.empty())
+    {
+    return;
+    }
+
+  std::cout << "Counters \'" << result.Name << "\' results:\n";
+  const CounterValues& first = result.Counters.front().Total;
+  for(int c=0; c < NUM_COUNTERS; ++c)
+    {
+    std::vector<double> counts;
+    for(std::size_t i=0; i < result.Counters.size(); ++i)
+      {
+      counts.push_back(static_cast<double>(result.Counters[i].Total.Counts[c]));
+      }
+    std::cout << "\tmedian " << CounterName(c) << " = ";
+    if(first.Valid[c])
+      {
+      std::cout << static_cast<long long>(Median(counts)) << "\n";
+      }
+    else
+      {
+      std::cout << "n/a\n";
+      }
+    }
+  std::cout << "\tmedian IPC = " << MedianCounterMetric(result, InstructionsPerCycle()) << "\n"
+            << "\tmedian llc misses per triangle = "
+            << MedianCounterMetric(result, CountPerTriangle(COUNTER_LLC_MISSES)) << "\n"
+            << "\tmedian branch misses per triangle = "
+            << MedianCounterMetric(result, CountPerTriangle(COUNTER_BRANCH_MISSES)) << "\n"
+            << "\tmedian stalled cycle ratio = "
+            << MedianCounterMetric(result, StalledCycleRatio()) << "\n";
+
+  //the trial whose time is the median one
+  std::vector<std::pair<double,std::size_t> > order;
+  for(std::size_t i=0; i < result.Samples.size() && i < result.Counters.size(); ++i)
+    {
+    order.push_back(std::make_pair(result.Samples[i], i));
+    }
+  std::sort(order.begin(), order.end());
+  const TrialCounters& median = result.Counters[order[order.size() / 2].second];
+  for(std::size_t t=0; t < median.Threads.size(); ++t)
+    {
+    const ThreadCounters& thread = median.Threads[t];
+    if(thread.Values.Counts[COUNTER_CYCLES] == 0)
+      {
+      continue;
+      }
+    std::cout << "\tthread " << thread.ThreadId
+              << ": cycles = " << thread.Values.Counts[COUNTER_CYCLES]
+              << "\tinstructions = " << thread.Values.Counts[COUNTER_INSTRUCTIONS]
+              << "\tIPC = " << thread.Values.IPC() << "\n";
+    }
+  std::cout.flush();
+}
+
+// Runs a benchmark made of two callables:
+//  - setup() is invoked once and is never timed
+//  - kernel(trial) does the work of a single trial and returns the number
+//    of triangles it produced, which is reported next to the trial time
+// The kernel is first run options.NumWarmups times to populate caches and
+// lazily allocated buffers, after which each of the options.NumTrials runs
+// is timed on its own. All console output happens outside of the timed
+// region. The raw per trial samples are returned in the order they were
+// taken. With options.TargetPrecision set, trials go on past
+// options.NumTrials until the bootstrapped confidence interval of the
+// median is narrow enough or the time budget runs out, so short kernels
+// get many samples and long ones stop as soon as more would not tell
+// anything new. numCores is the core count the caller has limited the device to
+// and is only recorded in the result. Memory is sampled around setup and
+// around each timed trial, outside of the timed region. With
+// options.Counters the hardware counters of every thread are read around
+// each timed trial as well, the events are only opened and read outside of
+// the timed region.
+template<typename SetupFunctor, typename KernelFunctor>
+Result RunBenchmark(const std::string& name,
+                    int numCores,
+                    SetupFunctor& setup,
+                    KernelFunctor& kernel,
+                    const RunnerOptions& options)
+{
+  Result result;
+  MemoryProbe probe;
+  probe.Begin();
+  setup();
+  result.SetupMemory = probe.End();
+
+  for(int i=0; i < options.NumWarmups; ++i)
+    {
+    kernel(0);
+    }
+
+  PerfCounters counters;
+  std::string counterError;
+  const bool counting = options.Counters && counters.Initialize(counterError);
+
+  std::vector<double> samples;
+  std::vector<vtkm::Id> numTriangles;
+  samples.reserve(options.NumTrials);
+  numTriangles.reserve(options.NumTrials);
+
+  const bool adaptive = options.TargetPrecision > 0.0;
+  const int maxTrials = adaptive ? std::max(options.NumTrials, options.MaxTrials) :
+                                   options.NumTrials;
+  result.StopReason = adaptive ? "trial limit reached" : "fixed number of trials";
+
+  int nextCheck = std::max(options.NumTrials, 2);
+  const std::string trialPhase = name + " trial";
+  const bool tracing = PhaseTrace::IsEnabled();
+
+  vtkm::cont::Timer<> budgetTimer;
+  vtkm::cont::Timer<> timer;
+  for(int i=0; i < maxTrials; ++i)
+    {
+    probe.Begin();
+    if(counting)
+      {
+      counters.Start();
+      }
+    PhaseTrace::Begin(trialPhase);
+    const std::size_t firstPhase = tracing ? PhaseTrace::GetNumberOfEvents() : 0;
+    timer.Reset();
+    const vtkm::Id triangles = kernel(i);
+    samples.push_back(timer.GetElapsedTime());
+    PhaseTrace::End();
+    if(counting)
+      {
+      result.Counters.push_back(counters.Stop());
+      }
+    if(tracing)
+      {
+      AddTrialPhases(result.Phases, samples.size() - 1, firstPhase);
+      }
+    result.TrialMemory.push_back(probe.End());
+    numTriangles.push_back(triangles);
+
+    //the interval is checked every 10% more samples, so that
+    //bootstrapping doesn't take longer than the trials
+    if(adaptive && static_cast<int>(samples.size()) >= nextCheck)
+      {
+      nextCheck += std::max(1, nextCheck / 10);
+      result.MedianInterval = stats::BootstrapMedianInterval(samples, MEDIAN_CONFIDENCE);
+      if(stats::RelativeHalfWidth(result.MedianInterval, Median(samples)) <=
+         options.TargetPrecision)
+        {
+        result.StopReason = "target precision reached";
+        break;
+        }
+      if(budgetTimer.GetElapsedTime() >= options.TimeBudget)
+        {
+        result.StopReason = "time budget spent";
+        break;
+        }
+      }
+    }
+  result.MedianInterval = stats::BootstrapMedianInterval(samples, MEDIAN_CONFIDENCE);
+  //phases that didn't run on every trial took no time on the others
+  for(std::size_t i=0; i < result.Phases.size(); ++i)
+    {
+    result.Phases[i].Samples.resize(samples.size(), 0.0);
+    }
+  if(!result.Phases.empty())
+    {
+    result.PhaseNote = options.PhaseNote;
+    }
+
+  for(std::size_t i=0; i < samples.size(); ++i)
+    {
+    std::cout << name << " cores " << numCores << " trial " << i << ": "
+              << samples[i] << "s, " << numTriangles[i] << " triangles"
+              << std::endl;
+    }
+
+  PrintSummary(name, samples);
+
+  result.Name = name;
+  result.NumCores = numCores;
+  result.Samples.swap(samples);
+  result.NumTriangles.swap(numTriangles);
+  PrintInterval(result);
+  PrintMemory(result);
+  PrintCounters(result);
+  PrintPhases(result);
+
+  result.TeardownProbe.Begin();
+  return result;
+}
+
+}
+
+#endif
@@ -16,67 +16,274 @@
 
 #include <vtkMarchingCubes.h>
 #include <vtkImageData.h>
+#include <vtkVersionMacros.h>
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
 #include <vtkTrivialProducer.h>
 #include <vtkNonMergingPointLocator.h>
+#include <vtkCellArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
 
-#include <vtkm/cont/Timer.h>
+//vtkFlyingEdges3D, threaded with vtkSMPTools, is new in VTK 7
+#if VTK_MAJOR_VERSION >= 7
+#include <vtkFlyingEdges3D.h>
+#include <vtkSMP.h>
+#include <vtkSMPTools.h>
+#define BENCHMARK_VTK_FLYING_EDGES
+#endif
+
+#include <iostream>
+
+#include "compare_runner.h"
+#include "ContenderRegistry.h"
+#include "saveAsPly.h"
+#include "Volume.h"
 
 namespace vtk
 {
-static void RunImageMarchingCubes( vtkImageData* image,
+namespace detail
+{
+struct ImageMarchingCubesSetup
+{
+  ImageMarchingCubesSetup(vtkTrivialProducer* producer,
+                          vtkMarchingCubes* marchingCubes):
+    Producer(producer),
+    MarchingCubes(marchingCubes)
+    {
+    }
+
+  void operator()()
+  {
+    this->Producer->Update();
+
+    this->MarchingCubes->SetInputConnection(this->Producer->GetOutputPort());
+
+    vtkNonMergingPointLocator* simpleLocator = vtkNonMergingPointLocator::New();
+    this->MarchingCubes->SetLocator(simpleLocator);
+    simpleLocator->Delete();
+
+    this->MarchingCubes->ComputeGradientsOff();
+    this->MarchingCubes->ComputeNormalsOn();
+    this->MarchingCubes->ComputeScalarsOff();
+    this->MarchingCubes->SetNumberOfContours(1);
+  }
+
+  vtkTrivialProducer* Producer;
+  vtkMarchingCubes* MarchingCubes;
+};
+
+#ifdef BENCHMARK_VTK_FLYING_EDGES
+struct ImageFlyingEdgesSetup
+{
+  ImageFlyingEdgesSetup(vtkTrivialProducer* producer,
+                        vtkFlyingEdges3D* flyingEdges,
+                        int numCores):
+    Producer(producer),
+    FlyingEdges(flyingEdges),
+    NumCores(numCores)
+    {
+    }
+
+  void operator()()
+  {
+    //with the TBB backend the filter runs in the arena of CoreLimit, which
+    //bounds it to this core count whatever scheduler this leaves behind
+    vtkSMPTools::Initialize(this->NumCores);
+    this->Producer->Update();
+
+    this->FlyingEdges->SetInputConnection(this->Producer->GetOutputPort());
+    this->FlyingEdges->ComputeGradientsOff();
+    this->FlyingEdges->ComputeNormalsOn();
+    this->FlyingEdges->ComputeScalarsOff();
+    this->FlyingEdges->SetNumberOfContours(1);
+  }
+
+  vtkTrivialProducer* Producer;
+  vtkFlyingEdges3D* FlyingEdges;
+  int NumCores;
+};
+#endif
+
+//contours with any VTK contour filter taking a single value
+template<typename FilterType>
+struct ImageContourKernel
+{
+  ImageContourKernel(FilterType* filter, float isoValue):
+    Filter(filter),
+    IsoValue(isoValue)
+    {
+    }
+
+  vtkm::Id operator()(int)
+  {
+    this->Filter->SetValue(0, this->IsoValue);
+    //force re-execution, every trial is at the same isovalue and would
+    //otherwise be skipped by the pipeline
+    this->Filter->Modified();
+    this->Filter->Update();
+    return this->Filter->GetOutput()->GetNumberOfPolys();
+  }
+
+  FilterType* Filter;
+  float IsoValue;
+};
+
+//what the VTK isosurfaces report of their input, and their dump
+static void FinishImageContour(bench::Result& result,
+                               vtkImageData* image,
+                               vtkPolyData* output,
+                               int numCores,
+                               const bench::RunnerOptions& options)
+{
+  //the VTK contour filters are templated over the scalar type themselves
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  if(scalars)
+    {
+    result.ScalarType = bench::ScalarTypeName(bench::ScalarTypeFromVTK(scalars->GetDataType()));
+    result.FieldBytes = static_cast<long long>(scalars->GetNumberOfTuples()) *
+                        scalars->GetDataTypeSize();
+    }
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty())
+    {
+    const vtkm::Vec<vtkm::Float32,3>* points =
+      static_cast<const vtkm::Vec<vtkm::Float32,3>*>(output->GetPoints()->GetVoidPointer(0));
+    vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > pointsArray =
+      vtkm::cont::make_ArrayHandle(points, output->GetNumberOfPoints());
+
+    //legacy cell arrays store each triangle as (3, id0, id1, id2)
+    const vtkIdType* cells = output->GetPolys()->GetPointer();
+    saveAsPly(pointsArray, cells + 1, output->GetNumberOfPolys(), 4, dumpPath);
+    }
+}
+}
+
+static bench::Result RunImageMarchingCubes( vtkImageData* image,
+                                   const std::string& device,
+                                   int numCores,
+                                   int maxNumCores,
+                                   float isoValue,
+                                   const bench::RunnerOptions& options)
+{
+  vtkNew<vtkTrivialProducer> producer;
+  producer->SetOutput(image);
+
+  vtkNew<vtkMarchingCubes> marchingCubes;
+
+  detail::ImageMarchingCubesSetup setup(producer.GetPointer(),
+                                        marchingCubes.GetPointer());
+  detail::ImageContourKernel<vtkMarchingCubes> kernel(marchingCubes.GetPointer(), isoValue);
+
+  bench::Result result =
+    bench::RunBenchmark("VTK Isosurface", numCores, setup, kernel, options);
+  detail::FinishImageContour(result, image, marchingCubes->GetOutput(), numCores, options);
+  return result;
+}
+
+#ifdef BENCHMARK_VTK_FLYING_EDGES
+//the vtkSMPTools backend VTK was built with
+static const char* SMPBackendName()
+{
+#if defined(VTK_SMP_TBB)
+  return "TBB";
+#elif defined(VTK_SMP_OpenMP)
+  return "OpenMP";
+#elif defined(VTK_SMP_Sequential)
+  return "Sequential";
+#else
+  return "unknown";
+#endif
+}
+
+// vtkFlyingEdges3D, the threaded isosurface of VTK, on numCores threads of
+// the vtkSMPTools backend VTK was built with
+static bench::Result RunImageFlyingEdges( vtkImageData* image,
                                    const std::string& device,
                                    int numCores,
                                    int maxNumCores,
                                    float isoValue,
-                                   int MAX_NUM_TRIALS)
+                                   const bench::RunnerOptions& options)
 {
   vtkNew<vtkTrivialProducer> producer;
   producer->SetOutput(image);
-  producer->Update();
 
-  vtkm::cont::Timer<> timer;
-  std::vector<double> samples;
-  samples.reserve(MAX_NUM_TRIALS);
+  vtkNew<vtkFlyingEdges3D> flyingEdges;
 
-  vtkNew<vtkMarchingCubes> syncTemplates;
-  syncTemplates->SetInputConnection(producer->GetOutputPort());
+  detail::ImageFlyingEdgesSetup setup(producer.GetPointer(),
+                                      flyingEdges.GetPointer(),
+                                      numCores);
+  detail::ImageContourKernel<vtkFlyingEdges3D> kernel(flyingEdges.GetPointer(), isoValue);
+
+  bench::Result result =
+    bench::RunBenchmark("VTK Flying Edges", numCores, setup, kernel, options);
+  std::cout << "VTK \'" << result.Name << "\' results:\n"
+            << "\tvtkSMPTools backend = " << SMPBackendName() << std::endl;
+  detail::FinishImageContour(result, image, flyingEdges->GetOutput(), numCores, options);
+  return result;
+}
+#endif
 
-  vtkNonMergingPointLocator* simpleLocator = vtkNonMergingPointLocator::New();
-  syncTemplates->SetLocator(simpleLocator);
+// vtkMarchingCubes as a contender of compare, named vtk
+class ImageMarchingCubesContender : public bench::Contender
+{
+public:
+  ImageMarchingCubesContender(): bench::Contender("vtk", bench::DEVICE_ANY) {}
+
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return context.Input == bench::INPUT_VOLUME &&
+           context.Pipeline == bench::PIPELINE_MARCHING_CUBES;
+  }
 
-  syncTemplates->ComputeGradientsOff();
-  syncTemplates->ComputeNormalsOn();
-  syncTemplates->ComputeScalarsOff();
-  syncTemplates->SetNumberOfContours(1);
+  //vtkMarchingCubes doesn't use more than one thread
+  virtual bool IsSerial() const
+    { return true; }
 
-  timer.Reset();
-    
-  for(int i=0; i < MAX_NUM_TRIALS; ++i)
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
   {
-    syncTemplates->SetValue(0, isoValue);
-    syncTemplates->Update();
+    collector.Collect(RunImageMarchingCubes(context.Image, context.Device,
+                                            context.NumCores, context.MaxNumCores,
+                                            context.IsoValue, *context.Options));
+  }
+};
 
-    vtkPolyData* output = syncTemplates->GetOutput();
-    std::cout << (syncTemplates->GetValue(0)) << " " << output->GetNumberOfPoints() << std::endl;
+#ifdef BENCHMARK_VTK_FLYING_EDGES
+// vtkFlyingEdges3D as a contender of compare, also named vtk. Unlike
+// vtkMarchingCubes it is threaded, so it takes part in the core sweep. It
+// runs on the TBB device only, the one whose core limit bounds the TBB
+// backend of vtkSMPTools as well.
+class ImageFlyingEdgesContender : public bench::Contender
+{
+public:
+  ImageFlyingEdgesContender(): bench::Contender("vtk", bench::DEVICE_TBB) {}
 
-    isoValue += 0.005f;
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return context.Input == bench::INPUT_VOLUME &&
+           context.Pipeline == bench::PIPELINE_MARCHING_CUBES;
   }
 
-  samples.push_back(timer.GetElapsedTime());
+#ifdef VTK_SMP_Sequential
+  //vtkSMPTools runs everything on the calling thread
+  virtual bool IsSerial() const
+    { return true; }
+#endif
 
-  std::sort(samples.begin(), samples.end());
-  stats::Winsorize(samples, 5.0);
-  std::cout << "Benchmark \'VTK Isosurface\' results:\n"
-        << "\tmedian = " << stats::PercentileValue(samples, 50.0) << "s\n"
-        << "\tmedian abs dev = " << stats::MedianAbsDeviation(samples) << "s\n"
-        << "\tmean = " << stats::Mean(samples) << "s\n"
-        << "\tstd dev = " << stats::StandardDeviation(samples) << "s\n"
-        << "\tmin = " << samples.front() << "s\n"
-        << "\tmax = " << samples.back() << "s\n"
-        << "\t# of runs = " << samples.size() << "\n";
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunImageFlyingEdges(context.Image, context.Device,
+                                          context.NumCores, context.MaxNumCores,
+                                          context.IsoValue, *context.Options));
+  }
+};
+#endif
 
-}
+static bench::ContenderRegistration ImageMarchingCubesRegistration(new ImageMarchingCubesContender);
+#ifdef BENCHMARK_VTK_FLYING_EDGES
+static bench::ContenderRegistration ImageFlyingEdgesRegistration(new ImageFlyingEdgesContender);
+#endif
 
 }
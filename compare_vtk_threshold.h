@@ -0,0 +1,148 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+
+#include <vtkDataObject.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkThreshold.h>
+#include <vtkTrivialProducer.h>
+#include <vtkUnstructuredGrid.h>
+
+#include <iostream>
+
+#include "compare_runner.h"
+#include "ContenderRegistry.h"
+#include "Volume.h"
+
+namespace vtk
+{
+namespace detail
+{
+struct ThresholdSetup
+{
+  ThresholdSetup(vtkTrivialProducer* producer,
+                 vtkThreshold* threshold):
+    Producer(producer),
+    Threshold(threshold)
+    {
+    }
+
+  void operator()()
+  {
+    this->Producer->Update();
+
+    this->Threshold->SetInputConnection(this->Producer->GetOutputPort());
+    this->Threshold->SetInputArrayToProcess(0, 0, 0,
+                                            vtkDataObject::FIELD_ASSOCIATION_POINTS,
+                                            "nodevar");
+    //a cell is kept when all of its points are in range, like the VTK-m one
+    this->Threshold->AllScalarsOn();
+  }
+
+  vtkTrivialProducer* Producer;
+  vtkThreshold* Threshold;
+};
+
+struct ThresholdKernel
+{
+  ThresholdKernel(vtkThreshold* threshold, float isoValue):
+    Threshold(threshold),
+    IsoValue(isoValue)
+    {
+    }
+
+  vtkm::Id operator()(int)
+  {
+    this->Threshold->ThresholdByUpper(this->IsoValue);
+    //force re-execution, every trial is at the same isovalue and would
+    //otherwise be skipped by the pipeline
+    this->Threshold->Modified();
+    this->Threshold->Update();
+    return this->Threshold->GetOutput()->GetNumberOfCells();
+  }
+
+  vtkThreshold* Threshold;
+  float IsoValue;
+};
+}
+
+// vtkThreshold keeping the cells whose point values are all at or above
+// isoValue. It runs as a single call, so unlike the VTK-m threshold it has
+// no stages to report. The number of kept cells is reported where the
+// isosurfaces report triangles.
+static bench::Result RunThreshold( vtkImageData* image,
+                                   const std::string& device,
+                                   int numCores,
+                                   int maxNumCores,
+                                   float isoValue,
+                                   const bench::RunnerOptions& options)
+{
+  vtkNew<vtkTrivialProducer> producer;
+  producer->SetOutput(image);
+
+  vtkNew<vtkThreshold> threshold;
+
+  detail::ThresholdSetup setup(producer.GetPointer(), threshold.GetPointer());
+  detail::ThresholdKernel kernel(threshold.GetPointer(), isoValue);
+
+  bench::Result result =
+    bench::RunBenchmark("VTK Threshold", numCores, setup, kernel, options);
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  if(scalars)
+    {
+    result.ScalarType = bench::ScalarTypeName(bench::ScalarTypeFromVTK(scalars->GetDataType()));
+    result.FieldBytes = static_cast<long long>(scalars->GetNumberOfTuples()) *
+                        scalars->GetDataTypeSize();
+    }
+
+  //the unstructured grid copies the points and point data it uses
+  vtkUnstructuredGrid* output = threshold->GetOutput();
+  result.OutputBytes = static_cast<long long>(output->GetActualMemorySize()) * 1024;
+  std::cout << "Output \'" << result.Name << "\' results:\n"
+            << "\tcells = " << output->GetNumberOfCells() << "\n"
+            << "\tpoints = " << output->GetNumberOfPoints() << "\n"
+            << "\tbytes = " << result.OutputBytes << std::endl;
+  return result;
+}
+
+// vtkThreshold as a contender of compare, named vtk
+class ThresholdContender : public bench::Contender
+{
+public:
+  ThresholdContender(): bench::Contender("vtk", bench::DEVICE_ANY) {}
+
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return context.Input == bench::INPUT_VOLUME &&
+           context.Pipeline == bench::PIPELINE_THRESHOLD;
+  }
+
+  //vtkThreshold doesn't use more than one thread
+  virtual bool IsSerial() const
+    { return true; }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunThreshold(context.Image, context.Device,
+                                   context.NumCores, context.MaxNumCores,
+                                   context.IsoValue, *context.Options));
+  }
+};
+
+static bench::ContenderRegistration ThresholdRegistration(new ThresholdContender);
+
+}
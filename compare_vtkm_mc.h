@@ -15,91 +15,1278 @@
 //=============================================================================
 
 #include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/cont/ArrayHandleImplicit.h>
 #include <vtkm/cont/ArrayHandleUniformPointCoordinates.h>
+#include <vtkm/cont/ArrayPortalToIterators.h>
 #include <vtkm/cont/CellSetStructured.h>
 #include <vtkm/cont/DataSet.h>
 #include <vtkm/cont/Timer.h>
+#include <vtkm/exec/FunctorBase.h>
 
 #include <vtkm/worklet/IsosurfaceUniformGrid.h>
 
 #include <vtkImageData.h>
 
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <sstream>
 #include <vector>
 
-#include "Stats.h"
+#include "BatchIsosurfaceUniformGrid.h"
+#include "BrickRangeIndex.h"
+#include "compare_runner.h"
+#include "ContenderRegistry.h"
+#include "FlyingEdgesUniformGrid.h"
+#include "MemoryUsage.h"
+#include "NrrdReader.h"
+#include "PhaseTrace.h"
+#include "saveAsPly.h"
+#include "ScalarTypes.h"
+#include "SyntheticField.h"
+#include "Volume.h"
+#include "WeldedIsosurfaceUniformGrid.h"
 
 namespace vtkm
 {
-static void RunIsoSurfaceUniformGrid(const std::vector<vtkm::Float32>& buffer,
-                                     vtkImageData* image,
-                                     const std::string& device,
-                                     int numCores,
-                                     int maxNumCores,
-                                     float isoValue,
-                                     int MAX_NUM_TRIALS)
+namespace detail
+{
+typedef VTKM_DEFAULT_DEVICE_ADAPTER_TAG DeviceAdapter;
+typedef vtkm::cont::DeviceAdapterAlgorithm<DeviceAdapter> Algorithm;
+typedef vtkm::worklet::IsosurfaceFilterUniformGrid<vtkm::Float32,
+                                                   DeviceAdapter> IsosurfaceFilter;
+
+// Reads a field stored as FieldType through the execution portal of its
+// ArrayHandle and converts each value to the ComputeType of FieldType when
+// it is read. Backs an implicit array, so the VTK-m isosurface, which
+// takes its field type as the type it computes in, contours uint8 and
+// uint16 volumes in float without a widened copy of them, on any device.
+template<typename FieldType>
+class WidenedField
+{
+public:
+  typedef typename bench::ScalarTraits<FieldType>::ComputeType ValueType;
+  typedef typename vtkm::cont::ArrayHandle<FieldType>::template ExecutionTypes<DeviceAdapter>::PortalConst PortalType;
+
+  VTKM_EXEC_CONT_EXPORT
+  WidenedField() {}
+
+  VTKM_CONT_EXPORT
+  explicit WidenedField(const PortalType& values):
+    Values(values)
+    {
+    }
+
+  VTKM_EXEC_CONT_EXPORT
+  ValueType operator()(vtkm::Id index) const
+  {
+    return static_cast<ValueType>(this->Values.Get(index));
+  }
+
+private:
+  PortalType Values;
+};
+
+// The array the VTK-m isosurface reads a field stored as FieldType
+// through: the ArrayHandle itself when FieldType is what it computes in,
+// a WidenedField otherwise. Make transfers the values to the device, the
+// ArrayHandle has to outlive the array it returns.
+template<typename FieldType>
+struct ComputeField
 {
+  typedef typename bench::ScalarTraits<FieldType>::ComputeType ComputeType;
+  typedef vtkm::cont::ArrayHandleImplicit<ComputeType, WidenedField<FieldType> > HandleType;
 
-  typedef VTKM_DEFAULT_DEVICE_ADAPTER_TAG DeviceAdapter;
+  static HandleType Make(const vtkm::cont::ArrayHandle<FieldType>& values)
+  {
+    return vtkm::cont::make_ArrayHandleImplicit<ComputeType>(
+             WidenedField<FieldType>(values.PrepareForInput(DeviceAdapter())),
+             values.GetNumberOfValues());
+  }
+};
 
-  int dims[3];
-  image->GetDimensions(dims);
+template<>
+struct ComputeField<vtkm::Float32>
+{
+  typedef vtkm::cont::ArrayHandle<vtkm::Float32> HandleType;
+  static HandleType Make(const HandleType& values) { return values; }
+};
 
-  const vtkm::Id3 pointDims(dims[0], dims[1], dims[2]);
-  const vtkm::Id3 cellDims(dims[0]-1, dims[1]-1, dims[2]-1);
+template<>
+struct ComputeField<vtkm::Float64>
+{
+  typedef vtkm::cont::ArrayHandle<vtkm::Float64> HandleType;
+  static HandleType Make(const HandleType& values) { return values; }
+};
 
-  vtkm::cont::ArrayHandleUniformPointCoordinates coordinates(pointDims);
+//add the coordinates and cells of a uniform grid of pointDims points,
+//with unit spacing from origin on
+static void BuildUniformDataSet(vtkm::cont::DataSet& dataSet,
+                                const vtkm::Id3& pointDims,
+                                const vtkm::Vec<vtkm::FloatDefault,3>& origin =
+                                  vtkm::Vec<vtkm::FloatDefault,3>(0.0f))
+{
+  vtkm::cont::ArrayHandleUniformPointCoordinates coordinates(pointDims, origin);
 
   vtkm::cont::CellSetStructured<3> cellSet("cells");
   cellSet.SetPointDimensions(pointDims);
 
-  vtkm::cont::DataSet dataSet;
-
   dataSet.AddCellSet(cellSet);
   dataSet.AddCoordinateSystem(
           vtkm::cont::CoordinateSystem("coordinates", 1, coordinates));
+}
+
+//everything the VTK-m isosurface needs to hold between trials, for a
+//volume stored as FieldType
+template<typename FieldType>
+struct IsoSurfaceUniformGridState
+{
+  typedef typename bench::ScalarTraits<FieldType>::ComputeType ComputeType;
+  typedef vtkm::worklet::IsosurfaceFilterUniformGrid<ComputeType,
+                                                     DeviceAdapter> FilterType;
+
+  vtkm::cont::DataSet DataSet;
+  //the values as stored and the array the filter reads them through
+  vtkm::cont::ArrayHandle<FieldType> Values;
+  typename ComputeField<FieldType>::HandleType Field;
+  vtkm::cont::ArrayHandle< ComputeType > ScalarsArray;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > VerticesArray;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > NormalsArray;
+  boost::shared_ptr<FilterType> Filter;
+};
+
+template<typename FieldType>
+struct IsoSurfaceUniformGridSetup
+{
+  typedef IsoSurfaceUniformGridState<FieldType> StateType;
+
+  IsoSurfaceUniformGridSetup(StateType& state,
+                             const bench::Volume& input,
+                             vtkImageData* image):
+    State(state),
+    Input(input),
+    Image(image)
+    {
+    }
+
+  void operator()()
+  {
+    int dims[3];
+    this->Image->GetDimensions(dims);
 
+    const vtkm::Id3 pointDims(dims[0], dims[1], dims[2]);
+    const vtkm::Id3 cellDims(dims[0]-1, dims[1]-1, dims[2]-1);
+    BuildUniformDataSet(this->State.DataSet, pointDims);
 
-  vtkm::cont::ArrayHandle<vtkm::Float32> field = vtkm::cont::make_ArrayHandle(buffer);
-  dataSet.AddField(vtkm::cont::Field("nodevar", 1, vtkm::cont::Field::ASSOC_POINTS, field));
+    //refers to the memory of the input volume, no copy is made
+    this->State.Values = this->Input.template GetArrayHandle<FieldType>();
+    this->State.Field = ComputeField<FieldType>::Make(this->State.Values);
+    this->State.DataSet.AddField(vtkm::cont::Field("nodevar", 1,
+                                                   vtkm::cont::Field::ASSOC_POINTS,
+                                                   this->State.Values));
 
-  vtkm::cont::ArrayHandle< vtkm::Float32 > scalarsArray;
-  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > verticesArray;
-  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > normalsArray;
+    this->State.Filter.reset(new typename StateType::FilterType(cellDims, this->State.DataSet));
+  }
 
-  vtkm::worklet::IsosurfaceFilterUniformGrid<vtkm::Float32,
-                                               DeviceAdapter> isosurfaceFilter(cellDims, dataSet);
+  StateType& State;
+  const bench::Volume& Input;
+  vtkImageData* Image;
+};
 
-  vtkm::cont::Timer<> timer;
-  std::vector<double> samples;
-  samples.reserve(MAX_NUM_TRIALS);
-  timer.Reset();
+// Runs the filter of a state holding a DataSet, Field, Filter and output
+// arrays like IsoSurfaceUniformGridState, whatever the type of the field
+template<typename StateType>
+struct IsoSurfaceUniformGridKernel
+{
+  IsoSurfaceUniformGridKernel(StateType& state,
+                              float isoValue):
+    State(state),
+    IsoValue(isoValue)
+    {
+    }
 
-  for(int i=0; i<MAX_NUM_TRIALS; ++i)
+  vtkm::Id operator()(int)
   {
-    isosurfaceFilter.Run(isoValue,
-                         field,
-                         verticesArray,
-                         normalsArray,
-                         scalarsArray);
+    //the filter runs its worklets internally, so it is a single phase
+    bench::ScopedDevicePhase<Algorithm> phase("isosurface");
+    this->State.Filter->Run(this->IsoValue,
+                            this->State.Field,
+                            this->State.VerticesArray,
+                            this->State.NormalsArray,
+                            this->State.ScalarsArray);
+    return this->State.VerticesArray.GetNumberOfValues() / 3;
+  }
+
+  StateType& State;
+  float IsoValue;
+};
+
+// Same as IsoSurfaceUniformGridState, for a field computed on access
+// instead of read from memory. The DataSet holds no field, the filter is
+// handed the implicit array directly.
+struct ImplicitIsoSurfaceUniformGridState
+{
+  explicit ImplicitIsoSurfaceUniformGridState(const bench::SyntheticField& field):
+    Field(bench::MakeSyntheticFieldHandle(field))
+    {
+    }
+
+  vtkm::cont::DataSet DataSet;
+  bench::SyntheticFieldHandle Field;
+  vtkm::cont::ArrayHandle< vtkm::Float32 > ScalarsArray;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > VerticesArray;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > NormalsArray;
+  boost::shared_ptr<IsosurfaceFilter> Filter;
+};
+
+struct ImplicitIsoSurfaceUniformGridSetup
+{
+  ImplicitIsoSurfaceUniformGridSetup(ImplicitIsoSurfaceUniformGridState& state,
+                                     const bench::SyntheticField& field):
+    State(state),
+    Field(field)
+    {
+    }
 
-    std::cout << isoValue << " " << verticesArray.GetNumberOfValues() << std::endl;
-    isoValue += 0.005f;
+  void operator()()
+  {
+    const vtkm::Id3& pointDims = this->Field.GetDimensions();
+    const vtkm::Id3 cellDims(pointDims[0]-1, pointDims[1]-1, pointDims[2]-1);
+    BuildUniformDataSet(this->State.DataSet, pointDims);
+    this->State.Filter.reset(new IsosurfaceFilter(cellDims, this->State.DataSet));
+  }
+
+  ImplicitIsoSurfaceUniformGridState& State;
+  bench::SyntheticField Field;
+};
+
+//everything the welded VTK-m isosurface needs to hold between trials, also
+//used by the flying edges isosurface which welds its output the same way
+template<typename FieldType,
+         typename FilterType = bench::WeldedIsosurfaceUniformGrid<FieldType, DeviceAdapter> >
+struct WeldedIsoSurfaceUniformGridState
+{
+  typedef FieldType FieldValueType;
+  typedef FilterType WeldedIsosurfaceFilter;
+
+  vtkm::cont::ArrayHandle<FieldType> Field;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > VerticesArray;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > NormalsArray;
+  vtkm::cont::ArrayHandle< vtkm::Id > IndicesArray;
+  boost::shared_ptr<WeldedIsosurfaceFilter> Filter;
+};
+
+template<typename StateType>
+struct WeldedIsoSurfaceUniformGridSetup
+{
+  WeldedIsoSurfaceUniformGridSetup(StateType& state,
+                                   const bench::Volume& input):
+    State(state),
+    Input(input)
+    {
+    }
+
+  void operator()()
+  {
+    int dims[3];
+    this->Input.GetDimensions(dims);
+
+    this->State.Field =
+      this->Input.template GetArrayHandle<typename StateType::FieldValueType>();
+    this->State.Filter.reset(new typename StateType::WeldedIsosurfaceFilter(
+      vtkm::Id3(dims[0], dims[1], dims[2])));
+  }
+
+  StateType& State;
+  const bench::Volume& Input;
+};
+
+template<typename StateType>
+struct WeldedIsoSurfaceUniformGridKernel
+{
+  WeldedIsoSurfaceUniformGridKernel(StateType& state,
+                                    float isoValue):
+    State(state),
+    IsoValue(isoValue)
+    {
+    }
+
+  vtkm::Id operator()(int)
+  {
+    this->State.Filter->Run(this->IsoValue,
+                            this->State.Field,
+                            this->State.VerticesArray,
+                            this->State.NormalsArray,
+                            this->State.IndicesArray);
+    return this->State.IndicesArray.GetNumberOfValues() / 3;
   }
 
-  samples.push_back(timer.GetElapsedTime());
+  StateType& State;
+  float IsoValue;
+};
+
+// The current way of getting several isosurfaces: the filter is run once
+// per isovalue and each isovalue keeps its own output arrays
+template<typename FieldType>
+struct SequentialIsoSurfaceUniformGridState
+{
+  typedef typename bench::ScalarTraits<FieldType>::ComputeType ComputeType;
+
+  IsoSurfaceUniformGridState<FieldType> Single;
+  std::vector< vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > > VerticesArrays;
+  std::vector< vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > > NormalsArrays;
+  std::vector< vtkm::cont::ArrayHandle< ComputeType > > ScalarsArrays;
+};
 
-  std::sort(samples.begin(), samples.end());
-  stats::Winsorize(samples, 5.0);
-  std::cout << "Benchmark \'VTK-m Isosurface\' results:\n"
-        << "\tmedian = " << stats::PercentileValue(samples, 50.0) << "s\n"
-        << "\tmedian abs dev = " << stats::MedianAbsDeviation(samples) << "s\n"
-        << "\tmean = " << stats::Mean(samples) << "s\n"
-        << "\tstd dev = " << stats::StandardDeviation(samples) << "s\n"
-        << "\tmin = " << samples.front() << "s\n"
-        << "\tmax = " << samples.back() << "s\n"
-        << "\t# of runs = " << samples.size() << "\n";
+template<typename FieldType>
+struct SequentialIsoSurfaceUniformGridKernel
+{
+  typedef SequentialIsoSurfaceUniformGridState<FieldType> StateType;
+  typedef typename StateType::ComputeType ComputeType;
+
+  SequentialIsoSurfaceUniformGridKernel(StateType& state,
+                                        const std::vector<float>& isoValues):
+    State(state),
+    IsoValues(isoValues.begin(), isoValues.end())
+    {
+    this->State.VerticesArrays.resize(isoValues.size());
+    this->State.NormalsArrays.resize(isoValues.size());
+    this->State.ScalarsArrays.resize(isoValues.size());
+    }
+
+  vtkm::Id operator()(int)
+  {
+    vtkm::Id numTriangles = 0;
+    for(std::size_t i=0; i < this->IsoValues.size(); ++i)
+      {
+      bench::ScopedDevicePhase<Algorithm> phase("isosurface");
+      this->State.Single.Filter->Run(this->IsoValues[i],
+                                     this->State.Single.Field,
+                                     this->State.VerticesArrays[i],
+                                     this->State.NormalsArrays[i],
+                                     this->State.ScalarsArrays[i]);
+      numTriangles += this->State.VerticesArrays[i].GetNumberOfValues() / 3;
+      }
+    return numTriangles;
+  }
+
+  StateType& State;
+  std::vector<ComputeType> IsoValues;
+};
+
+//everything the batched VTK-m isosurface needs to hold between trials
+template<typename FieldType>
+struct BatchIsoSurfaceUniformGridState
+{
+  typedef bench::BatchIsosurfaceUniformGrid<FieldType,
+                                            DeviceAdapter> BatchIsosurfaceFilter;
+
+  vtkm::cont::ArrayHandle<FieldType> Field;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > VerticesArray;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > NormalsArray;
+  std::vector<vtkm::Id> IsoOffsets;
+  boost::shared_ptr<BatchIsosurfaceFilter> Filter;
+};
+
+template<typename FieldType>
+struct BatchIsoSurfaceUniformGridSetup
+{
+  typedef BatchIsoSurfaceUniformGridState<FieldType> StateType;
+
+  BatchIsoSurfaceUniformGridSetup(StateType& state,
+                                  const bench::Volume& input):
+    State(state),
+    Input(input)
+    {
+    }
+
+  void operator()()
+  {
+    int dims[3];
+    this->Input.GetDimensions(dims);
+
+    this->State.Field = this->Input.template GetArrayHandle<FieldType>();
+    this->State.Filter.reset(new typename StateType::BatchIsosurfaceFilter(
+      vtkm::Id3(dims[0], dims[1], dims[2])));
+  }
+
+  StateType& State;
+  const bench::Volume& Input;
+};
+
+template<typename FieldType>
+struct BatchIsoSurfaceUniformGridKernel
+{
+  typedef BatchIsoSurfaceUniformGridState<FieldType> StateType;
+  typedef typename bench::ScalarTraits<FieldType>::ComputeType ComputeType;
 
+  BatchIsoSurfaceUniformGridKernel(StateType& state,
+                                   const std::vector<float>& isoValues):
+    State(state),
+    IsoValues(isoValues.begin(), isoValues.end())
+    {
+    }
+
+  vtkm::Id operator()(int)
+  {
+    this->State.Filter->Run(this->IsoValues,
+                            this->State.Field,
+                            this->State.VerticesArray,
+                            this->State.NormalsArray,
+                            this->State.IsoOffsets);
+    return this->State.VerticesArray.GetNumberOfValues() / 3;
+  }
+
+  StateType& State;
+  std::vector<ComputeType> IsoValues;
+};
+
+// Everything the brick skipping VTK-m isosurface needs to hold between
+// trials. The query time and number of active bricks are kept per trial,
+// warmups overwrite the entries of trial 0.
+template<typename FieldType>
+struct BrickIsoSurfaceUniformGridState
+{
+  typedef bench::BrickRangeIndex<FieldType, DeviceAdapter> BrickIndex;
+  typedef bench::BatchIsosurfaceUniformGrid<FieldType,
+                                            DeviceAdapter> BatchIsosurfaceFilter;
+
+  BrickIsoSurfaceUniformGridState():
+    BuildTime(0.0)
+    {
+    }
+
+  vtkm::cont::ArrayHandle<FieldType> Field;
+  typename BrickIndex::ActiveBricks Active;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > VerticesArray;
+  vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > NormalsArray;
+  std::vector<vtkm::Id> IsoOffsets;
+  boost::shared_ptr<BrickIndex> Index;
+  boost::shared_ptr<BatchIsosurfaceFilter> Filter;
+  double BuildTime;
+  std::vector<double> QueryTimes;
+  std::vector<vtkm::Id> ActiveBricks;
+};
+
+template<typename FieldType>
+struct BrickIsoSurfaceUniformGridSetup
+{
+  typedef BrickIsoSurfaceUniformGridState<FieldType> StateType;
+
+  BrickIsoSurfaceUniformGridSetup(StateType& state,
+                                  const bench::Volume& input,
+                                  int brickSize):
+    State(state),
+    Input(input),
+    BrickSize(brickSize)
+    {
+    }
+
+  void operator()()
+  {
+    int dims[3];
+    this->Input.GetDimensions(dims);
+    const vtkm::Id3 pointDims(dims[0], dims[1], dims[2]);
+
+    this->State.Field = this->Input.template GetArrayHandle<FieldType>();
+    this->State.Filter.reset(new typename StateType::BatchIsosurfaceFilter(pointDims));
+
+    vtkm::cont::Timer<> timer;
+    this->State.Index.reset(new typename StateType::BrickIndex(pointDims, this->BrickSize));
+    this->State.Index->Build(this->State.Field);
+    this->State.BuildTime = timer.GetElapsedTime();
+  }
+
+  StateType& State;
+  const bench::Volume& Input;
+  int BrickSize;
+};
+
+template<typename FieldType>
+struct BrickIsoSurfaceUniformGridKernel
+{
+  typedef BrickIsoSurfaceUniformGridState<FieldType> StateType;
+  typedef typename bench::ScalarTraits<FieldType>::ComputeType ComputeType;
+
+  BrickIsoSurfaceUniformGridKernel(StateType& state,
+                                   float isoValue):
+    State(state),
+    IsoValue(isoValue)
+    {
+    }
+
+  vtkm::Id operator()(int trial)
+  {
+    const ComputeType isoValue = static_cast<ComputeType>(this->IsoValue);
+
+    vtkm::cont::Timer<> timer;
+    const vtkm::Id activeBricks = this->State.Index->Query(isoValue, this->State.Active);
+    const double queryTime = timer.GetElapsedTime();
+
+    const std::size_t index = static_cast<std::size_t>(trial);
+    if(this->State.QueryTimes.size() <= index)
+      {
+      this->State.QueryTimes.resize(index + 1);
+      this->State.ActiveBricks.resize(index + 1);
+      }
+    this->State.QueryTimes[index] = queryTime;
+    this->State.ActiveBricks[index] = activeBricks;
+
+    this->State.Filter->RunOnCells(std::vector<ComputeType>(1, isoValue),
+                                   this->State.Field,
+                                   this->State.Index->GetCellIds(this->State.Active),
+                                   this->State.VerticesArray,
+                                   this->State.NormalsArray,
+                                   this->State.IsoOffsets);
+    return this->State.VerticesArray.GetNumberOfValues() / 3;
+  }
+
+  StateType& State;
+  float IsoValue;
+};
+
+// Everything the slab streamed isosurface holds between trials. Only one
+// slab of the volume is resident at a time: SlabValues is reused for every
+// slab, and the output of each slab is either appended to VerticesArrays
+// and NormalsArrays or handed to Writer and dropped when it is set. The
+// slabs are read in FieldType, the scalar type of the file. PointDims and
+// NumSlabs stay 0 when the file couldn't be opened.
+template<typename FieldType>
+struct StreamIsoSurfaceUniformGridState
+{
+  StreamIsoSurfaceUniformGridState():
+    PointDims(0, 0, 0),
+    SlabSize(0),
+    NumSlabs(0),
+    Writer(NULL)
+    {
+    }
+
+  bench::NrrdSlabReader Reader;
+  vtkm::Id3 PointDims;
+  //cells along z per slab, the last slab may be thinner
+  vtkm::Id SlabSize;
+  vtkm::Id NumSlabs;
+  std::vector<FieldType> SlabValues;
+  std::vector< vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > > VerticesArrays;
+  std::vector< vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > > NormalsArrays;
+  ply::StreamingSoupWriter* Writer;
+};
+
+template<typename FieldType>
+struct StreamIsoSurfaceUniformGridSetup
+{
+  typedef StreamIsoSurfaceUniformGridState<FieldType> StateType;
+
+  StreamIsoSurfaceUniformGridSetup(StateType& state,
+                                   const bench::NrrdHeader& header,
+                                   int slabSize):
+    State(state),
+    Header(header),
+    SlabSize(slabSize)
+    {
+    }
+
+  void operator()()
+  {
+    std::string error;
+    if(!this->State.Reader.Open(this->Header, error))
+      {
+      std::cerr << "unable to stream " << this->Header.DataFile << ": " << error << std::endl;
+      return;
+      }
+
+    this->State.PointDims = vtkm::Id3(this->Header.Sizes[0],
+                                      this->Header.Sizes[1],
+                                      this->Header.Sizes[2]);
+    const vtkm::Id cellsZ = this->State.PointDims[2] - 1;
+    this->State.SlabSize = std::max(vtkm::Id(1), std::min(vtkm::Id(this->SlabSize), cellsZ));
+    this->State.NumSlabs = (cellsZ + this->State.SlabSize - 1) / this->State.SlabSize;
+    //the points of the cells of a slab and a ghost slice on each side
+    this->State.SlabValues.resize(static_cast<std::size_t>(
+      (this->State.SlabSize + 3) * this->State.PointDims[0] * this->State.PointDims[1]));
+  }
+
+  StateType& State;
+  const bench::NrrdHeader& Header;
+  int SlabSize;
+};
+
+// Moves points along z by Offset, from the index space of a slab to the
+// one of the volume
+struct ShiftSlabPoints : public vtkm::exec::FunctorBase
+{
+  typedef vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> >
+    ::ExecutionTypes<DeviceAdapter>::Portal PortalType;
+
+  ShiftSlabPoints(const PortalType& points, vtkm::Float32 offset):
+    Points(points),
+    Offset(offset)
+    {
+    }
+
+  VTKM_EXEC_EXPORT
+  void operator()(vtkm::Id index) const
+  {
+    vtkm::Vec<vtkm::Float32,3> point = this->Points.Get(index);
+    point[2] += this->Offset;
+    this->Points.Set(index, point);
+  }
+
+  PortalType Points;
+  vtkm::Float32 Offset;
+};
+
+// Reads the volume one z slab at a time and contours the cells of each.
+// A slab of n cells is read with a ghost slice on each side that has a
+// neighbouring slab, so the normals of the points on its faces are the
+// central differences of the whole volume, and only its own n layers of
+// cells are contoured, so every cell is contoured exactly once. The
+// stock filter contours every cell of its data set, the slabs go through
+// the batch isosurface at a single isovalue instead, which takes the
+// cells to visit. The next slab is prefetched while the current one is
+// contoured.
+template<typename FieldType>
+struct StreamIsoSurfaceUniformGridKernel
+{
+  typedef StreamIsoSurfaceUniformGridState<FieldType> StateType;
+  typedef typename bench::ScalarTraits<FieldType>::ComputeType ComputeType;
+  typedef bench::BatchIsosurfaceUniformGrid<FieldType, DeviceAdapter> SlabFilter;
+
+  StreamIsoSurfaceUniformGridKernel(StateType& state,
+                                    float isoValue):
+    State(state),
+    IsoValue(isoValue)
+    {
+    }
+
+  vtkm::Id operator()(int)
+  {
+    StateType& state = this->State;
+    state.VerticesArrays.clear();
+    state.NormalsArrays.clear();
+
+    const std::vector<ComputeType> isoValues(1, static_cast<ComputeType>(this->IsoValue));
+    const vtkm::Id cellsZ = state.PointDims[2] - 1;
+    const vtkm::Id sliceSize = state.PointDims[0] * state.PointDims[1];
+    const vtkm::Id cellsPerLayer = (state.PointDims[0] - 1) * (state.PointDims[1] - 1);
+
+    vtkm::Id numTriangles = 0;
+    for(vtkm::Id slab=0; slab < state.NumSlabs; ++slab)
+      {
+      const vtkm::Id zBegin = slab * state.SlabSize;
+      const vtkm::Id numCellsZ = std::min(state.SlabSize, cellsZ - zBegin);
+      //first and last slice read, ghosts included
+      const vtkm::Id zFirst = std::max(vtkm::Id(0), zBegin - 1);
+      const vtkm::Id zLast = std::min(cellsZ, zBegin + numCellsZ + 1);
+      bench::ScopedPhase slabPhase("slab");
+      {
+      bench::ScopedPhase phase("read");
+      if(slab + 1 < state.NumSlabs)
+        {
+        state.Reader.Prefetch(zBegin + state.SlabSize - 1, state.SlabSize + 3);
+        }
+      if(!state.Reader.Read(zFirst, zLast - zFirst + 1,
+                            reinterpret_cast<char*>(&state.SlabValues[0])))
+        {
+        std::cerr << "unable to read slab " << slab << std::endl;
+        break;
+        }
+      }
+
+      const vtkm::Id3 pointDims(state.PointDims[0], state.PointDims[1], zLast - zFirst + 1);
+      vtkm::cont::ArrayHandle<FieldType> field =
+        vtkm::cont::make_ArrayHandle(&state.SlabValues[0], sliceSize * pointDims[2]);
+
+      vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > vertices;
+      vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > normals;
+      std::vector<vtkm::Id> isoOffsets;
+      {
+      bench::ScopedDevicePhase<Algorithm> phase("isosurface");
+      SlabFilter filter(pointDims);
+      filter.RunOnCells(isoValues, field,
+                        vtkm::cont::make_ArrayHandleCounting((zBegin - zFirst) * cellsPerLayer,
+                                                             numCellsZ * cellsPerLayer),
+                        vertices, normals, isoOffsets);
+      if(zFirst > 0)
+        {
+        Algorithm::Schedule(ShiftSlabPoints(vertices.PrepareForInPlace(DeviceAdapter()),
+                                            static_cast<vtkm::Float32>(zFirst)),
+                            vertices.GetNumberOfValues());
+        }
+      }
+
+      numTriangles += vertices.GetNumberOfValues() / 3;
+      if(state.Writer)
+        {
+        state.Writer->Append(vertices);
+        }
+      else
+        {
+        state.VerticesArrays.push_back(vertices);
+        state.NormalsArrays.push_back(normals);
+        }
+      }
+    return numTriangles;
+  }
+
+  StateType& State;
+  float IsoValue;
+};
 
 }
 
+// Runs the VTK-m isosurface on a volume stored as FieldType, see
+// bench::Volume::GetScalarType
+template<typename FieldType>
+static bench::Result RunIsoSurfaceUniformGrid(const bench::Volume& input,
+                                     vtkImageData* image,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     float isoValue,
+                                     const bench::RunnerOptions& options)
+{
+  typedef detail::IsoSurfaceUniformGridState<FieldType> StateType;
+  StateType state;
+  detail::IsoSurfaceUniformGridSetup<FieldType> setup(state, input, image);
+  detail::IsoSurfaceUniformGridKernel<StateType> kernel(state, isoValue);
+  //the stock filter dispatches its worklets internally, out of reach of
+  //the phase trace, so its trials can't be broken down
+  bench::RunnerOptions stockOptions = options;
+  stockOptions.PhaseNote = "breakdown unavailable: the stock VTK-m filter dispatches its worklets internally";
+
+  bench::Result result =
+    bench::RunBenchmark("VTK-m Isosurface", numCores, setup, kernel, stockOptions);
+  bench::SetField<FieldType>(result, input.GetNumberOfValues());
+
+  //a soup has 3 vertices and 3 normals per triangle and no index buffer
+  const vtkm::Id numVertices = state.VerticesArray.GetNumberOfValues();
+  result.OutputBytes = numVertices * 2 * sizeof(vtkm::Vec<vtkm::Float32,3>);
+  bench::PrintOutputSize(result.Name, numVertices, numVertices / 3, result.OutputBytes);
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty())
+    {
+    saveAsPly(state.VerticesArray, dumpPath);
+    }
+  return result;
+}
+
+// Benchmarks the filter of StateType, one producing a welded mesh of
+// points, normals and an index buffer, see WeldedIsoSurfaceUniformGridState
+template<typename StateType>
+static bench::Result RunWeldedFilter(const std::string& name,
+                                     const bench::Volume& input,
+                                     int numCores,
+                                     float isoValue,
+                                     const bench::RunnerOptions& options)
+{
+  StateType state;
+  detail::WeldedIsoSurfaceUniformGridSetup<StateType> setup(state, input);
+  detail::WeldedIsoSurfaceUniformGridKernel<StateType> kernel(state, isoValue);
+
+  bench::Result result = bench::RunBenchmark(name, numCores, setup, kernel, options);
+  bench::SetField<typename StateType::FieldValueType>(result, input.GetNumberOfValues());
+
+  const vtkm::Id numPoints = state.VerticesArray.GetNumberOfValues();
+  const vtkm::Id numIndices = state.IndicesArray.GetNumberOfValues();
+  result.OutputBytes = numPoints * 2 * sizeof(vtkm::Vec<vtkm::Float32,3>) +
+                       numIndices * sizeof(vtkm::Id);
+  bench::PrintOutputSize(result.Name, numPoints, numIndices / 3, result.OutputBytes);
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty() && numIndices > 0)
+    {
+    const vtkm::Id* indices =
+      &(*vtkm::cont::ArrayPortalToIteratorBegin(state.IndicesArray.GetPortalConstControl()));
+    saveAsPly(state.VerticesArray, indices, numIndices / 3, 3, dumpPath);
+    }
+  return result;
+}
+
+// Same as RunIsoSurfaceUniformGrid but every point on a shared grid edge
+// is generated once and the triangles are returned as an index buffer
+template<typename FieldType>
+static bench::Result RunWeldedIsoSurfaceUniformGrid(const bench::Volume& input,
+                                     vtkImageData* image,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     float isoValue,
+                                     const bench::RunnerOptions& options)
+{
+  return RunWeldedFilter< detail::WeldedIsoSurfaceUniformGridState<FieldType> >(
+    "VTK-m Welded Isosurface", input, numCores, isoValue, options);
+}
+
+// The welded isosurface of bench::FlyingEdgesUniformGrid, which classifies
+// and interpolates each grid edge once in passes along the x rows of the
+// volume instead of once per cell using it
+template<typename FieldType>
+static bench::Result RunFlyingEdgesUniformGrid(const bench::Volume& input,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     float isoValue,
+                                     const bench::RunnerOptions& options)
+{
+  typedef bench::FlyingEdgesUniformGrid<FieldType, DeviceAdapter> FilterType;
+  return RunWeldedFilter< detail::WeldedIsoSurfaceUniformGridState<FieldType, FilterType> >(
+    "VTK-m Flying Edges", input, numCores, isoValue, options);
+}
+
+// Contours every value of isoValues by running the VTK-m isosurface once
+// per isovalue, the baseline for RunBatchIsoSurfaceUniformGrid
+template<typename FieldType>
+static bench::Result RunSequentialIsoSurfaceUniformGrid(const bench::Volume& input,
+                                     vtkImageData* image,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     const std::vector<float>& isoValues,
+                                     const bench::RunnerOptions& options)
+{
+  detail::SequentialIsoSurfaceUniformGridState<FieldType> state;
+  detail::IsoSurfaceUniformGridSetup<FieldType> setup(state.Single, input, image);
+  detail::SequentialIsoSurfaceUniformGridKernel<FieldType> kernel(state, isoValues);
+
+  bench::Result result =
+    bench::RunBenchmark("VTK-m Sequential Isosurfaces", numCores, setup, kernel, options);
+  //every isovalue is a pass over the field
+  bench::SetField<FieldType>(result, input.GetNumberOfValues() *
+                                     static_cast<vtkm::Id>(isoValues.size()));
+
+  vtkm::Id numVertices = 0;
+  for(std::size_t i=0; i < state.VerticesArrays.size(); ++i)
+    {
+    numVertices += state.VerticesArrays[i].GetNumberOfValues();
+    }
+  result.OutputBytes = numVertices * 2 * sizeof(vtkm::Vec<vtkm::Float32,3>);
+  bench::PrintOutputSize(result.Name, numVertices, numVertices / 3, result.OutputBytes);
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty())
+    {
+    saveAsPly(state.VerticesArrays, dumpPath);
+    }
+  return result;
+}
+
+// Contours every value of isoValues in a single pass over the field, see
+// bench::BatchIsosurfaceUniformGrid
+template<typename FieldType>
+static bench::Result RunBatchIsoSurfaceUniformGrid(const bench::Volume& input,
+                                     vtkImageData* image,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     const std::vector<float>& isoValues,
+                                     const bench::RunnerOptions& options)
+{
+  detail::BatchIsoSurfaceUniformGridState<FieldType> state;
+  detail::BatchIsoSurfaceUniformGridSetup<FieldType> setup(state, input);
+  detail::BatchIsoSurfaceUniformGridKernel<FieldType> kernel(state, isoValues);
+
+  bench::Result result =
+    bench::RunBenchmark("VTK-m Batch Isosurfaces", numCores, setup, kernel, options);
+  bench::SetField<FieldType>(result, input.GetNumberOfValues());
+
+  const vtkm::Id numVertices = state.VerticesArray.GetNumberOfValues();
+  result.OutputBytes = numVertices * 2 * sizeof(vtkm::Vec<vtkm::Float32,3>);
+  bench::PrintOutputSize(result.Name, numVertices, numVertices / 3, result.OutputBytes);
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty())
+    {
+    saveAsPly(state.VerticesArray, dumpPath);
+    }
+  return result;
+}
+
+// Same output as RunIsoSurfaceUniformGrid, but a min/max index of the
+// bricks of the volume is built once in setup and each trial only visits
+// the cells of the bricks whose range contains its isovalue
+template<typename FieldType>
+static bench::Result RunBrickIsoSurfaceUniformGrid(const bench::Volume& input,
+                                     vtkImageData* image,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     float isoValue,
+                                     int brickSize,
+                                     const bench::RunnerOptions& options)
+{
+  detail::BrickIsoSurfaceUniformGridState<FieldType> state;
+  detail::BrickIsoSurfaceUniformGridSetup<FieldType> setup(state, input, brickSize);
+  detail::BrickIsoSurfaceUniformGridKernel<FieldType> kernel(state, isoValue);
+
+  bench::Result result =
+    bench::RunBenchmark("VTK-m Brick Isosurface", numCores, setup, kernel, options);
+  //the whole field is in the volume, even if only the active bricks are read
+  bench::SetField<FieldType>(result, input.GetNumberOfValues());
+
+  const vtkm::Id numBricks = state.Index->GetNumberOfBricks();
+  std::vector<double> activeRatios;
+  for(std::size_t i=0; i < state.ActiveBricks.size(); ++i)
+    {
+    activeRatios.push_back(static_cast<double>(state.ActiveBricks[i]) / numBricks);
+    }
+  std::cout << "Brick index \'" << result.Name << "\' results:\n"
+            << "\tbrick size = " << state.Index->GetBrickSize() << "\n"
+            << "\tbricks = " << numBricks << "\n"
+            << "\tbuild time = " << state.BuildTime << "s\n"
+            << "\tmedian query time = " << bench::Median(state.QueryTimes) << "s\n"
+            << "\tmedian active brick ratio = " << bench::Median(activeRatios) << std::endl;
+
+  const vtkm::Id numVertices = state.VerticesArray.GetNumberOfValues();
+  result.OutputBytes = numVertices * 2 * sizeof(vtkm::Vec<vtkm::Float32,3>);
+  bench::PrintOutputSize(result.Name, numVertices, numVertices / 3, result.OutputBytes);
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty())
+    {
+    saveAsPly(state.VerticesArray, dumpPath);
+    }
+  return result;
+}
+
+// Same as RunIsoSurfaceUniformGrid on a synthetic field that is never
+// materialized, every value is computed when the filter reads it
+static bench::Result RunImplicitIsoSurfaceUniformGrid(const bench::SyntheticField& field,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     float isoValue,
+                                     const bench::RunnerOptions& options)
+{
+  detail::ImplicitIsoSurfaceUniformGridState state(field);
+  detail::ImplicitIsoSurfaceUniformGridSetup setup(state, field);
+  detail::IsoSurfaceUniformGridKernel<detail::ImplicitIsoSurfaceUniformGridState> kernel(state, isoValue);
+  //the stock filter dispatches its worklets internally, out of reach of
+  //the phase trace, so its trials can't be broken down
+  bench::RunnerOptions stockOptions = options;
+  stockOptions.PhaseNote = "breakdown unavailable: the stock VTK-m filter dispatches its worklets internally";
+
+  bench::Result result =
+    bench::RunBenchmark("VTK-m Implicit Isosurface", numCores, setup, kernel, stockOptions);
+
+  const vtkm::Id numVertices = state.VerticesArray.GetNumberOfValues();
+  result.OutputBytes = numVertices * 2 * sizeof(vtkm::Vec<vtkm::Float32,3>);
+  bench::PrintOutputSize(result.Name, numVertices, numVertices / 3, result.OutputBytes);
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty())
+    {
+    saveAsPly(state.VerticesArray, dumpPath);
+    }
+  return result;
+}
+
+namespace detail
+{
+
+template<typename FieldType>
+static bench::Result RunStreamIsoSurfaceUniformGrid(const bench::NrrdHeader& header,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     float isoValue,
+                                     int slabSize,
+                                     const bench::RunnerOptions& options)
+{
+  std::ostringstream name;
+  name << "VTK-m Streamed Isosurface (slab " << slabSize << ")";
+
+  StreamIsoSurfaceUniformGridState<FieldType> state;
+  StreamIsoSurfaceUniformGridSetup<FieldType> setup(state, header, slabSize);
+  StreamIsoSurfaceUniformGridKernel<FieldType> kernel(state, isoValue);
+
+  bench::Result result =
+    bench::RunBenchmark(name.str(), numCores, setup, kernel, options);
+  bench::SetField<FieldType>(result, static_cast<vtkm::Id>(header.NumberOfValues()));
+
+  if(state.NumSlabs == 0)
+    {
+    return result;
+    }
+
+  //slices shared by two slabs are read twice, and each of them reads a
+  //ghost slice on the other side of the face they share
+  const vtkm::Id sliceSize = state.PointDims[0] * state.PointDims[1];
+  const long long bytesRead = static_cast<long long>(sliceSize) *
+    (state.PointDims[2] + 3 * (state.NumSlabs - 1)) * static_cast<long long>(sizeof(FieldType));
+  const double numCells = static_cast<double>(state.PointDims[0] - 1) *
+    static_cast<double>(state.PointDims[1] - 1) * static_cast<double>(state.PointDims[2] - 1);
+  const double median = result.Samples.empty() ? 0.0 : bench::Median(result.Samples);
+  std::cout << "Stream \'" << result.Name << "\' results:\n"
+            << "\tslab size = " << state.SlabSize << " cells\n"
+            << "\tslabs = " << state.NumSlabs << "\n"
+            << "\tslab buffer = "
+            << bench::ToMegaBytes(static_cast<long long>(state.SlabValues.size() * sizeof(FieldType))) << "MB\n"
+            << "\tpeak resident memory = " << bench::ToMegaBytes(bench::BenchmarkPeakResidentBytes(result)) << "MB\n"
+            << "\tbytes read per trial = " << bytesRead << "\n"
+            << "\tthroughput = " << ((median > 0.0) ? (bytesRead / median) / 1.0e9 : 0.0) << "GB/s\n"
+            << "\tcell rate = " << ((median > 0.0) ? (numCells / median) / 1.0e6 : 0.0) << "Mcells/s" << std::endl;
+
+  vtkm::Id numVertices = 0;
+  for(std::size_t i=0; i < state.VerticesArrays.size(); ++i)
+    {
+    numVertices += state.VerticesArrays[i].GetNumberOfValues();
+    }
+  result.OutputBytes = numVertices * 2 * sizeof(vtkm::Vec<vtkm::Float32,3>);
+  bench::PrintOutputSize(result.Name, numVertices, numVertices / 3, result.OutputBytes);
+
+  const std::string dumpPath = bench::DumpPath(options, result.Name, numCores);
+  if(!dumpPath.empty())
+    {
+    vtkm::cont::Timer<> timer;
+    ply::StreamingSoupWriter writer(dumpPath);
+    if(writer.IsValid())
+      {
+      state.Writer = &writer;
+      kernel(0);
+      state.Writer = NULL;
+      const long long bytes = writer.Close();
+      if(writer.IsValid())
+        {
+        ply::PrintThroughput(dumpPath, bytes, timer.GetElapsedTime());
+        }
+      }
+    }
+  return result;
+}
+
+}
+
+// Same output as RunIsoSurfaceUniformGrid for a volume that is streamed
+// from disk in z slabs of slabSize cells instead of loaded whole. Peak
+// memory is the one of the benchmark alone, and with --dump the output
+// of one more, untimed, pass is streamed to the PLY file slab by slab.
+// The slabs are contoured in the scalar type of the header.
+static bench::Result RunStreamIsoSurfaceUniformGrid(const bench::NrrdHeader& header,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     float isoValue,
+                                     int slabSize,
+                                     const bench::RunnerOptions& options)
+{
+  switch(bench::ScalarTypeFromNrrd(header.Type))
+    {
+    case bench::SCALAR_UINT8:
+      return detail::RunStreamIsoSurfaceUniformGrid<vtkm::UInt8>(
+        header, device, numCores, maxNumCores, isoValue, slabSize, options);
+    case bench::SCALAR_UINT16:
+      return detail::RunStreamIsoSurfaceUniformGrid<vtkm::UInt16>(
+        header, device, numCores, maxNumCores, isoValue, slabSize, options);
+    case bench::SCALAR_FLOAT64:
+      return detail::RunStreamIsoSurfaceUniformGrid<vtkm::Float64>(
+        header, device, numCores, maxNumCores, isoValue, slabSize, options);
+    default:
+      return detail::RunStreamIsoSurfaceUniformGrid<vtkm::Float32>(
+        header, device, numCores, maxNumCores, isoValue, slabSize, options);
+    }
+}
+
+// The VTK-m isosurfaces as contenders of compare, all of them named vtkm
+class IsoSurfaceContender : public bench::Contender
+{
+public:
+  IsoSurfaceContender(): bench::Contender("vtkm", bench::DEVICE_ANY) {}
+
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return context.Input == bench::INPUT_VOLUME &&
+           context.Pipeline == bench::PIPELINE_MARCHING_CUBES;
+  }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    bench::RunInScalarType<IsoSurfaceContender>(context, collector);
+  }
+
+  template<typename FieldType>
+  static void RunTyped(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunIsoSurfaceUniformGrid<FieldType>(*context.Volume, context.Image, context.Device,
+                                                          context.NumCores, context.MaxNumCores,
+                                                          context.IsoValue, *context.Options));
+  }
+};
+
+class BrickIsoSurfaceContender : public IsoSurfaceContender
+{
+public:
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return IsoSurfaceContender::Accepts(context) && context.Parser->brickSize() > 0;
+  }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    bench::RunInScalarType<BrickIsoSurfaceContender>(context, collector);
+  }
+
+  template<typename FieldType>
+  static void RunTyped(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunBrickIsoSurfaceUniformGrid<FieldType>(*context.Volume, context.Image, context.Device,
+                                                               context.NumCores, context.MaxNumCores,
+                                                               context.IsoValue, context.Parser->brickSize(),
+                                                               *context.Options));
+  }
+};
+
+class WeldedIsoSurfaceContender : public IsoSurfaceContender
+{
+public:
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return IsoSurfaceContender::Accepts(context) && context.Parser->weld();
+  }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    bench::RunInScalarType<WeldedIsoSurfaceContender>(context, collector);
+  }
+
+  template<typename FieldType>
+  static void RunTyped(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunWeldedIsoSurfaceUniformGrid<FieldType>(*context.Volume, context.Image, context.Device,
+                                                                context.NumCores, context.MaxNumCores,
+                                                                context.IsoValue, *context.Options));
+  }
+};
+
+// The flying edges isosurface. Its passes over rows keep a loop per thread
+// along x, which only the CPU devices are written for.
+class FlyingEdgesContender : public bench::Contender
+{
+public:
+  FlyingEdgesContender(): bench::Contender("vtkm", bench::DEVICE_SERIAL | bench::DEVICE_TBB) {}
+
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return context.Input == bench::INPUT_VOLUME &&
+           context.Pipeline == bench::PIPELINE_MARCHING_CUBES;
+  }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    bench::RunInScalarType<FlyingEdgesContender>(context, collector);
+  }
+
+  template<typename FieldType>
+  static void RunTyped(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunFlyingEdgesUniformGrid<FieldType>(*context.Volume, context.Device,
+                                                           context.NumCores, context.MaxNumCores,
+                                                           context.IsoValue, *context.Options));
+  }
+};
+
+class SequentialIsoSurfaceContender : public IsoSurfaceContender
+{
+public:
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return IsoSurfaceContender::Accepts(context) && !context.Parser->isovalues().empty();
+  }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    bench::RunInScalarType<SequentialIsoSurfaceContender>(context, collector);
+  }
+
+  template<typename FieldType>
+  static void RunTyped(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunSequentialIsoSurfaceUniformGrid<FieldType>(*context.Volume, context.Image, context.Device,
+                                                                    context.NumCores, context.MaxNumCores,
+                                                                    context.Parser->isovalues(), *context.Options));
+  }
+};
+
+class BatchIsoSurfaceContender : public SequentialIsoSurfaceContender
+{
+public:
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    bench::RunInScalarType<BatchIsoSurfaceContender>(context, collector);
+  }
+
+  template<typename FieldType>
+  static void RunTyped(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunBatchIsoSurfaceUniformGrid<FieldType>(*context.Volume, context.Image, context.Device,
+                                                               context.NumCores, context.MaxNumCores,
+                                                               context.Parser->isovalues(), *context.Options));
+  }
+};
+
+//the only contender of --implicit, there is no volume for the others to read
+class ImplicitIsoSurfaceContender : public bench::Contender
+{
+public:
+  ImplicitIsoSurfaceContender(): bench::Contender("vtkm", bench::DEVICE_ANY) {}
+
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return context.Input == bench::INPUT_IMPLICIT;
+  }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunImplicitIsoSurfaceUniformGrid(*context.Field, context.Device,
+                                                       context.NumCores, context.MaxNumCores,
+                                                       context.IsoValue, *context.Options));
+  }
+};
+
+//the only contender of --stream, only the slab being contoured is resident
+class StreamIsoSurfaceContender : public bench::Contender
+{
+public:
+  StreamIsoSurfaceContender(): bench::Contender("vtkm", bench::DEVICE_ANY) {}
+
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return context.Input == bench::INPUT_STREAM;
+  }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    //nothing to time when the file can't be streamed
+    bench::NrrdSlabReader reader;
+    std::string error;
+    if(!reader.Open(*context.Header, error))
+      {
+      std::cerr << "unable to stream " << context.Header->DataFile << ": " << error << std::endl;
+      return;
+      }
+    reader.Close();
+
+    const std::vector<int>& slabSizes = context.Parser->slabSizes();
+    for(std::size_t i=0; i < slabSizes.size(); ++i)
+      {
+      collector.Collect(RunStreamIsoSurfaceUniformGrid(*context.Header, context.Device,
+                                                       context.NumCores, context.MaxNumCores,
+                                                       context.IsoValue, slabSizes[i],
+                                                       *context.Options));
+      }
+  }
+};
+
+static bench::ContenderRegistration IsoSurfaceRegistration(new IsoSurfaceContender);
+static bench::ContenderRegistration BrickIsoSurfaceRegistration(new BrickIsoSurfaceContender);
+static bench::ContenderRegistration WeldedIsoSurfaceRegistration(new WeldedIsoSurfaceContender);
+static bench::ContenderRegistration FlyingEdgesRegistration(new FlyingEdgesContender);
+static bench::ContenderRegistration SequentialIsoSurfaceRegistration(new SequentialIsoSurfaceContender);
+static bench::ContenderRegistration BatchIsoSurfaceRegistration(new BatchIsoSurfaceContender);
+static bench::ContenderRegistration ImplicitIsoSurfaceRegistration(new ImplicitIsoSurfaceContender);
+static bench::ContenderRegistration StreamIsoSurfaceRegistration(new StreamIsoSurfaceContender);
+
 }
@@ -0,0 +1,214 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+
+//uses the device adapter and data set helpers of compare_vtkm_mc.h
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/ArrayHandleUniformPointCoordinates.h>
+#include <vtkm/cont/CellSetExplicit.h>
+#include <vtkm/cont/DataSet.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "compare_runner.h"
+#include "ContenderRegistry.h"
+#include "ScalarTypes.h"
+#include "ThresholdUniformGrid.h"
+#include "Volume.h"
+
+namespace vtkm
+{
+namespace detail
+{
+
+// Everything the VTK-m threshold needs to hold between trials. The time
+// of each stage is kept per trial, warmups overwrite the entries of trial
+// 0, like the queries of BrickIsoSurfaceUniformGridState.
+template<typename FieldType>
+struct ThresholdUniformGridState
+{
+  typedef bench::ThresholdUniformGrid<FieldType, DeviceAdapter> ThresholdFilter;
+
+  vtkm::Id3 PointDims;
+  vtkm::cont::ArrayHandle<FieldType> Field;
+  vtkm::cont::ArrayHandle<vtkm::Id> CellIds;
+  //the output of the last trial: the points of the input grid, the kept
+  //cells and the point field
+  vtkm::cont::DataSet Output;
+  boost::shared_ptr<ThresholdFilter> Filter;
+  std::vector<bench::ThresholdStageTimes> StageTimes;
+};
+
+template<typename FieldType>
+struct ThresholdUniformGridSetup
+{
+  typedef ThresholdUniformGridState<FieldType> StateType;
+
+  ThresholdUniformGridSetup(StateType& state,
+                            const bench::Volume& input):
+    State(state),
+    Input(input)
+    {
+    }
+
+  void operator()()
+  {
+    int dims[3];
+    this->Input.GetDimensions(dims);
+    this->State.PointDims = vtkm::Id3(dims[0], dims[1], dims[2]);
+
+    //refers to the memory of the input volume, no copy is made
+    this->State.Field = this->Input.template GetArrayHandle<FieldType>();
+    this->State.Filter.reset(new typename StateType::ThresholdFilter(this->State.PointDims));
+  }
+
+  StateType& State;
+  const bench::Volume& Input;
+};
+
+// Keeps the cells whose values are all at or above the isovalue of the
+// trial, the same range as vtkThreshold::ThresholdByUpper
+template<typename FieldType>
+struct ThresholdUniformGridKernel
+{
+  typedef ThresholdUniformGridState<FieldType> StateType;
+  typedef typename bench::ScalarTraits<FieldType>::ComputeType ComputeType;
+
+  ThresholdUniformGridKernel(StateType& state,
+                             float isoValue):
+    State(state),
+    IsoValue(isoValue)
+    {
+    }
+
+  vtkm::Id operator()(int trial)
+  {
+    const ComputeType lower = static_cast<ComputeType>(this->IsoValue);
+    //vtkThreshold keeps cells at +inf, which max() would drop
+    const ComputeType upper = std::numeric_limits<ComputeType>::has_infinity ?
+      std::numeric_limits<ComputeType>::infinity() :
+      std::numeric_limits<ComputeType>::max();
+
+    bench::ThresholdStageTimes times;
+    vtkm::cont::CellSetExplicit<> cellSet("cells", 3);
+    const vtkm::Id numCells = this->State.Filter->Run(lower, upper, this->State.Field,
+                                                      this->State.CellIds, cellSet, times);
+
+    //the output shares the coordinates and field of the input
+    vtkm::cont::DataSet output;
+    output.AddCoordinateSystem(vtkm::cont::CoordinateSystem("coordinates", 1,
+      vtkm::cont::ArrayHandleUniformPointCoordinates(this->State.PointDims,
+                                                     vtkm::Vec<vtkm::FloatDefault,3>(0.0f))));
+    output.AddCellSet(cellSet);
+    output.AddField(vtkm::cont::Field("nodevar", 1, vtkm::cont::Field::ASSOC_POINTS,
+                                      this->State.Field));
+    this->State.Output = output;
+
+    const std::size_t index = static_cast<std::size_t>(trial);
+    if(this->State.StageTimes.size() <= index)
+      {
+      this->State.StageTimes.resize(index + 1);
+      }
+    this->State.StageTimes[index] = times;
+    return numCells;
+  }
+
+  StateType& State;
+  float IsoValue;
+};
+
+}
+
+// Threshold of the cells of a volume stored as FieldType with the VTK-m
+// classify, compact and build stages of bench::ThresholdUniformGrid. The
+// number of kept cells is reported where the isosurfaces report triangles.
+template<typename FieldType>
+static bench::Result RunThresholdUniformGrid(const bench::Volume& input,
+                                     const std::string& device,
+                                     int numCores,
+                                     int maxNumCores,
+                                     float isoValue,
+                                     const bench::RunnerOptions& options)
+{
+  detail::ThresholdUniformGridState<FieldType> state;
+  detail::ThresholdUniformGridSetup<FieldType> setup(state, input);
+  detail::ThresholdUniformGridKernel<FieldType> kernel(state, isoValue);
+
+  bench::Result result =
+    bench::RunBenchmark("VTK-m Threshold", numCores, setup, kernel, options);
+  bench::SetField<FieldType>(result, input.GetNumberOfValues());
+
+  std::vector<double> classify;
+  std::vector<double> compact;
+  std::vector<double> build;
+  for(std::size_t i=0; i < state.StageTimes.size(); ++i)
+    {
+    classify.push_back(state.StageTimes[i].Classify);
+    compact.push_back(state.StageTimes[i].Compact);
+    build.push_back(state.StageTimes[i].Build);
+    }
+  const vtkm::Id numInputCells = (state.PointDims[0] - 1) *
+    (state.PointDims[1] - 1) * (state.PointDims[2] - 1);
+  const vtkm::Id numCells = state.CellIds.GetNumberOfValues();
+  std::cout << "Stages \'" << result.Name << "\' results:\n"
+            << "\tmedian classify time = " << bench::Median(classify) << "s\n"
+            << "\tmedian compact time = " << bench::Median(compact) << "s\n"
+            << "\tmedian build time = " << bench::Median(build) << "s\n"
+            << "\tkept cell ratio = "
+            << ((numInputCells > 0) ? static_cast<double>(numCells) / numInputCells : 0.0)
+            << std::endl;
+
+  //ids of the kept cells, and per cell a shape, a point count and 8 ids
+  result.OutputBytes = numCells * (sizeof(vtkm::Id) + sizeof(vtkm::UInt8) +
+                                   sizeof(vtkm::IdComponent) + 8 * sizeof(vtkm::Id));
+  std::cout << "Output \'" << result.Name << "\' results:\n"
+            << "\tcells = " << numCells << "\n"
+            << "\tbytes = " << result.OutputBytes << std::endl;
+  return result;
+}
+
+// The VTK-m threshold as a contender of compare, named vtkm
+class ThresholdContender : public bench::Contender
+{
+public:
+  ThresholdContender(): bench::Contender("vtkm", bench::DEVICE_ANY) {}
+
+  virtual bool Accepts(const bench::ContenderContext& context) const
+  {
+    return context.Input == bench::INPUT_VOLUME &&
+           context.Pipeline == bench::PIPELINE_THRESHOLD;
+  }
+
+  virtual void Run(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    bench::RunInScalarType<ThresholdContender>(context, collector);
+  }
+
+  template<typename FieldType>
+  static void RunTyped(const bench::ContenderContext& context, bench::ResultCollector& collector)
+  {
+    collector.Collect(RunThresholdUniformGrid<FieldType>(*context.Volume, context.Device,
+                                                         context.NumCores, context.MaxNumCores,
+                                                         context.IsoValue, *context.Options));
+  }
+};
+
+static bench::ContenderRegistration ThresholdRegistration(new ThresholdContender);
+
+}
@@ -27,12 +27,5 @@ int main(int argc, char* argv[])
     return 1;
     }
 
-  const std::string file = parser.file();
-  const std::string writeLoc = parser.writeLocation();
-
-  const float isoValue = parser.isovalue();
-  const double ratio = parser.ratio();
-
-  RunComparison("Cuda", file, writeLoc, 1, 1, isoValue, ratio);
-  return 0;
+  return RunComparison("Cuda", parser, 1, 1);
 }
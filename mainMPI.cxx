@@ -0,0 +1,51 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#define VTKM_DEVICE_ADAPTER VTKM_DEVICE_ADAPTER_TBB
+
+#include <mpi.h>
+
+#include "ArgumentsParser.h"
+#include "compare_mpi.h"
+#include <tbb/task_scheduler_init.h>
+
+#include <iostream>
+
+int main(int argc, char* argv[])
+  {
+  //TBB threads run inside every rank, only the main thread calls MPI
+  int provided = MPI_THREAD_SINGLE;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+  if (provided < MPI_THREAD_FUNNELED)
+    {
+    std::cerr << "the MPI library doesn't provide MPI_THREAD_FUNNELED, "
+              << "which the TBB threads of every rank need" << std::endl;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+    return 1;
+    }
+
+  vtkm::testing::ArgumentsParser parser;
+  if (!parser.parseArguments(argc, argv))
+    {
+    MPI_Finalize();
+    return 1;
+    }
+
+  int maxNumCores = tbb::task_scheduler_init::default_num_threads();
+
+  const int result = RunMPIComparison(parser, maxNumCores);
+  MPI_Finalize();
+  return result;
+}
@@ -1,7 +1,7 @@
-#bin/bash
+#!/bin/bash
 
-./BenchmarkCuda --file=/temp/test.nhdr --pipeline=1 > cuda_threshold.csv
-./BenchmarkCuda --file=/temp/test.nhdr --pipeline=2 > cuda_mc.csv
+./BenchmarkCuda --file=/temp/test.nhdr --pipeline=1 --results=cuda_threshold.csv > cuda_threshold.log
+./BenchmarkCuda --file=/temp/test.nhdr --pipeline=2 --results=cuda_mc.csv > cuda_mc.log
 
-./BenchmarkSerial --file=/temp/test.nhdr --pipeline=1 > serial_threshold.csv
-./BenchmarkSerial --file=/temp/test.nhdr --pipeline=2 > serial_mc.csv
+./BenchmarkSerial --file=/temp/test.nhdr --pipeline=1 --results=serial_threshold.csv > serial_threshold.log
+./BenchmarkSerial --file=/temp/test.nhdr --pipeline=2 --results=serial_mc.csv > serial_mc.log
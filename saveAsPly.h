@@ -1,64 +1,418 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//  Copyright 2012 Sandia Corporation.
+//  Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+//  the U.S. Government retains certain rights in this software.
+//
+//=============================================================================
+#ifndef __saveAsPly_h
+#define __saveAsPly_h
 
+#include <vtkm/Types.h>
+#include <vtkm/cont/ArrayHandle.h>
+#include <vtkm/cont/DeviceAdapterAlgorithm.h>
+#include <vtkm/cont/Timer.h>
+#include <vtkm/exec/FunctorBase.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
-#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
 
-static
-void saveAsPly(std::vector< vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > >& vertices, std::string path)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "compare_runner.h"
+
+namespace ply
 {
-  typedef vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > HandleType;
-  typedef HandleType::PortalConstControl PortalConst;
-  typedef HandleType::ValueType TriangleType;
 
-  //1. count the number of total triangles
-  vtkm::Id numVerts = 0;
+typedef vtkm::Vec<vtkm::Float32,3> VertexType;
+typedef vtkm::cont::ArrayHandle< VertexType > VertexHandleType;
 
-  for(std::size_t i=0; i < vertices.size(); ++i)
+//bytes of a binary vertex record (3 x float32) and face record
+//(uint8 count + 3 x int32)
+static const std::size_t VERTEX_RECORD_SIZE = 12;
+static const std::size_t FACE_RECORD_SIZE = 13;
+
+//number of bytes serialized in memory before each pwrite
+static const std::size_t CHUNK_SIZE = 64 * 1024 * 1024;
+
+//faces index their vertices with int32, so a file can't hold more
+//vertices than an int32 can count. Reports it when numVerts doesn't fit.
+static bool CanIndexVertices(vtkm::Id numVerts, const std::string& path)
+{
+  if(numVerts > static_cast<vtkm::Id>(std::numeric_limits<vtkm::Int32>::max()))
+    {
+    std::cerr << "unable to write " << path << ": " << numVerts
+              << " vertices can't be indexed by the int32 faces of a PLY file" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+static void WriteLittleEndian32(char* out, const void* value)
+{
+  const unsigned short probe = 1;
+  const bool hostIsLittle = *reinterpret_cast<const unsigned char*>(&probe) == 1;
+  const char* in = static_cast<const char*>(value);
+  if(hostIsLittle)
+    {
+    std::memcpy(out, in, 4);
+    }
+  else
+    {
+    out[0] = in[3]; out[1] = in[2]; out[2] = in[1]; out[3] = in[0];
+    }
+}
+
+//serializes vertices [Begin, Begin+n) of a portal into Out
+template<typename PortalType>
+struct VertexSerializer : public vtkm::exec::FunctorBase
+{
+  VertexSerializer(const PortalType& portal, char* out):
+    Portal(portal), Out(out), Begin(0)
+    {
+    }
+
+  VTKM_EXEC_EXPORT void operator()(vtkm::Id index) const
+  {
+    const VertexType vertex = this->Portal.Get(this->Begin + index);
+    char* out = this->Out + index * VERTEX_RECORD_SIZE;
+    for(int i=0; i < 3; ++i)
       {
-      numVerts += vertices[i].GetNumberOfValues();
+      WriteLittleEndian32(out + 4*i, &vertex[i]);
       }
+  }
 
-  //2. write out the file header
-  std::fstream file(path.c_str(), std::fstream::out | std::fstream::trunc);
-  file << "ply" << std::endl;
-  file << "format ascii 1.0" << std::endl;
-  file << "element vertex " << numVerts << std::endl;
-  file << "property float32 x" << std::endl;
-  file << "property float32 y" << std::endl;
-  file << "property float32 z" << std::endl;
-  file << "element face " << (numVerts / 3) << std::endl;
-  file << "property list uint8 int32 vertex_indices" << std::endl;
-  file << "end_header" << std::endl;
-
-  //output the coordinates
-  for(vtkm::Id i=0; i < vertices.size(); ++i)
-    {
-    vtkm::Id numTris = vertices[i].GetNumberOfValues();
-    if( numTris > 0)
+  PortalType Portal;
+  char* Out;
+  vtkm::Id Begin;
+};
+
+//faces of a triangle soup, face i uses vertices 3i, 3i+1 and 3i+2
+struct SoupFaceSerializer : public vtkm::exec::FunctorBase
+{
+  explicit SoupFaceSerializer(char* out):
+    Out(out), Begin(0)
+    {
+    }
+
+  VTKM_EXEC_EXPORT void operator()(vtkm::Id index) const
+  {
+    char* out = this->Out + index * FACE_RECORD_SIZE;
+    out[0] = 3;
+    for(int i=0; i < 3; ++i)
       {
-      PortalConst portal = vertices[i].GetPortalConstControl();
-      for(vtkm::Id cellId=0; cellId < numTris; ++cellId)
-        {
-        TriangleType tri = portal.Get(cellId);
-        file << tri[0] << " " << tri[1] << " " << tri[2] << std::endl;
-        }
+      const vtkm::Int32 vertIndex = static_cast<vtkm::Int32>(3 * (this->Begin + index) + i);
+      WriteLittleEndian32(out + 1 + 4*i, &vertIndex);
       }
+  }
+
+  char* Out;
+  vtkm::Id Begin;
+};
+
+//faces given as a flat list of 3 vertex indices per triangle. Stride is
+//the distance between two triangles so legacy VTK cell arrays, which
+//prefix each triangle with its point count, can be used as is.
+template<typename IndexType>
+struct IndexedFaceSerializer : public vtkm::exec::FunctorBase
+{
+  IndexedFaceSerializer(const IndexType* indices, vtkm::Id stride, char* out):
+    Indices(indices), Stride(stride), Out(out), Begin(0)
+    {
     }
 
-  //output the connectivity
-  vtkm::Id offset = 0;
-  for(vtkm::Id i=0; i < vertices.size(); ++i)
+  VTKM_EXEC_EXPORT void operator()(vtkm::Id index) const
+  {
+    const IndexType* tri = this->Indices + (this->Begin + index) * this->Stride;
+    char* out = this->Out + index * FACE_RECORD_SIZE;
+    out[0] = 3;
+    for(int i=0; i < 3; ++i)
+      {
+      const vtkm::Int32 vertIndex = static_cast<vtkm::Int32>(tri[i]);
+      WriteLittleEndian32(out + 1 + 4*i, &vertIndex);
+      }
+  }
+
+  const IndexType* Indices;
+  vtkm::Id Stride;
+  char* Out;
+  vtkm::Id Begin;
+};
+
+// Writes a binary little endian PLY file through large pwrites. Records
+// are serialized in parallel on the host into a preallocated chunk buffer
+// which is then written in one call.
+class BinaryWriter
+{
+public:
+  typedef vtkm::cont::DeviceAdapterAlgorithm<bench::HostDeviceAdapterTag> Algorithm;
+
+  explicit BinaryWriter(const std::string& path):
+    Path(path),
+    Offset(0),
+    Buffer(CHUNK_SIZE)
+    {
+    this->File = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(this->File < 0)
+      {
+      std::cerr << "unable to open " << path << ": " << std::strerror(errno) << std::endl;
+      }
+    }
+
+  ~BinaryWriter()
     {
-    vtkm::Id numVerts = vertices[i].GetNumberOfValues() * 3;
-    if( numVerts > 0)
+    if(this->File >= 0)
+      {
+      ::close(this->File);
+      }
+    }
+
+  bool IsValid() const { return this->File >= 0; }
+  long long GetBytesWritten() const { return this->Offset; }
+  const std::string& GetPath() const { return this->Path; }
+
+  //close and remove a file that can't be completed
+  void Discard()
+  {
+    if(this->File >= 0)
+      {
+      ::close(this->File);
+      this->File = -1;
+      }
+    ::unlink(this->Path.c_str());
+  }
+
+  // Write the header at the current offset. When headerSize isn't 0 the
+  // header is padded to that many bytes with a comment, so that a header
+  // written before the counts are known can be rewritten in place by
+  // RewriteHeader.
+  void WriteHeader(vtkm::Id numVerts, vtkm::Id numFaces, std::size_t headerSize = 0)
+  {
+    const std::string str = Header(numVerts, numFaces, headerSize);
+    this->Write(str.c_str(), str.size());
+  }
+
+  //overwrite a header written with the same headerSize at the file start
+  void RewriteHeader(vtkm::Id numVerts, vtkm::Id numFaces, std::size_t headerSize)
+  {
+    const long long offset = this->Offset;
+    this->Offset = 0;
+    this->WriteHeader(numVerts, numFaces, headerSize);
+    this->Offset = offset;
+  }
+
+  // Serialize count records of recordSize bytes with the given functor,
+  // one chunk at a time
+  template<typename Serializer>
+  void WriteRecords(Serializer serializer, vtkm::Id count, std::size_t recordSize)
+  {
+    const vtkm::Id recordsPerChunk = static_cast<vtkm::Id>(this->Buffer.size() / recordSize);
+    serializer.Out = &this->Buffer[0];
+    for(vtkm::Id begin=0; begin < count; begin += recordsPerChunk)
+      {
+      const vtkm::Id n = std::min(recordsPerChunk, count - begin);
+      serializer.Begin = begin;
+      Algorithm::Schedule(serializer, n);
+      Algorithm::Synchronize();
+      this->Write(&this->Buffer[0], static_cast<std::size_t>(n) * recordSize);
+      }
+  }
+
+private:
+  BinaryWriter(const BinaryWriter&);
+  void operator=(const BinaryWriter&);
+
+  static std::string Header(vtkm::Id numVerts, vtkm::Id numFaces, std::size_t headerSize)
+  {
+    std::ostringstream header;
+    header << "ply\n"
+           << "format binary_little_endian 1.0\n"
+           << "element vertex " << numVerts << "\n"
+           << "property float32 x\n"
+           << "property float32 y\n"
+           << "property float32 z\n"
+           << "element face " << numFaces << "\n"
+           << "property list uint8 int32 vertex_indices\n";
+
+    const std::string padding("comment \nend_header\n");
+    const std::size_t used = static_cast<std::size_t>(header.tellp()) + padding.size();
+    if(headerSize > used)
+      {
+      header << "comment " << std::string(headerSize - used, ' ') << "\n";
+      }
+    header << "end_header\n";
+    return header.str();
+  }
+
+  void Write(const char* data, std::size_t size)
+  {
+    while(size > 0 && this->File >= 0)
       {
-      for(vtkm::Id vertIndex=offset; vertIndex < (offset+numVerts); vertIndex+=3)
+      const ssize_t written = ::pwrite(this->File, data, size, static_cast<off_t>(this->Offset));
+      if(written <= 0)
         {
-        file << "3 " << vertIndex << " " << vertIndex+1 << " " << vertIndex+2 << std::endl;
+        if(written < 0 && errno == EINTR)
+          {
+          continue;
+          }
+        //nothing written for a non empty buffer would loop forever
+        std::cerr << "unable to write " << this->Path << ": "
+                  << (written < 0 ? std::strerror(errno) : "no bytes written") << std::endl;
+        ::close(this->File);
+        this->File = -1;
+        return;
         }
-      offset += numVerts;
+      data += written;
+      size -= static_cast<std::size_t>(written);
+      this->Offset += written;
       }
+  }
+
+  std::string Path;
+  int File;
+  long long Offset;
+  std::vector<char> Buffer;
+};
+
+// Writes a triangle soup to a PLY file as it is produced, one vertex array
+// at a time, so the whole soup never has to be held in memory. The faces
+// of a soup only depend on the number of vertices, so they are written
+// once every vertex has been, and the header, written up front padded to a
+// fixed size, is patched by Close. The file is removed once it holds more
+// vertices than its faces can index.
+class StreamingSoupWriter
+{
+public:
+  explicit StreamingSoupWriter(const std::string& path):
+    Writer(path),
+    NumVerts(0)
+    {
+    this->Writer.WriteHeader(0, 0, HEADER_SIZE);
+    }
+
+  bool IsValid() const { return this->Writer.IsValid(); }
+  vtkm::Id GetNumberOfVertices() const { return this->NumVerts; }
+
+  void Append(const VertexHandleType& vertices)
+  {
+    typedef VertexHandleType::PortalConstControl PortalConst;
+    const vtkm::Id numVerts = vertices.GetNumberOfValues();
+    if(!this->IsValid() || numVerts == 0)
+      {
+      return;
+      }
+    if(!CanIndexVertices(this->NumVerts + numVerts, this->Writer.GetPath()))
+      {
+      this->Writer.Discard();
+      return;
+      }
+
+    VertexSerializer<PortalConst> serializer(vertices.GetPortalConstControl(), NULL);
+    this->Writer.WriteRecords(serializer, numVerts, VERTEX_RECORD_SIZE);
+    this->NumVerts += numVerts;
+  }
+
+  //write the faces and the final header, returns the size of the file, 0
+  //when it was discarded
+  long long Close()
+  {
+    if(!this->IsValid())
+      {
+      return 0;
+      }
+    this->Writer.WriteRecords(SoupFaceSerializer(NULL), this->NumVerts / 3, FACE_RECORD_SIZE);
+    this->Writer.RewriteHeader(this->NumVerts, this->NumVerts / 3, HEADER_SIZE);
+    return this->Writer.GetBytesWritten();
+  }
+
+private:
+  //room for a header with the largest counts a vtkm::Id can hold
+  static const std::size_t HEADER_SIZE = 256;
+
+  BinaryWriter Writer;
+  vtkm::Id NumVerts;
+};
+
+static void PrintThroughput(const std::string& path, long long bytes, double seconds)
+{
+  std::cout << "Write \'" << path << "\' results:\n"
+            << "\tbytes = " << bytes << "\n"
+            << "\ttime = " << seconds << "s\n"
+            << "\tthroughput = " << ((seconds > 0.0) ? (bytes / seconds) / 1.0e9 : 0.0) << "GB/s" << std::endl;
+}
+
+//make sure the folder --dump points at exists
+static void MakeDirectory(const std::string& path)
+{
+  if(::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+    std::cerr << "unable to create " << path << ": " << std::strerror(errno) << std::endl;
+    }
+}
+
+}
+
+// Save a triangle soup, made of the concatenation of several vertex
+// arrays, as a binary PLY file. Every 3 consecutive vertices form a face,
+// so chunked outputs are written without being concatenated first.
+static
+void saveAsPly(std::vector< vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > >& vertices, std::string path)
+{
+  typedef ply::VertexHandleType::PortalConstControl PortalConst;
+
+  //1. count the number of total vertices
+  vtkm::Id numVerts = 0;
+  for(std::size_t i=0; i < vertices.size(); ++i)
+      {
+      numVerts += vertices[i].GetNumberOfValues();
+      }
+
+  if(!ply::CanIndexVertices(numVerts, path))
+    {
+    return;
     }
-  file.close();
+
+  vtkm::cont::Timer<> timer;
+  ply::BinaryWriter writer(path);
+  if(!writer.IsValid())
+    {
+    return;
+    }
+
+  //2. write out the file header
+  writer.WriteHeader(numVerts, numVerts / 3);
+
+  //3. output the coordinates
+  for(std::size_t i=0; i < vertices.size(); ++i)
+    {
+    const vtkm::Id blockVerts = vertices[i].GetNumberOfValues();
+    if(blockVerts > 0)
+      {
+      ply::VertexSerializer<PortalConst> serializer(vertices[i].GetPortalConstControl(), NULL);
+      writer.WriteRecords(serializer, blockVerts, ply::VERTEX_RECORD_SIZE);
+      }
+    }
+
+  //4. output the connectivity, which is implicit for a soup
+  writer.WriteRecords(ply::SoupFaceSerializer(NULL), numVerts / 3, ply::FACE_RECORD_SIZE);
+
+  ply::PrintThroughput(path, writer.GetBytesWritten(), timer.GetElapsedTime());
 }
 
 static
@@ -67,4 +421,41 @@ void saveAsPly(vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> >& vertices,
   typedef vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> > HandleType;
   std::vector< HandleType > vec; vec.push_back(vertices);
   saveAsPly(vec, path);
-}
\ No newline at end of file
+}
+
+// Save an indexed triangle mesh as a binary PLY file. indices holds the 3
+// point ids of each triangle, stride values apart.
+template<typename IndexType>
+static
+void saveAsPly(vtkm::cont::ArrayHandle< vtkm::Vec<vtkm::Float32,3> >& points,
+               const IndexType* indices, vtkm::Id numTris, vtkm::Id stride,
+               std::string path)
+{
+  typedef ply::VertexHandleType::PortalConstControl PortalConst;
+
+  const vtkm::Id numVerts = points.GetNumberOfValues();
+  if(!ply::CanIndexVertices(numVerts, path))
+    {
+    return;
+    }
+
+  vtkm::cont::Timer<> timer;
+  ply::BinaryWriter writer(path);
+  if(!writer.IsValid())
+    {
+    return;
+    }
+
+  writer.WriteHeader(numVerts, numTris);
+  if(numVerts > 0)
+    {
+    ply::VertexSerializer<PortalConst> serializer(points.GetPortalConstControl(), NULL);
+    writer.WriteRecords(serializer, numVerts, ply::VERTEX_RECORD_SIZE);
+    }
+  writer.WriteRecords(ply::IndexedFaceSerializer<IndexType>(indices, stride, NULL),
+                      numTris, ply::FACE_RECORD_SIZE);
+
+  ply::PrintThroughput(path, writer.GetBytesWritten(), timer.GetElapsedTime());
+}
+
+#endif